@@ -0,0 +1,161 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(TREMBLE_COUNT_ALLOCATIONS)
+
+namespace
+{
+    std::atomic<uint64_t> numAllocations = 0;
+
+    void* Allocate(size_t size)
+    {
+        numAllocations.fetch_add(1, std::memory_order_relaxed);
+        return std::malloc(size > 0 ? size : 1);
+    }
+
+    void* AllocateAligned(size_t size, std::align_val_t alignment)
+    {
+        numAllocations.fetch_add(1, std::memory_order_relaxed);
+
+        size_t align = (size_t)alignment;
+        size = (size + align - 1) & ~(align - 1);
+#if defined(_WIN32)
+        return _aligned_malloc(size > 0 ? size : align, align);
+#else
+        return std::aligned_alloc(align, size > 0 ? size : align);
+#endif
+    }
+
+    void FreeAligned(void* pointer)
+    {
+#if defined(_WIN32)
+        _aligned_free(pointer);
+#else
+        std::free(pointer);
+#endif
+    }
+}
+
+uint64_t AllocationCounter::GetCount()
+{
+    return numAllocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size)
+{
+    if (void* pointer = Allocate(size))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return Allocate(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    if (void* pointer = AllocateAligned(size, alignment))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return AllocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return AllocateAligned(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+    FreeAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+    FreeAligned(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept
+{
+    FreeAligned(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept
+{
+    FreeAligned(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    FreeAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    FreeAligned(pointer);
+}
+
+#else
+
+uint64_t AllocationCounter::GetCount()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+
+// Allocations are counted in debug builds, and in release builds that define TREMBLE_COUNT_ALLOCATIONS. Counting
+// replaces the global operator new, so it is left out of other builds entirely.
+#if defined(DEBUG) && !defined(TREMBLE_COUNT_ALLOCATIONS)
+#define TREMBLE_COUNT_ALLOCATIONS
+#endif
+
+// Counts every call of the global operator new on any thread, so code that should not touch the heap, like a
+// frame once it reached its steady state, can check that it does not.
+namespace AllocationCounter
+{
+#if defined(TREMBLE_COUNT_ALLOCATIONS)
+    constexpr bool kEnabled = true;
+#else
+    constexpr bool kEnabled = false;
+#endif
+
+    // Returns the number of allocations made since the program started, or 0 if counting is not compiled in.
+    uint64_t GetCount();
+}
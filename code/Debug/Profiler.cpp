@@ -0,0 +1,205 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(TREMBLE_PROFILE)
+
+namespace
+{
+    enum class EventType : uint32_t
+    {
+        Zone,
+        Counter
+    };
+
+    struct Event
+    {
+        const char* name;
+        uint64_t time;
+
+        // The end of zones, or the bits of the value of counters.
+        uint64_t data;
+
+        EventType type;
+    };
+
+    struct ThreadBuffer
+    {
+        // The trace id of the thread, which stays with the buffer when another thread reuses it.
+        int id;
+
+        // The number of events ever recorded, of which the last kEventsPerThread are kept.
+        uint64_t numEvents;
+
+        std::string name;
+        bool inUse;
+        std::vector<Event> events;
+    };
+
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+    // Threads hand their buffer back when they exit, so renderers that start workers every frame keep reusing the
+    // same few buffers instead of adding one per thread ever started.
+    struct ThreadBufferHandle
+    {
+        ThreadBuffer* buffer = nullptr;
+
+        ~ThreadBufferHandle()
+        {
+            if (buffer)
+            {
+                std::lock_guard<std::mutex> lock(buffersMutex);
+                buffer->inUse = false;
+            }
+        }
+    };
+
+    thread_local ThreadBufferHandle threadBuffer;
+
+    ThreadBuffer& GetThreadBuffer()
+    {
+        if (!threadBuffer.buffer)
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+
+            for (std::unique_ptr<ThreadBuffer>& buffer : buffers)
+            {
+                if (!buffer->inUse)
+                {
+                    threadBuffer.buffer = buffer.get();
+                    break;
+                }
+            }
+
+            if (!threadBuffer.buffer)
+            {
+                buffers.push_back(std::make_unique<ThreadBuffer>());
+                threadBuffer.buffer = buffers.back().get();
+                threadBuffer.buffer->id = (int)buffers.size();
+                threadBuffer.buffer->numEvents = 0;
+                threadBuffer.buffer->events.resize(Profiler::kEventsPerThread);
+            }
+
+            threadBuffer.buffer->inUse = true;
+        }
+
+        return *threadBuffer.buffer;
+    }
+
+    void AddEvent(const Event& event)
+    {
+        ThreadBuffer& buffer = GetThreadBuffer();
+        buffer.events[buffer.numEvents % Profiler::kEventsPerThread] = event;
+        buffer.numEvents++;
+    }
+}
+
+uint64_t Profiler::GetTimestamp()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::AddZone(const char* name, uint64_t begin, uint64_t end)
+{
+    AddEvent({ name, begin, end, EventType::Zone });
+}
+
+void Profiler::AddCounter(const char* name, double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    AddEvent({ name, GetTimestamp(), bits, EventType::Counter });
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    GetThreadBuffer().name = name;
+}
+
+bool Profiler::WriteChromeTrace(const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+
+    // Trace timestamps are microseconds, counted from the oldest event kept.
+    uint64_t startTime = UINT64_MAX;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : buffers)
+    {
+        uint64_t numKept = std::min<uint64_t>(buffer->numEvents, kEventsPerThread);
+        for (uint64_t i = buffer->numEvents - numKept; i < buffer->numEvents; ++i)
+        {
+            startTime = std::min(startTime, buffer->events[i % kEventsPerThread].time);
+        }
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+
+    for (const std::unique_ptr<ThreadBuffer>& buffer : buffers)
+    {
+        std::string threadName = buffer->name.empty() ? "Thread " + std::to_string(buffer->id) : buffer->name;
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", buffer->id, threadName.c_str());
+        first = false;
+
+        uint64_t numKept = std::min<uint64_t>(buffer->numEvents, kEventsPerThread);
+        for (uint64_t i = buffer->numEvents - numKept; i < buffer->numEvents; ++i)
+        {
+            const Event& event = buffer->events[i % kEventsPerThread];
+            double time = (double)(event.time - startTime) / 1000.0;
+
+            if (event.type == EventType::Zone)
+            {
+                double duration = (double)(event.data - event.time) / 1000.0;
+                fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", event.name, buffer->id, time, duration);
+            }
+            else
+            {
+                double value;
+                std::memcpy(&value, &event.data, sizeof(value));
+                fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"value\":%g}}", event.name, buffer->id, time, value);
+            }
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
+
+#else
+
+uint64_t Profiler::GetTimestamp()
+{
+    return 0;
+}
+
+void Profiler::AddZone(const char* name, uint64_t begin, uint64_t end)
+{
+}
+
+void Profiler::AddCounter(const char* name, double value)
+{
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+}
+
+bool Profiler::WriteChromeTrace(const char* path)
+{
+    return false;
+}
+
+#endif
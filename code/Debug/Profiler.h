@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+
+// The profiler is compiled into debug builds, and into release builds that define TREMBLE_PROFILE. Without it the
+// zone and counter macros expand to nothing.
+#if defined(DEBUG) && !defined(TREMBLE_PROFILE)
+#define TREMBLE_PROFILE
+#endif
+
+// Records zones and counters into a ring buffer per thread, so recording never blocks and never allocates once a
+// thread has its buffer. Only the newest events of each thread are kept, and they are written out in the Chrome
+// trace event format, which chrome://tracing and Perfetto open directly.
+namespace Profiler
+{
+#if defined(TREMBLE_PROFILE)
+    constexpr bool kEnabled = true;
+#else
+    constexpr bool kEnabled = false;
+#endif
+
+    // The number of events kept per thread.
+    constexpr int kEventsPerThread = 1 << 15;
+
+    // Returns the current time in nanoseconds.
+    uint64_t GetTimestamp();
+
+    // Records a zone with the given name between the given timestamps on the calling thread. The name must outlive
+    // the profiler, which string literals do.
+    void AddZone(const char* name, uint64_t begin, uint64_t end);
+
+    // Records the value of the counter with the given name at the current time.
+    void AddCounter(const char* name, double value);
+
+    // Names the calling thread in the trace. Threads without a name are listed by the order they started recording.
+    void SetThreadName(const char* name);
+
+    // Writes the events of all threads to the given file in the Chrome trace event format. No other thread may
+    // record while the trace is written. Returns false if the file could not be written or the profiler is not
+    // compiled in.
+    bool WriteChromeTrace(const char* path);
+}
+
+#if defined(TREMBLE_PROFILE)
+
+// Records a zone from its construction to the end of the enclosing scope.
+struct ProfileZone
+{
+    // The name of the zone.
+    const char* name;
+
+    // The time the zone was entered.
+    uint64_t begin;
+
+    // Enters the zone with the given name.
+    ProfileZone(const char* name)
+        : name(name)
+        , begin(Profiler::GetTimestamp())
+    {
+    }
+
+    // Leaves the zone and records it.
+    ~ProfileZone()
+    {
+        Profiler::AddZone(name, begin, Profiler::GetTimestamp());
+    }
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_COUNTER(name, value) Profiler::AddCounter(name, (double)(value))
+#define PROFILE_THREAD_NAME(name) Profiler::SetThreadName(name)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_COUNTER(name, value) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+
+#endif
@@ -0,0 +1,67 @@
+#include "InputQueue.h"
+
+InputQueue::InputQueue(size_t capacity)
+    : mask(0)
+    , head(0)
+    , cachedTail(0)
+    , tail(0)
+    , cachedHead(0)
+    , numDropped(0)
+{
+    size_t size = 1;
+    while (size < capacity)
+    {
+        size *= 2;
+    }
+
+    events.resize(size);
+    mask = size - 1;
+}
+
+bool InputQueue::Push(const InputEvent& event)
+{
+    size_t index = tail.load(std::memory_order_relaxed);
+
+    if (index - cachedHead == events.size())
+    {
+        cachedHead = head.load(std::memory_order_acquire);
+        if (index - cachedHead == events.size())
+        {
+            numDropped++;
+            return false;
+        }
+    }
+
+    events[index & mask] = event;
+
+    // Releasing the new tail publishes the event to the taking thread.
+    tail.store(index + 1, std::memory_order_release);
+    return true;
+}
+
+const InputEvent* InputQueue::Peek()
+{
+    size_t index = head.load(std::memory_order_relaxed);
+
+    if (index == cachedTail)
+    {
+        cachedTail = tail.load(std::memory_order_acquire);
+        if (index == cachedTail)
+        {
+            return nullptr;
+        }
+    }
+
+    return &events[index & mask];
+}
+
+void InputQueue::Pop()
+{
+    // Releasing the new head hands the slot back to the pushing thread once the event was read.
+    head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+int InputQueue::GetNumDropped() const
+{
+    return numDropped;
+}
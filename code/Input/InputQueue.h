@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "InputRecording.h"
+
+// Hands timestamped input events from the thread that polls them to the thread that simulates them without locks.
+// Exactly one thread may push and exactly one thread may take events, which can be the same thread. The queue has a
+// fixed capacity, and events pushed while it is full are dropped and counted.
+class InputQueue
+{
+public:
+    // Creates a new queue holding at least the given number of events, rounded up to a power of two.
+    explicit InputQueue(size_t capacity = 4096);
+
+    InputQueue(const InputQueue&) = delete;
+    InputQueue& operator=(const InputQueue&) = delete;
+
+    // Adds an event at the back of the queue. Returns false and drops the event if the queue is full. Only called by
+    // the pushing thread.
+    bool Push(const InputEvent& event);
+
+    // Returns the event at the front of the queue, or null if it is empty. The event stays valid until it is popped.
+    // Only called by the taking thread.
+    const InputEvent* Peek();
+
+    // Removes the event at the front of the queue, which must not be empty. Only called by the taking thread.
+    void Pop();
+
+    // Returns the number of events dropped because the queue was full. Only called by the pushing thread.
+    int GetNumDropped() const;
+
+private:
+    std::vector<InputEvent> events;
+    size_t mask;
+
+    // The index of the next event to take, which grows forever and wraps around the ring through the mask. Only
+    // the taking thread writes it; the last tail it read is cached next to it, so it only reads the pushing thread's
+    // line once it caught up with that tail.
+    alignas(64) std::atomic<size_t> head;
+    size_t cachedTail;
+
+    // The index the next event is pushed to, and the pushing thread's cache of the head.
+    alignas(64) std::atomic<size_t> tail;
+    size_t cachedHead;
+    int numDropped;
+};
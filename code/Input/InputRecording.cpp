@@ -0,0 +1,122 @@
+#include "InputRecording.h"
+#include <cstdio>
+#include <cstring>
+
+void ApplyInputEvent(const InputEvent& event, bool* keys, int numKeys, glm::vec2& mouseDelta)
+{
+    if (event.type == InputEventType::MouseMove)
+    {
+        mouseDelta += event.mouseDelta;
+    }
+    else if (event.key >= 0 && event.key < numKeys)
+    {
+        keys[event.key] = event.type == InputEventType::KeyDown;
+    }
+}
+
+void InputRecording::AddKey(double time, int key, bool pressed)
+{
+    InputEvent event = {};
+    event.time = time;
+    event.type = pressed ? InputEventType::KeyDown : InputEventType::KeyUp;
+    event.key = key;
+    events.push_back(event);
+}
+
+void InputRecording::AddMouseMove(double time, const glm::vec2& delta)
+{
+    InputEvent event = {};
+    event.time = time;
+    event.type = InputEventType::MouseMove;
+    event.mouseDelta = delta;
+    events.push_back(event);
+}
+
+double InputRecording::GetDuration() const
+{
+    return events.empty() ? 0.0 : events.back().time;
+}
+
+size_t InputRecording::Replay(size_t firstEvent, double endTime, bool* keys, int numKeys, glm::vec2& mouseDelta) const
+{
+    size_t eventIndex = firstEvent;
+
+    for (; eventIndex < events.size() && events[eventIndex].time < endTime; ++eventIndex)
+    {
+        ApplyInputEvent(events[eventIndex], keys, numKeys, mouseDelta);
+    }
+
+    return eventIndex;
+}
+
+bool InputRecording::Save(const char* path) const
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    // Seventeen significant digits round trip every double exactly.
+    bool written = fprintf(file, "# Tremble input\n") > 0;
+
+    for (const InputEvent& event : events)
+    {
+        if (event.type == InputEventType::MouseMove)
+        {
+            written = written && fprintf(file, "mouse %.17g %.9g %.9g\n", event.time, event.mouseDelta.x, event.mouseDelta.y) > 0;
+        }
+        else
+        {
+            written = written && fprintf(file, "key %.17g %d %d\n", event.time, event.key, event.type == InputEventType::KeyDown ? 1 : 0) > 0;
+        }
+    }
+
+    return fclose(file) == 0 && written;
+}
+
+bool InputRecording::Load(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::vector<InputEvent> newEvents;
+    char line[256];
+    bool valid = true;
+
+    while (valid && fgets(line, sizeof(line), file))
+    {
+        InputEvent event = {};
+        int pressed = 0;
+        int numChars = 0;
+
+        if (sscanf(line, "key %lf %d %d %n", &event.time, &event.key, &pressed, &numChars) == 3)
+        {
+            event.type = pressed ? InputEventType::KeyDown : InputEventType::KeyUp;
+        }
+        else if (sscanf(line, "mouse %lf %f %f %n", &event.time, &event.mouseDelta.x, &event.mouseDelta.y, &numChars) == 3)
+        {
+            event.type = InputEventType::MouseMove;
+        }
+        else
+        {
+            // Comments and blank lines are skipped, anything else is malformed.
+            valid = line[0] == '#' || strspn(line, " \t\r\n") == strlen(line);
+            continue;
+        }
+
+        valid = line[numChars] == '\0' && (newEvents.empty() || newEvents.back().time <= event.time);
+        newEvents.push_back(event);
+    }
+
+    fclose(file);
+
+    if (valid)
+    {
+        events = std::move(newEvents);
+    }
+    return valid;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+enum class InputEventType : uint8_t
+{
+    KeyDown,
+    KeyUp,
+    MouseMove
+};
+
+struct InputEvent
+{
+    // The time of the event in seconds, counted from the start of the recording for recorded events.
+    double time;
+
+    // The type of the event.
+    InputEventType type;
+
+    // The GLFW key code of key events.
+    int key;
+
+    // The cursor movement of mouse events in pixels.
+    glm::vec2 mouseDelta;
+};
+
+// Applies the given event to the key states and the mouse delta, adding cursor movements to it. Keys outside the
+// given number of keys are ignored.
+void ApplyInputEvent(const InputEvent& event, bool* keys, int numKeys, glm::vec2& mouseDelta);
+
+// A list of timestamped key and mouse events. Recordings of live sessions are replayed with a fixed time step,
+// which makes runs reproducible no matter how fast the frames of the original session were.
+struct InputRecording
+{
+    // The recorded events, ordered by time.
+    std::vector<InputEvent> events;
+
+    // Adds a key press or release at the given time.
+    void AddKey(double time, int key, bool pressed);
+
+    // Adds a cursor movement at the given time.
+    void AddMouseMove(double time, const glm::vec2& delta);
+
+    // Returns the time of the last event, or 0 if there are none.
+    double GetDuration() const;
+
+    // Applies the events from the given index up to the given end time to the key states and the mouse delta,
+    // adding up all cursor movements. Keys outside the given number of keys are ignored. Returns the index of the
+    // first event that was not applied, to continue the replay from.
+    size_t Replay(size_t firstEvent, double endTime, bool* keys, int numKeys, glm::vec2& mouseDelta) const;
+
+    // Saves the events to the given text file. Returns false if the file could not be written.
+    bool Save(const char* path) const;
+
+    // Loads the events from the given text file, replacing the current ones. Returns false if the file could not
+    // be read or holds malformed events.
+    bool Load(const char* path);
+};
@@ -0,0 +1,109 @@
+#include "FramePipeline.h"
+#include <algorithm>
+
+#include "Debug/Profiler.h"
+
+FramePipeline::FramePipeline(std::vector<FramePipelineStage> stages, int numPackets)
+    : stages(std::move(stages))
+    , numPackets(std::max(numPackets, 1))
+    , packetStages(std::max(numPackets, 1), 0)
+    , stopping(false)
+    , nextFrame(0)
+{
+    if (this->numPackets > 1)
+    {
+        for (int i = 0; i + 1 < (int)this->stages.size(); ++i)
+        {
+            threads.emplace_back(&FramePipeline::RunStage, this, i);
+        }
+    }
+}
+
+FramePipeline::~FramePipeline()
+{
+    Stop();
+}
+
+void FramePipeline::RunFrame()
+{
+    int frameIndex = nextFrame++;
+    int packetIndex = frameIndex % numPackets;
+
+    if (threads.empty())
+    {
+        for (const FramePipelineStage& stage : stages)
+        {
+            PROFILE_ZONE(stage.name);
+            stage.run(frameIndex, packetIndex);
+        }
+        return;
+    }
+
+    int lastStage = (int)stages.size() - 1;
+    if (WaitForStage(lastStage, frameIndex))
+    {
+        {
+            PROFILE_ZONE(stages[lastStage].name);
+            stages[lastStage].run(frameIndex, packetIndex);
+        }
+        FinishStage(lastStage, frameIndex);
+    }
+}
+
+void FramePipeline::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    threads.clear();
+}
+
+int FramePipeline::GetNumPackets() const
+{
+    return numPackets;
+}
+
+int FramePipeline::GetFramesAhead() const
+{
+    return stages.size() > 1 ? numPackets - 1 : 0;
+}
+
+bool FramePipeline::WaitForStage(int stageIndex, int frameIndex)
+{
+    int packetIndex = frameIndex % numPackets;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [&]() { return stopping || packetStages[packetIndex] == stageIndex; });
+    return !stopping;
+}
+
+void FramePipeline::FinishStage(int stageIndex, int frameIndex)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        packetStages[frameIndex % numPackets] = (stageIndex + 1) % (int)stages.size();
+    }
+    condition.notify_all();
+}
+
+void FramePipeline::RunStage(int stageIndex)
+{
+    const FramePipelineStage& stage = stages[stageIndex];
+    PROFILE_THREAD_NAME(stage.name);
+
+    for (int frameIndex = 0; WaitForStage(stageIndex, frameIndex); ++frameIndex)
+    {
+        {
+            PROFILE_ZONE(stage.name);
+            stage.run(frameIndex, frameIndex % numPackets);
+        }
+        FinishStage(stageIndex, frameIndex);
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct FramePipelineStage
+{
+    // The name of the stage, which also names its thread in profiles.
+    const char* name;
+
+    // Processes the given frame, whose data lives in the packet with the given index.
+    std::function<void(int frameIndex, int packetIndex)> run;
+};
+
+// Runs the stages of each frame on threads of their own, so a stage can work on the next frame while the later
+// stages are still busy with the previous ones. Frames are handed from stage to stage in a ring of packets, and a
+// packet is only reused once the last stage finished with it, so the number of packets bounds how many frames are
+// in flight: every packet beyond the first lets the first stage run one more frame ahead of the last, and adds a
+// frame of latency between them. With a single packet every stage runs on the calling thread one after another.
+class FramePipeline
+{
+public:
+    // Creates a new pipeline running the given stages over the given number of packets. The last stage always runs
+    // on the thread calling RunFrame, which lets it own the graphics context.
+    FramePipeline(std::vector<FramePipelineStage> stages, int numPackets);
+
+    // Stops the pipeline.
+    ~FramePipeline();
+
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    // Runs the last stage of the next frame once the earlier stages finished it.
+    void RunFrame();
+
+    // Stops the threads of the earlier stages once they finished their current frame. Frames they ran ahead are
+    // dropped.
+    void Stop();
+
+    // Returns the number of packets.
+    int GetNumPackets() const;
+
+    // Returns the number of frames the first stage can run ahead of the last, which is the latency the pipeline adds
+    // in frames.
+    int GetFramesAhead() const;
+
+private:
+    // Waits until the given stage may process the given frame, and returns false if the pipeline stopped meanwhile.
+    bool WaitForStage(int stageIndex, int frameIndex);
+
+    // Hands the given frame on to the next stage.
+    void FinishStage(int stageIndex, int frameIndex);
+
+    // Runs the given stage for every frame until the pipeline stops.
+    void RunStage(int stageIndex);
+
+    std::vector<FramePipelineStage> stages;
+    int numPackets;
+
+    // The stage each packet waits for next.
+    std::vector<int> packetStages;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<std::thread> threads;
+    bool stopping;
+
+    // The next frame the last stage runs.
+    int nextFrame;
+};
@@ -0,0 +1,207 @@
+#include "JobSystem.h"
+
+#include "Debug/Profiler.h"
+
+namespace
+{
+    // The worker the calling thread runs jobs for, and the system it belongs to.
+    thread_local const JobSystem* currentSystem = nullptr;
+    thread_local int currentWorker = 0;
+
+    // The number of jobs each deque has room for before it grows.
+    constexpr size_t kInitialQueueSize = 256;
+}
+
+JobSystem::JobSystem(int numThreads)
+    : numQueuedJobs(0)
+    , numSteals(0)
+    , quit(false)
+{
+    numThreads = numThreads > 0 ? numThreads : std::max(1, (int)std::thread::hardware_concurrency());
+
+    for (int i = 0; i < numThreads; ++i)
+    {
+        queues.push_back(std::make_unique<Queue>());
+        queues.back()->jobs.resize(kInitialQueueSize);
+    }
+
+    for (int i = 1; i < numThreads; ++i)
+    {
+        threads.emplace_back(&JobSystem::RunWorker, this, i);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        quit = true;
+    }
+    wakeCondition.notify_all();
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    // Jobs queued by threads outside the system may still be waiting on the first deque.
+    Job job;
+    while (TryGetJob(job))
+    {
+        Execute(job);
+    }
+}
+
+void JobSystem::Run(const Job& job)
+{
+    if (job.counter)
+    {
+        job.counter->value.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Queue& queue = *queues[GetWorkerIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.count == queue.jobs.size())
+        {
+            // Unroll the ring into a larger buffer, oldest job first.
+            std::vector<Job> jobs(queue.jobs.size() * 2);
+            for (size_t i = 0; i < queue.count; ++i)
+            {
+                jobs[i] = queue.jobs[(queue.head + i) % queue.jobs.size()];
+            }
+            queue.jobs.swap(jobs);
+            queue.head = 0;
+        }
+
+        queue.jobs[(queue.head + queue.count) % queue.jobs.size()] = job;
+        queue.count++;
+    }
+
+    // Taking the lock before notifying makes sure a worker about to sleep either sees the job or gets woken.
+    numQueuedJobs.fetch_add(1, std::memory_order_release);
+    if (!threads.empty())
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wakeCondition.notify_one();
+    }
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+    while (counter.value.load(std::memory_order_acquire) > 0)
+    {
+        Job job;
+        if (TryGetJob(job))
+        {
+            Execute(job);
+        }
+        else
+        {
+            // The remaining jobs of the group are running on other workers.
+            std::this_thread::yield();
+        }
+    }
+}
+
+int JobSystem::GetNumThreads() const
+{
+    return (int)queues.size();
+}
+
+int JobSystem::GetNumSteals() const
+{
+    return numSteals.load(std::memory_order_relaxed);
+}
+
+void JobSystem::RunWorker(int workerIndex)
+{
+    currentSystem = this;
+    currentWorker = workerIndex;
+    PROFILE_THREAD_NAME("Job worker");
+
+    while (true)
+    {
+        Job job;
+        if (TryGetJob(job))
+        {
+            Execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeCondition.wait(lock, [this]() { return quit || numQueuedJobs.load(std::memory_order_acquire) > 0; });
+
+        if (quit)
+        {
+            return;
+        }
+    }
+}
+
+bool JobSystem::TryGetJob(Job& job)
+{
+    int numQueues = (int)queues.size();
+    int workerIndex = GetWorkerIndex();
+
+    for (int i = 0; i < numQueues; ++i)
+    {
+        Queue& queue = *queues[(workerIndex + i) % numQueues];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.count == 0)
+        {
+            continue;
+        }
+
+        if (i == 0)
+        {
+            // The newest job of the worker's own deque is the one most likely still in its cache.
+            job = queue.jobs[(queue.head + queue.count - 1) % queue.jobs.size()];
+        }
+        else
+        {
+            // The oldest job of another deque is usually the largest piece of a split range.
+            job = queue.jobs[queue.head];
+            queue.head = (queue.head + 1) % queue.jobs.size();
+            numSteals.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        queue.count--;
+        numQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    return false;
+}
+
+void JobSystem::Execute(const Job& job)
+{
+    job.function(job);
+
+    if (job.counter)
+    {
+        job.counter->value.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+int JobSystem::GetWorkerIndex() const
+{
+    return currentSystem == this ? currentWorker : 0;
+}
+
+void JobSystem::RunParallelFor(const Job& job)
+{
+    const ParallelForContext& context = *static_cast<const ParallelForContext*>(job.data);
+    int end = job.end;
+
+    while (end - job.begin > context.grainSize)
+    {
+        int middle = job.begin + (end - job.begin) / 2;
+        context.system->Run({ &RunParallelFor, job.data, middle, end, job.counter });
+        end = middle;
+    }
+
+    context.invoke(context.function, job.begin, end);
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts the jobs of a group that have not finished yet. Waiting on a counter runs other jobs meanwhile, so jobs may
+// wait on the counters of the jobs they depend on, which is how dependencies between jobs are expressed.
+struct JobCounter
+{
+    // The number of jobs still queued or running.
+    std::atomic<int> value = 0;
+};
+
+struct Job
+{
+    // The function to run, called with the job itself so it can read its data and range.
+    void (*function)(const Job& job);
+
+    // The data of the job, which must stay valid until the job finished.
+    void* data;
+
+    // The range of items the job covers.
+    int begin;
+    int end;
+
+    // The counter of the group the job belongs to, or null.
+    JobCounter* counter;
+};
+
+// Runs jobs on a fixed set of worker threads. Every worker owns a deque, pushing and taking its own jobs at the back
+// and stealing from the front of the others' when it runs dry, so related jobs stay on one thread while idle threads
+// take the largest pieces of work left. The thread that creates the system counts as the first worker and runs jobs
+// whenever it waits; threads outside the system queue on the first worker's deque as well.
+class JobSystem
+{
+public:
+    // Creates a new system with the given number of threads, including the calling thread. Uses one thread per
+    // hardware thread if the number of threads is 0.
+    explicit JobSystem(int numThreads = 0);
+
+    // Finishes the queued jobs and stops the workers.
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Queues the given job, adding it to its counter first.
+    void Run(const Job& job);
+
+    // Runs queued jobs until the given counter reaches zero.
+    void Wait(const JobCounter& counter);
+
+    // Calls function(begin, end) for consecutive ranges covering 0 to count and returns once all calls finished.
+    // The range is split in halves until the pieces hold at most grainSize items, and the halves are queued so
+    // idle workers can steal them.
+    template <typename Function>
+    void ParallelFor(int count, int grainSize, const Function& function);
+
+    // Returns the number of threads running jobs, including the creating thread.
+    int GetNumThreads() const;
+
+    // Returns the number of jobs taken from another worker's deque since the system was created.
+    int GetNumSteals() const;
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+
+        // A ring buffer of jobs, with the oldest at the head.
+        std::vector<Job> jobs;
+        size_t head = 0;
+        size_t count = 0;
+    };
+
+    struct ParallelForContext
+    {
+        JobSystem* system;
+        const void* function;
+        void (*invoke)(const void* function, int begin, int end);
+        int grainSize;
+    };
+
+    // Runs the queued jobs of the worker with the given index until the system stops.
+    void RunWorker(int workerIndex);
+
+    // Takes a job from the back of the calling worker's deque, or steals one from the front of another. Returns
+    // false if all deques are empty.
+    bool TryGetJob(Job& job);
+
+    // Runs the job and counts it as finished.
+    void Execute(const Job& job);
+
+    // Returns the index of the calling thread's worker.
+    int GetWorkerIndex() const;
+
+    // Splits the range of the job in halves, queueing the upper halves, and runs what remains.
+    static void RunParallelFor(const Job& job);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    // Idle workers sleep until jobs are queued.
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+    std::atomic<int> numQueuedJobs;
+    std::atomic<int> numSteals;
+    bool quit;
+};
+
+template <typename Function>
+void JobSystem::ParallelFor(int count, int grainSize, const Function& function)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    ParallelForContext context = {
+        this,
+        &function,
+        [](const void* function, int begin, int end) { (*static_cast<const Function*>(function))(begin, end); },
+        std::max(grainSize, 1)
+    };
+
+    JobCounter counter;
+    Run({ &RunParallelFor, &context, 0, count, &counter });
+    Wait(counter);
+}
@@ -12,20 +12,62 @@
 #include <stb_rect_pack.h>
 
 #include <algorithm>
+#include <chrono>
 #include <vector>
-#include <functional>
 
+#include "Debug/AllocationCounter.h"
+#include "Debug/Profiler.h"
 #include "Math/Box.h"
 #include "Math/Ray.h"
 #include "Math/Frustum.h"
 #include "Math/Intersection.h"
+#include "Math/Statistics.h"
+#include "Input/InputQueue.h"
+#include "Input/InputRecording.h"
+#include "Jobs/FramePipeline.h"
+#include "Jobs/JobSystem.h"
+#include "Render/ColumnRenderer.h"
+#include "Render/GLRenderBackend.h"
+#include "Render/OcclusionBuffer.h"
+#include "Render/RenderQueue.h"
+#include "Render/SoftwareRenderBackend.h"
+#include "Time/FrameLimiter.h"
+#include "World/Map.h"
+#include "World/MapFile.h"
+#include "World/PortalWindows.h"
+#include "World/SectorLocator.h"
+#include "World/SectorMesh.h"
+#include "World/SectorPvs.h"
+#include "World/VisibilityCache.h"
 
 constexpr glm::vec3 kWorldUp      = glm::vec3(0.0f,  1.0f,  0.0f);
 constexpr glm::vec3 kWorldForward = glm::vec3(0.0f,  0.0f, -1.0f);
 constexpr glm::vec3 kWorldRight   = glm::vec3(1.0f,  0.0f,  0.0f);
 
-bool keys[1024];
-glm::vec2 mouseDelta;
+struct InputState
+{
+    // The keys held down, indexed by GLFW key code.
+    bool keys[1024];
+
+    // The mouse movement no simulation step applied yet.
+    glm::vec2 mouseDelta;
+};
+
+// The input callbacks push the live input as events stamped with the input clock when they are polled, and the
+// simulation takes them on its own thread.
+InputQueue inputQueue;
+
+// Returns the time on the clock live input events are stamped with, in seconds.
+double GetInputClock()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The live input is added to the recording while recording is on, timed on the input clock from the start of the
+// recording, so recorded events keep the times the queue saw.
+InputRecording inputRecording;
+bool recordingInput = false;
+double recordingStartTime = 0.0;
 
 struct Camera
 {
@@ -71,6 +113,49 @@ struct Face
     std::vector<glm::vec3> vertices;
 };
 
+// What culling found for a visible sector.
+enum class SectorCullResult : uint8_t
+{
+    Outside,
+    Occluded,
+    Visible
+};
+
+// Everything a frame hands from one pipeline stage to the next. The stages work on different frames at the same
+// time, each in a packet of its own.
+struct FramePacket
+{
+    int frameIndex;
+
+    // When the simulation of the frame started, from which the latency to its submission is measured.
+    std::chrono::steady_clock::time_point inputTime;
+
+    // The input clock time of the oldest live event the frame simulated, from which the latency until the frame is
+    // presented is measured, or a negative time if it simulated none.
+    double oldestEventTime;
+
+    // The camera as simulated for the frame.
+    Camera camera;
+    glm::mat4 projectionMatrix;
+    glm::mat4 viewMatrix;
+    int cameraSector;
+
+    // The visible sectors, added by the visibility stage and flushed by the submission stage.
+    RenderQueue renderQueue;
+
+    // The statistics of the visibility stage, printed when the frame is submitted.
+    int numVisibleSectors;
+    int numDrawnSectors;
+    FrustumCullStats cullStats;
+    int64_t boundsArea;
+    int64_t windowArea;
+    int numPortalsTested;
+    int numOccludeesTested;
+    int numOccludeesRejected;
+    int numVisibilityHits;
+    int numVisibilityMisses;
+};
+
 struct Image
 {
     int       width;
@@ -130,81 +215,44 @@ void GetQuadVertices(const Quad& quad, glm::vec3 vertices[4])
     vertices[3] = quad.center - halfR + halfU;
 }
 
-void DrawPoint(const glm::vec3& point, const glm::vec3& color = glm::vec3(1.0f), float size = 1.0f)
+void DrawPoint(RenderQueue& queue, const glm::vec3& point, const glm::vec3& color = glm::vec3(1.0f), float size = 1.0f)
 {
-    float currentPointSize = 0.0f;
-    glGetFloatv(GL_POINT_SIZE, &currentPointSize);
-
-    glPointSize(size);
-    glBegin(GL_POINTS);
-    glColor3f(color.r, color.g, color.b);
-    glVertex3f(point.x, point.y, point.z);
-    glEnd();
-
-    glPointSize(currentPointSize);
+    queue.AddPoints(&point, 1, color, size);
 }
 
-void DrawPoints(const glm::vec3* points, size_t count, const glm::vec3& color = glm::vec3(1.0f), float size = 1.0f)
+void DrawPoints(RenderQueue& queue, const glm::vec3* points, size_t count, const glm::vec3& color = glm::vec3(1.0f), float size = 1.0f)
 {
-    float currentPointSize = 0.0f;
-    glGetFloatv(GL_POINT_SIZE, &currentPointSize);
-
-    glPointSize(size);
-    glBegin(GL_POINTS);
-    glColor3f(color.r, color.g, color.b);
-    for (size_t i = 0; i < count; i++)
-    {
-        glVertex3f(points[i].x, points[i].y, points[i].z);
-    }
-    glEnd();
-
-    glPointSize(currentPointSize);
+    queue.AddPoints(points, (int)count, color, size);
 }
 
-void DrawLine(const glm::vec3& start, const glm::vec3& end, const glm::vec3& color = glm::vec3(1.0f), float width = 1.0f)
+void DrawLine(RenderQueue& queue, const glm::vec3& start, const glm::vec3& end, const glm::vec3& color = glm::vec3(1.0f), float width = 1.0f)
 {
-    float currentLineWidth = 0.0f;
-    glGetFloatv(GL_LINE_WIDTH, &currentLineWidth);
-
-    glLineWidth(width);
-    glBegin(GL_LINES);
-    glColor3f(color.r, color.g, color.b);
-    glVertex3f(start.x, start.y, start.z);
-    glVertex3f(end.x, end.y, end.z);
-    glEnd();
-
-    glLineWidth(currentLineWidth);
+    glm::vec3 points[2] = { start, end };
+    queue.AddLines(points, 2, color, width);
 }
 
-void DrawQuad(const Quad& quad, const glm::vec3& color = glm::vec3(1.0f))
+void DrawQuad(RenderQueue& queue, const Quad& quad, const glm::vec3& color = glm::vec3(1.0f))
 {
     glm::vec3 v[4];
     GetQuadVertices(quad, v);
 
-    glBegin(GL_TRIANGLE_FAN);
-    glColor3f(color.r, color.g, color.b);
-    glVertex3f(v[0].x, v[0].y, v[0].z);
-    glVertex3f(v[1].x, v[1].y, v[1].z);
-    glVertex3f(v[2].x, v[2].y, v[2].z);
-    glVertex3f(v[3].x, v[3].y, v[3].z);
-    glEnd();
+    Vertex vertices[4];
+    for (int i = 0; i < 4; i++)
+    {
+        vertices[i] = { v[i], glm::vec2(0.0f), color };
+    }
+    queue.AddPolygon(vertices, 4);
 }
 
-void DrawQuadLines(const Quad& quad, const glm::vec3& color = glm::vec3(1.0f))
+void DrawQuadLines(RenderQueue& queue, const Quad& quad, const glm::vec3& color = glm::vec3(1.0f))
 {
     glm::vec3 v[4];
     GetQuadVertices(quad, v);
 
-    glBegin(GL_LINE_LOOP);
-    glColor3f(color.r, color.g, color.b);
-    glVertex3f(v[0].x, v[0].y, v[0].z);
-    glVertex3f(v[1].x, v[1].y, v[1].z);
-    glVertex3f(v[2].x, v[2].y, v[2].z);
-    glVertex3f(v[3].x, v[3].y, v[3].z);
-    glEnd();
+    queue.AddLineLoop(v, 4, color, 1.0f);
 }
 
-void DrawBoxLines(const Box& box, const glm::vec3& color = glm::vec3(1.0f))
+void DrawBoxLines(RenderQueue& queue, const Box& box, const glm::vec3& color = glm::vec3(1.0f))
 {
     std::array<glm::vec3, 8> v;
     box.GetCornerPoints(v);
@@ -224,43 +272,31 @@ void DrawBoxLines(const Box& box, const glm::vec3& color = glm::vec3(1.0f))
         6, 4,
     };
 
-    glBegin(GL_LINES);
-    glColor3f(color.r, color.g, color.b);
-
+    glm::vec3 points[24];
     for (int i = 0; i < 24; i++)
     {
-        glVertex3f(v[indices[i]].x, v[indices[i]].y, v[indices[i]].z);
+        points[i] = v[indices[i]];
     }
-    glEnd();
+    queue.AddLines(points, 24, color, 1.0f);
 }
 
-void DrawPolygon(const glm::vec3* vertices, int numVertices, const glm::vec3& color = glm::vec3(1.0f))
+void DrawPolygon(RenderQueue& queue, const glm::vec3* vertices, int numVertices, const glm::vec3& color = glm::vec3(1.0f))
 {
-    glBegin(GL_TRIANGLE_FAN);
-    glColor3f(color.r, color.g, color.b);
+    std::vector<Vertex> polygon(numVertices);
     for (int i = 0; i < numVertices; i++)
     {
-        glVertex3f(vertices[i].x, vertices[i].y, vertices[i].z);
+        polygon[i] = { vertices[i], glm::vec2(0.0f), color };
     }
-    glEnd();
+    queue.AddPolygon(polygon.data(), numVertices);
 }
 
-void DrawPolygonLines(const glm::vec3* vertices, int numVertices, const glm::vec3& color = glm::vec3(1.0f))
+void DrawPolygonLines(RenderQueue& queue, const glm::vec3* vertices, int numVertices, const glm::vec3& color = glm::vec3(1.0f))
 {
-    glBegin(GL_LINE_LOOP);
-    glColor3f(color.r, color.g, color.b);
-    for (int i = 0; i < numVertices; i++)
-    {
-        glVertex3f(vertices[i].x, vertices[i].y, vertices[i].z);
-    }
-    glEnd();
+    queue.AddLineLoop(vertices, numVertices, color, 1.0f);
 }
 
-void DrawTexturedPolygon(const std::vector<glm::vec3>& vertices, int textureIndex)
+void DrawTexturedPolygon(RenderQueue& queue, const std::vector<glm::vec3>& vertices, int textureIndex)
 {
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, textureIndex);
-
     glm::vec2 uvs[] = {
         glm::vec2(0.0f, 0.0f),
         glm::vec2(1.0f, 0.0f),
@@ -268,19 +304,15 @@ void DrawTexturedPolygon(const std::vector<glm::vec3>& vertices, int textureInde
         glm::vec2(0.0f, 1.0f),
     };
 
-    glBegin(GL_TRIANGLE_FAN);
-    glColor3f(1.0f, 1.0f, 1.0f);
+    Vertex polygon[4];
     for (int i = 0; i < vertices.size(); i++)
     {
-        glTexCoord2f(uvs[i].s, uvs[i].t);
-        glVertex3f(vertices[i].x, vertices[i].y, vertices[i].z);
+        polygon[i] = { vertices[i], uvs[i], glm::vec3(1.0f) };
     }
-    glEnd();
-
-    glDisable(GL_TEXTURE_2D);
+    queue.AddPolygon(polygon, (int)vertices.size(), textureIndex);
 }
 
-void DrawTexturedFace(const Face& face, Texture texture)
+void DrawTexturedFace(RenderQueue& queue, const Face& face, Texture texture)
 {
     glm::vec3 min = glm::vec3(FLT_MAX);
     glm::vec3 max = glm::vec3(-FLT_MAX);
@@ -294,12 +326,7 @@ void DrawTexturedFace(const Face& face, Texture texture)
     float width = glm::abs(glm::dot(face.uAxis, max - min));
     float height = glm::abs(glm::dot(face.vAxis, max - min));
 
-
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, texture.id);
-
-    glBegin(GL_TRIANGLE_FAN);
-    glColor3f(1.0f, 1.0f, 1.0f);
+    std::vector<Vertex> polygon(face.vertices.size());
     for (int i = 0; i < face.vertices.size(); i++)
     {
         // FIX THIS!!!
@@ -322,12 +349,9 @@ void DrawTexturedFace(const Face& face, Texture texture)
         u = (u == 0.0f) * pw + u - (u == 1.0f) * pw;
         v = (v == 0.0f) * ph + v - (v == 1.0f) * ph;
 
-        glTexCoord2f(u, v);
-        glVertex3f(face.vertices[i].x, face.vertices[i].y, face.vertices[i].z);
+        polygon[i] = { face.vertices[i], glm::vec2(u, v), glm::vec3(1.0f) };
     }
-    glEnd();
-
-    glDisable(GL_TEXTURE_2D);
+    queue.AddPolygon(polygon.data(), (int)polygon.size(), texture.id);
 }
 
 bool RayQuadIntersection(const Ray& ray, const Quad& quad, glm::vec3& point)
@@ -392,7 +416,7 @@ float Lerp(float a, float b, float t)
     return a + (b - a) * t;
 }
 
-void UpdateCameraMovement(Camera& camera, Movement& movement, float dt)
+void UpdateCameraMovement(Camera& camera, Movement& movement, const InputState& input, float dt)
 {
     glm::vec3 forward = GetForwardVector(GetCameraRotation(camera));
     glm::vec3 right = GetRightVector(GetCameraRotation(camera));
@@ -401,32 +425,32 @@ void UpdateCameraMovement(Camera& camera, Movement& movement, float dt)
 
     float speedBump = 1.0f;
 
-    if (keys[GLFW_KEY_LEFT_SHIFT])
+    if (input.keys[GLFW_KEY_LEFT_SHIFT])
     {
         speedBump = 2.0f;
     }
 
-    if (keys[GLFW_KEY_W])
+    if (input.keys[GLFW_KEY_W])
     {
         acceleration += forward;
     }
-    if (keys[GLFW_KEY_S])
+    if (input.keys[GLFW_KEY_S])
     {
         acceleration -= forward;
     }
-    if (keys[GLFW_KEY_A])
+    if (input.keys[GLFW_KEY_A])
     {
         acceleration -= right;
     }
-    if (keys[GLFW_KEY_D])
+    if (input.keys[GLFW_KEY_D])
     {
         acceleration += right;
     }
-    if (keys[GLFW_KEY_E])
+    if (input.keys[GLFW_KEY_E])
     {
         acceleration += kWorldUp;
     }
-    if (keys[GLFW_KEY_Q])
+    if (input.keys[GLFW_KEY_Q])
     {
         acceleration -= kWorldUp;
     }
@@ -445,26 +469,38 @@ void UpdateCameraMovement(Camera& camera, Movement& movement, float dt)
     camera.position += movement.velocity * dt;
 
     float smoothFactor = 0.1f; // Adjust this value to your liking
-    camera.yaw   = Lerp(camera.yaw  , camera.yaw   - mouseDelta.x, smoothFactor);
-    camera.pitch = Lerp(camera.pitch, camera.pitch - mouseDelta.y, smoothFactor);
+    camera.yaw   = Lerp(camera.yaw  , camera.yaw   - input.mouseDelta.x, smoothFactor);
+    camera.pitch = Lerp(camera.pitch, camera.pitch - input.mouseDelta.y, smoothFactor);
+}
+
+// Returns the camera between the given states, at t from 0 for the first to 1 for the second.
+Camera InterpolateCamera(const Camera& from, const Camera& to, float t)
+{
+    Camera camera = to;
+    camera.position = glm::mix(from.position, to.position, t);
+    camera.pitch = Lerp(from.pitch, to.pitch, t);
+    camera.yaw = Lerp(from.yaw, to.yaw, t);
+    camera.roll = Lerp(from.roll, to.roll, t);
+    return camera;
 }
 
-GLuint CreateTextureFromImage(const uint32_t* pixels, int width, int height)
+// Applies the queued live events that happened before the given time to the input, and keeps the time of the
+// first one applied in the given oldest time if that is still negative.
+void ConsumeInput(InputQueue& queue, double endTime, InputState& input, double& oldestEventTime)
 {
-    GLuint texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, GL_FALSE, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    for (const InputEvent* event = queue.Peek(); event && event->time < endTime; event = queue.Peek())
+    {
+        if (oldestEventTime < 0.0)
+        {
+            oldestEventTime = event->time;
+        }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    return texture;
+        ApplyInputEvent(*event, input.keys, 1024, input.mouseDelta);
+        queue.Pop();
+    }
 }
 
-void DrawQuadFromLine(const glm::vec3& v1, const glm::vec3& v2, float floorHeight, float ceilingHeight, const glm::vec3& color = glm::vec3(1.0f))
+void DrawQuadFromLine(RenderQueue& queue, const glm::vec3& v1, const glm::vec3& v2, float floorHeight, float ceilingHeight, const glm::vec3& color = glm::vec3(1.0f))
 {
     glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
     glm::vec3 right = glm::normalize(glm::cross(v2 - v1, up));
@@ -476,13 +512,12 @@ void DrawQuadFromLine(const glm::vec3& v1, const glm::vec3& v2, float floorHeigh
         v1 + up * floorHeight
     };
 
-    glBegin(GL_TRIANGLE_FAN);
-    glColor3f(color.r, color.g, color.b);
-    glVertex3f(v[0].x, v[0].y, v[0].z);
-    glVertex3f(v[1].x, v[1].y, v[1].z);
-    glVertex3f(v[2].x, v[2].y, v[2].z);
-    glVertex3f(v[3].x, v[3].y, v[3].z);
-    glEnd();
+    Vertex vertices[4];
+    for (int i = 0; i < 4; i++)
+    {
+        vertices[i] = { v[i], glm::vec2(0.0f), color };
+    }
+    queue.AddPolygon(vertices, 4);
 }
 
 // Creates a box that encloses all the vertices of a quad and adds padding
@@ -507,33 +542,44 @@ Box GetQuadBoundingBox(const Quad& quad, float padding)
     return box;
 }
 
-bool PointInPolygon(const glm::vec3& point, const glm::vec3* vertices, int numVertices);
-
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <fstream>
+#include <memory>
 #include <sstream>
 #include <string>
 
-int main(int argc, char** argv)
+// Copies the given top-down RGBA pixels to the back buffer.
+void PresentPixels(const uint32_t* pixels, int width, int height)
 {
-    GLFWwindow* window;
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+
+    glDisable(GL_DEPTH_TEST);
+    glViewport(0, 0, width, height);
+    glRasterPos2f(-1.0f, 1.0f);
+    glPixelZoom(1.0f, -1.0f);
+    glDrawPixels(width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+}
 
+GLFWwindow* CreateMainWindow(int windowWidth, int windowHeight)
+{
     if (!glfwInit())
     {
-        return -1;
+        return nullptr;
     }
 
-    int windowWidth = 640;
-    int windowHeight = 480;
-
     /* Create a windowed mode window and its OpenGL context */
-    window = glfwCreateWindow(windowWidth, windowHeight, "Hello World", NULL, NULL);
+    GLFWwindow* window = glfwCreateWindow(windowWidth, windowHeight, "Hello World", NULL, NULL);
 
     if (!window)
     {
         glfwTerminate();
-        return -1;
+        return nullptr;
     }
 
     /* Make the window's context current */
@@ -545,18 +591,23 @@ int main(int argc, char** argv)
     glfwSetCursorPos(window, windowWidth / 2, windowHeight / 2);
 
     glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
-        if (action == GLFW_PRESS)
+        if (action == GLFW_PRESS && key == GLFW_KEY_ESCAPE)
         {
-            if (key == GLFW_KEY_ESCAPE)
-            {
-                glfwSetWindowShouldClose(window, GLFW_TRUE);
-            }
-
-            keys[key] = true;
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
         }
-        else if (action == GLFW_RELEASE)
+
+        if (action != GLFW_REPEAT)
         {
-            keys[key] = false;
+            InputEvent event = {};
+            event.time = GetInputClock();
+            event.type = action == GLFW_PRESS ? InputEventType::KeyDown : InputEventType::KeyUp;
+            event.key = key;
+            inputQueue.Push(event);
+
+            if (recordingInput)
+            {
+                inputRecording.AddKey(event.time - recordingStartTime, key, action == GLFW_PRESS);
+            }
         }
     });
 
@@ -578,38 +629,28 @@ int main(int argc, char** argv)
         lastX = xpos;
         lastY = ypos;
 
-        mouseDelta.x = (float)deltaX;
-        mouseDelta.y = (float)deltaY;
-    });
-
+        // Several movements may arrive within one frame, and each is applied by the step it happened in.
+        InputEvent event = {};
+        event.time = GetInputClock();
+        event.type = InputEventType::MouseMove;
+        event.mouseDelta = glm::vec2((float)deltaX, (float)deltaY);
+        inputQueue.Push(event);
 
-    Camera camera = {};
-    camera.fov = 70.0f;
-    camera.aspect = 640.0f / 480.0f;
-    camera.near = 0.1f;
-    camera.far = 1000.0f;
-    camera.position = glm::vec3(2.0f, 1.0f, -3.0f);
-
-    Movement movement = {};
-    movement.speed = 10.0f;
-    movement.friction = 6.0f;
-    movement.mouseSensitivity = 0.1f;
+        if (recordingInput)
+        {
+            inputRecording.AddMouseMove(event.time - recordingStartTime, glm::vec2((float)deltaX, (float)deltaY));
+        }
+    });
 
-    struct Sector
-    {
-        int firstWall;
-        int numWalls;
-        float floorHeight;
-        float ceilingHeight;
-    };
+    return window;
+}
 
-    struct Wall
-    {
-        int v[2];
-        int sector;
-    };
+// Creates the small test level used when no map is given.
+Map CreateStartMap()
+{
+    Map map;
 
-    std::vector<glm::vec2> wallVertices = {
+    map.wallVertices = {
         glm::vec2( 0.0f, 0.0f),
         glm::vec2( 4.0f, 0.0f),
         glm::vec2( 5.0f, 2.0f),
@@ -624,14 +665,14 @@ int main(int argc, char** argv)
         glm::vec2( 9.0f, 3.0f)
     };
 
-    std::vector<Sector> sectors = {
+    map.sectors = {
         {  0, 6,  0.0f, 3.0f },
         {  6, 4, 0.25f, 2.0f },
         { 10, 4,  0.5f, 3.0f },
         { 14, 4,  0.75f, 3.0f }
     };
 
-    std::vector<Wall> walls = {
+    map.walls = {
         { {  0,  1 }, -1 },
         { {  1,  2 }, -1 },
         { {  2,  5 },  1 },
@@ -652,234 +693,784 @@ int main(int argc, char** argv)
         { { 11,  8 },  2 },
     };
 
-    glm::vec3 randomColors[16] = {
-        glm::vec3(0.6f, 0.8f, 0.8f),
-        glm::vec3(0.7f, 0.7f, 1.0f),
-        glm::vec3(0.6f, 0.8f, 0.7f),
-        glm::vec3(0.7f, 0.9f, 0.9f),
-        glm::vec3(0.7f, 1.0f, 1.0f),
-        glm::vec3(0.8f, 0.6f, 0.8f),
-        glm::vec3(0.8f, 0.6f, 1.0f),
-        glm::vec3(1.0f, 0.6f, 1.0f),
-        glm::vec3(0.8f, 0.6f, 0.8f),
-        glm::vec3(0.9f, 0.5f, 0.7f),
-        glm::vec3(0.8f, 0.8f, 0.7f),
-        glm::vec3(0.8f, 0.7f, 0.5f),
-        glm::vec3(0.9f, 0.7f, 0.9f),
-        glm::vec3(0.5f, 1.0f, 0.7f),
-        glm::vec3(0.7f, 1.0f, 0.8f),
-        glm::vec3(0.8f, 0.9f, 0.7f)
-    };
+    map.ComputeSectorBounds();
+    return map;
+}
+
+// Writes the given frame times and input latencies in milliseconds and their percentiles to the given JSON file.
+bool WriteFrameTimes(const char* path, const std::vector<double>& frameTimes, const std::vector<double>& latencies, int numFramePackets)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
 
-    auto PointInSector = [=](const glm::vec3& point, const Sector& sector) {
+    std::vector<double> sortedTimes = frameTimes;
+    std::sort(sortedTimes.begin(), sortedTimes.end());
 
-        std::vector<glm::vec3> vertices;
+    std::vector<double> sortedLatencies = latencies;
+    std::sort(sortedLatencies.begin(), sortedLatencies.end());
 
-        for (int i = 0; i < sector.numWalls; ++i)
+    double total = 0.0;
+    for (double frameTime : frameTimes)
+    {
+        total += frameTime;
+    }
+
+    double totalLatency = 0.0;
+    for (double latency : latencies)
+    {
+        totalLatency += latency;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "    \"unit\": \"ms\",\n");
+    fprintf(file, "    \"frames\": %d,\n", (int)frameTimes.size());
+    fprintf(file, "    \"mean\": %.4f,\n", frameTimes.empty() ? 0.0 : total / frameTimes.size());
+    fprintf(file, "    \"min\": %.4f,\n", sortedTimes.empty() ? 0.0 : sortedTimes.front());
+    fprintf(file, "    \"max\": %.4f,\n", sortedTimes.empty() ? 0.0 : sortedTimes.back());
+    fprintf(file, "    \"p50\": %.4f,\n", Math::GetPercentile(sortedTimes, 50.0));
+    fprintf(file, "    \"p95\": %.4f,\n", Math::GetPercentile(sortedTimes, 95.0));
+    fprintf(file, "    \"p99\": %.4f,\n", Math::GetPercentile(sortedTimes, 99.0));
+    fprintf(file, "    \"framePackets\": %d,\n", numFramePackets);
+    fprintf(file, "    \"latencyMean\": %.4f,\n", latencies.empty() ? 0.0 : totalLatency / latencies.size());
+    fprintf(file, "    \"latencyP50\": %.4f,\n", Math::GetPercentile(sortedLatencies, 50.0));
+    fprintf(file, "    \"latencyP95\": %.4f,\n", Math::GetPercentile(sortedLatencies, 95.0));
+    fprintf(file, "    \"latencyP99\": %.4f,\n", Math::GetPercentile(sortedLatencies, 99.0));
+    fprintf(file, "    \"frameTimes\": [");
+    for (size_t i = 0; i < frameTimes.size(); ++i)
+    {
+        fprintf(file, "%s%.4f", i > 0 ? ", " : "", frameTimes[i]);
+    }
+    fprintf(file, "],\n");
+    fprintf(file, "    \"latencies\": [");
+    for (size_t i = 0; i < latencies.size(); ++i)
+    {
+        fprintf(file, "%s%.4f", i > 0 ? ", " : "", latencies[i]);
+    }
+    fprintf(file, "]\n}\n");
+
+    return fclose(file) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    // Headless runs render with the software backend and never open a window.
+    bool headless = false;
+    const char* imagePath = "frame.png";
+
+    // The number of headless frames, or -1 to run 60 frames or as many as the replayed input lasts.
+    int numHeadlessFrames = -1;
+
+    // Live input is recorded to the record path. Replaying input runs headless, stepping the recorded events with
+    // the fixed headless time step, and the frame times of headless runs can be written as JSON for comparisons.
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    const char* jsonPath = nullptr;
+
+    // The zones and counters of the last frames are written to the trace path on exit, when the profiler is built in.
+    const char* tracePath = nullptr;
+
+    // The column renderer draws the map directly, without the render queue and its backends.
+    bool columnRenderer = false;
+
+    // Counts the pixels the column renderer writes more than once, which it never should. Costs a write per pixel.
+    bool checkOverdraw = false;
+
+    // The map to play, a binary or text map file, or null for the built-in start map.
+    const char* mapPath = nullptr;
+
+    // The number of threads running jobs, or 0 for one per hardware thread.
+    int numThreads = 0;
+
+    // The number of frame packets handed through the simulation, visibility and submission stages. One packet runs
+    // the stages one after another on the main thread; every further packet lets the simulation run a frame further
+    // ahead of the submission, overlapping the stages at the cost of a frame of input latency.
+    int numFramePackets = 2;
+
+    // The number of frames per second the frame limiter keeps to, or 0 to run as fast as possible. Windowed runs
+    // default to a limit, since swapping does not wait for the display, and headless runs to none.
+    double framesPerSecond = -1.0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+        {
+            headless = true;
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            numHeadlessFrames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--image") == 0 && i + 1 < argc)
+        {
+            imagePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--map") == 0 && i + 1 < argc)
+        {
+            mapPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--renderer") == 0 && i + 1 < argc)
+        {
+            columnRenderer = strcmp(argv[++i], "column") == 0;
+        }
+        else if (strcmp(argv[i], "--overdraw") == 0)
+        {
+            checkOverdraw = true;
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
         {
-            const Wall& wall = walls[sector.firstWall + i];
+            recordPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            replayPath = argv[++i];
+            headless = true;
+        }
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+        {
+            jsonPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            tracePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            numThreads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc)
+        {
+            numFramePackets = std::clamp(atoi(argv[++i]), 1, 3);
+        }
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+        {
+            framesPerSecond = std::max(atof(argv[++i]), 0.0);
+        }
+    }
+
+    PROFILE_THREAD_NAME("Main");
+
+    // Loading, culling and rasterizing spread their work over the same workers.
+    JobSystem jobs(numThreads);
 
-            glm::vec2 v[2] = {
-                wallVertices[wall.v[0]],
-                wallVertices[wall.v[1]]
-            };
+    // The simulation always steps with a fixed delta time, so movement does not depend on the frame rate. Headless
+    // frames advance the clock by one step each, so every run renders the same images.
+    constexpr float kFixedDeltaTime = 1.0f / 60.0f;
 
-            glm::vec3 v3[2] = {
-                glm::vec3(v[0].x, 0.0f, -v[0].y),
-                glm::vec3(v[1].x, 0.0f, -v[1].y)
-            };
+    // Windowed frames longer than this only advance the simulation this much, so a stall does not leave it stepping
+    // for longer than it can catch up with.
+    constexpr double kMaxFrameTime = 0.25;
 
-            vertices.push_back(v3[0]);
+    // The frame rate windowed runs are limited to unless another one is given.
+    constexpr double kDefaultFramesPerSecond = 120.0;
+
+    size_t replayEvent = 0;
+    if (replayPath)
+    {
+        if (!inputRecording.Load(replayPath))
+        {
+            printf("Failed to load input %s\n", replayPath);
+            return -1;
         }
 
-        return PointInPolygon(point, vertices.data(), vertices.size());
-    };
+        if (numHeadlessFrames < 0)
+        {
+            numHeadlessFrames = (int)(inputRecording.GetDuration() / kFixedDeltaTime) + 1;
+        }
+    }
+
+    if (numHeadlessFrames < 0)
+    {
+        numHeadlessFrames = 60;
+    }
+
+    if (framesPerSecond < 0.0)
+    {
+        framesPerSecond = headless ? 0.0 : kDefaultFramesPerSecond;
+    }
+
+    int windowWidth = 640;
+    int windowHeight = 480;
 
-    int wallIndex = 0;
+    GLFWwindow* window = nullptr;
 
-    int drawnSectors = 0;
-    auto DrawSector = [&](const Sector& sector)
+    if (!headless)
     {
+        window = CreateMainWindow(windowWidth, windowHeight);
+
+        if (!window)
+        {
+            return -1;
+        }
+
+        if (recordPath)
+        {
+            recordingInput = true;
+            recordingStartTime = GetInputClock();
+        }
+    }
 
+    Camera camera = {};
+    camera.fov = 70.0f;
+    camera.aspect = 640.0f / 480.0f;
+    camera.near = 0.1f;
+    camera.far = 1000.0f;
+    camera.position = glm::vec3(2.0f, 1.0f, -3.0f);
+
+    Movement movement = {};
+    movement.speed = 10.0f;
+    movement.friction = 6.0f;
+    movement.mouseSensitivity = 0.1f;
+
+    // Maps given on the command line are used in place from their mapped file; text maps are loaded into memory.
+    MapFile mapFile;
+    Map textMap;
+    Map startMap = CreateStartMap();
+    const Map* loadedMap = &startMap;
+
+    if (mapPath)
+    {
+        if (mapFile.Open(mapPath))
+        {
+            loadedMap = &mapFile.map;
+        }
+        else if (textMap.LoadText(mapPath))
+        {
+            loadedMap = &textMap;
+        }
+        else
+        {
+            printf("Failed to load map %s\n", mapPath);
+            return -1;
+        }
+    }
+
+    const Map& map = *loadedMap;
+
+    SectorLocator locator;
+    locator.Build(map);
+
+    // Other maps start at the centre of their first sector. Concave sectors may not hold their centre, in which case
+    // the centre of the largest triangle of the sector is used instead.
+    if (mapPath && !map.sectors.empty())
+    {
+        const Sector& sector = map.sectors[0];
+        std::vector<glm::vec2> vertices;
+        glm::vec2 center = glm::vec2(0.0f);
         for (int i = 0; i < sector.numWalls; ++i)
         {
-            const Wall& wall = walls[sector.firstWall + i];
-            glm::vec2 v2[2] = { wallVertices[wall.v[0]], wallVertices[wall.v[1]] };
-            glm::vec3 v3[2] = { glm::vec3(v2[0].x, 0.0f, -v2[0].y), glm::vec3(v2[1].x, 0.0f, -v2[1].y) };
+            vertices.push_back(map.wallVertices[map.walls[sector.firstWall + i].v[0]]);
+            center += vertices.back();
+        }
+        center /= (float)glm::max(sector.numWalls, 1);
+        camera.position = glm::vec3(center.x, sector.floorHeight + 1.0f, -center.y);
+
+        std::vector<int> triangles;
+        if (!locator.ContainsPoint(0, camera.position) && TriangulatePolygon(vertices.data(), (int)vertices.size(), triangles))
+        {
+            float largestArea = -1.0f;
+            for (size_t i = 0; i + 2 < triangles.size(); i += 3)
+            {
+                const glm::vec2& a = vertices[triangles[i]];
+                const glm::vec2& b = vertices[triangles[i + 1]];
+                const glm::vec2& c = vertices[triangles[i + 2]];
+                float area = glm::abs((b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y));
+                if (area > largestArea)
+                {
+                    center = (a + b + c) / 3.0f;
+                    largestArea = area;
+                }
+            }
+            camera.position = glm::vec3(center.x, sector.floorHeight + 1.0f, -center.y);
+        }
+    }
 
-            glm::vec3 normal = glm::normalize(glm::cross(v3[1] - v3[0], glm::vec3(0.0f, 1.0f, 0.0f)));
+    SectorMesh sectorMesh;
+    sectorMesh.Build(map, &jobs);
 
-            glm::vec3 color = randomColors[wallIndex++ % 16];
-            color = glm::vec3(glm::dot(glm::vec3(0.8f, 0.65f, 0.9f), glm::abs(normal)));
-            if (wall.sector != -1)
+    // Sectors are culled under the world bounds, remembering the plane that rejected each one last frame.
+    Box worldBounds;
+    for (const SectorMeshRange& range : sectorMesh.ranges)
+    {
+        worldBounds += range.bounds;
+    }
+    uint8_t worldRejectPlane = 0;
+    std::vector<uint8_t> sectorRejectPlanes(sectorMesh.ranges.size(), 0);
+
+    // When the camera leaves the map no portal leads anywhere, so the bounds of all sectors are classified in one
+    // batch instead.
+    BoxArray sectorBoxes;
+    sectorBoxes.Reserve(sectorMesh.ranges.size());
+    for (const SectorMeshRange& range : sectorMesh.ranges)
+    {
+        sectorBoxes.Add(range.bounds);
+    }
+    std::vector<CullResult> sectorBoxResults(sectorMesh.ranges.size());
+
+    // The visible sectors are culled in parallel runs of this many sectors, each run counting its own plane tests.
+    // The sectors that pass are drawn afterwards in the order they were found.
+    constexpr int kSectorsPerCullJob = 64;
+    std::vector<SectorCullResult> sectorCullResults;
+    std::vector<FrustumCullStats> cullJobStats;
+
+    std::unique_ptr<RenderBackend> renderBackend;
+    SoftwareRenderBackend* softwareBackend = nullptr;
+
+    if (headless)
+    {
+        softwareBackend = new SoftwareRenderBackend(windowWidth, windowHeight, &jobs);
+        renderBackend.reset(softwareBackend);
+    }
+    else
+    {
+        renderBackend = std::make_unique<GLRenderBackend>();
+    }
+
+    auto DrawSector = [&](FramePacket& packet, int sectorIndex, const ScreenRect& window)
+    {
+        const SectorMeshRange& range = sectorMesh.ranges[sectorIndex];
+        RenderState state = { PrimitiveType::Triangles, 0, 1.0f, window };
+        packet.renderQueue.Add(state, &sectorMesh.vertices[range.firstVertex], range.numVertices, &sectorMesh.indices[range.firstIndex], range.numIndices, range.firstVertex);
+
+        packet.numDrawnSectors++;
+    };
+
+    // The map is static, so the sets of sectors potentially visible from each sector are compiled once up front.
+    // Binary maps converted with --pvs come with their sets compiled, which are only used while the checksum of the
+    // map still matches; the sets of other maps are compiled on every start.
+    SectorPvs pvs;
+    if (mapFile.IsOpen() && pvs.Load(SectorPvs::GetPath(mapPath).c_str(), mapFile.GetHeader().checksum) && pvs.numSectors == (int)map.sectors.size())
+    {
+        printf("Loaded PVS %s\n", SectorPvs::GetPath(mapPath).c_str());
+    }
+    else
+    {
+        pvs.Build(map, &jobs);
+    }
+
+    // Small camera movements reuse the sectors found for a slightly wider view instead of traversing the portals again.
+    VisibilityCache visibility;
+    visibility.SetPvs(&pvs);
+    int cameraSector = -1;
+
+    // The screen rectangles the sectors are seen through are found every frame and scissor each sector's draws.
+    PortalWindows portalWindows;
+
+    ColumnRenderer columns(windowWidth, windowHeight);
+    columns.checkOverdraw = checkOverdraw;
+
+    // The geometry of visible sectors closer than this is rasterized as occluders before anything is submitted.
+    constexpr float kOccluderDistance = 16.0f;
+    OcclusionBuffer occlusionBuffer;
+
+    std::vector<double> frameTimes;
+    std::vector<double> frameLatencies;
+    frameTimes.reserve(headless ? numHeadlessFrames : 0);
+    frameLatencies.reserve(headless ? numHeadlessFrames : 0);
+    int frameIndex = 0;
+
+    // Writing to stdout blocks, so the statistics are only printed every this many frames. The profiler records
+    // them every frame.
+    constexpr int kStatsInterval = 60;
+
+    // The simulation keeps its own copy of the input, which replays step on their own so every frame simulates the
+    // same input however far the simulation runs ahead.
+    InputState input = {};
+    double lastSimulationTime = GetInputClock();
+
+    // The simulation runs ahead of the frame's time by the lag, less than a step, and the frame shows the camera
+    // interpolated back between the last two steps.
+    double simulationLag = 0.0;
+    Camera previousCamera = camera;
+
+    std::vector<FramePacket> packets(numFramePackets);
+
+    auto Simulate = [&](int simulatedFrame, int packetIndex)
+    {
+        FramePacket& packet = packets[packetIndex];
+        packet.frameIndex = simulatedFrame;
+        packet.inputTime = std::chrono::steady_clock::now();
+        packet.oldestEventTime = -1.0;
+
+        // Headless frames run on a clock of their own that advances a step per frame, on which replays are timed.
+        double currentTime = (simulatedFrame + 1) * (double)kFixedDeltaTime;
+        double frameTime = kFixedDeltaTime;
+
+        if (!headless)
+        {
+            currentTime = GetInputClock();
+            frameTime = std::min(currentTime - lastSimulationTime, kMaxFrameTime);
+            lastSimulationTime = currentTime;
+        }
+
+        simulationLag -= frameTime;
+
+        {
+            PROFILE_ZONE("Update");
+            while (simulationLag < 0.0)
             {
-                const Sector& otherSector = sectors[wall.sector];
-                if (otherSector.floorHeight > sector.floorHeight)
+                // Every step applies the events that happened up to its end, so input lands in the step it happened
+                // in instead of the first step of the frame.
+                double stepEnd = currentTime + (simulationLag + kFixedDeltaTime);
+                if (replayPath)
                 {
-                    DrawQuadFromLine(v3[0], v3[1], sector.floorHeight, otherSector.floorHeight, color);
+                    replayEvent = inputRecording.Replay(replayEvent, stepEnd, input.keys, 1024, input.mouseDelta);
                 }
-                if (otherSector.ceilingHeight < sector.ceilingHeight)
+                else if (!headless)
                 {
-                    DrawQuadFromLine(v3[0], v3[1], otherSector.ceilingHeight, sector.ceilingHeight, color);
+                    ConsumeInput(inputQueue, stepEnd, input, packet.oldestEventTime);
                 }
-                continue;
+
+                previousCamera = camera;
+                UpdateCameraMovement(camera, movement, input, kFixedDeltaTime);
+                simulationLag += kFixedDeltaTime;
+
+                // Each step turns the camera by the mouse movement applied to it, so the next one starts from zero.
+                input.mouseDelta = glm::vec2(0.0f);
             }
+        }
 
-            DrawQuadFromLine(v3[0], v3[1], sector.floorHeight, sector.ceilingHeight, color);
+        packet.camera = InterpolateCamera(previousCamera, camera, 1.0f - (float)(simulationLag / kFixedDeltaTime));
+    };
+
+    auto FindVisibleSectors = [&](int, int packetIndex)
+    {
+        FramePacket& packet = packets[packetIndex];
+        const Camera& frameCamera = packet.camera;
+
+        packet.projectionMatrix = GetProjection(frameCamera);
+        packet.viewMatrix = GetView(frameCamera);
+        packet.numVisibleSectors = 0;
+        packet.numDrawnSectors = 0;
+        packet.boundsArea = 0;
+        packet.windowArea = 0;
+
+        {
+            PROFILE_ZONE("Locate");
+            cameraSector = locator.Locate(frameCamera.position, cameraSector);
         }
+        packet.cameraSector = cameraSector;
 
-        std::vector<glm::vec3> vertices;
-        for (int i = 0; i < sector.numWalls; ++i)
+        // The column renderer finds the visible sectors itself while drawing.
+        if (columnRenderer)
         {
-            const Wall& wall = walls[sector.firstWall + i];
-            glm::vec2 v2[2] = { wallVertices[wall.v[0]], wallVertices[wall.v[1]] };
-            glm::vec3 v3[2] = { glm::vec3(v2[0].x, sector.floorHeight, -v2[0].y), glm::vec3(v2[1].x, sector.floorHeight, -v2[1].y) };
-            vertices.push_back(v3[0]);
+            return;
         }
 
-        glm::vec3 color = glm::vec3(glm::dot(glm::vec3(0.8f, 0.65f, 0.9f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        glm::mat4 viewProjection = packet.projectionMatrix * packet.viewMatrix;
+        Frustum frustum(viewProjection);
+        glm::vec3 forward = GetForwardVector(GetCameraRotation(frameCamera));
+        const std::vector<int>& visibleSectors = visibility.Update(map, cameraSector, frameCamera.position, forward, frameCamera.fov, frameCamera.aspect);
 
-        
-        DrawPolygon(vertices.data(), vertices.size(), color);
+        {
+            PROFILE_ZONE("Occluders");
+            occlusionBuffer.Begin(viewProjection);
+            for (int sectorIndex : visibleSectors)
+            {
+                const SectorMeshRange& range = sectorMesh.ranges[sectorIndex];
+                glm::vec3 closest = glm::clamp(frameCamera.position, range.bounds.min, range.bounds.max);
+                if (glm::distance(closest, frameCamera.position) < kOccluderDistance)
+                {
+                    occlusionBuffer.AddTriangles(sectorMesh.vertices.data(), &sectorMesh.indices[range.firstIndex], range.numIndices);
+                }
+            }
+            occlusionBuffer.BuildHierarchy();
+        }
 
-        std::reverse(vertices.begin(), vertices.end());
-        for (glm::vec3& vertex : vertices)
+        portalWindows.Compute(map, cameraSector, frameCamera.position, viewProjection, windowWidth, windowHeight);
+
+        FrustumCullStats& cullStats = packet.cullStats;
+        cullStats.Reset();
+        uint8_t worldMask = 0;
+        if (frustum.ClassifyBoxCoherent(worldBounds, kAllFrustumPlanes, worldRejectPlane, worldMask, cullStats) != CullResult::Outside)
         {
-            vertex.y = sector.ceilingHeight;
+            PROFILE_ZONE("Cull");
+
+            int numSectors = (int)visibleSectors.size();
+            int numRuns = (numSectors + kSectorsPerCullJob - 1) / kSectorsPerCullJob;
+            sectorCullResults.resize(numSectors);
+            cullJobStats.assign(numRuns, FrustumCullStats());
+
+            // Every sector has its own cached reject plane, so the runs never write to the same one.
+            jobs.ParallelFor(numRuns, 1, [&](int begin, int end) {
+                for (int run = begin; run < end; ++run)
+                {
+                    FrustumCullStats& stats = cullJobStats[run];
+                    for (int i = run * kSectorsPerCullJob; i < std::min((run + 1) * kSectorsPerCullJob, numSectors); ++i)
+                    {
+                        int sectorIndex = visibleSectors[i];
+                        const Box& bounds = sectorMesh.ranges[sectorIndex].bounds;
+                        uint8_t sectorMask = 0;
+
+                        if (portalWindows.windows[sectorIndex].IsEmpty() || frustum.ClassifyBoxCoherent(bounds, worldMask, sectorRejectPlanes[sectorIndex], sectorMask, stats) == CullResult::Outside)
+                        {
+                            sectorCullResults[i] = SectorCullResult::Outside;
+                        }
+                        else
+                        {
+                            sectorCullResults[i] = occlusionBuffer.TestBox(bounds) ? SectorCullResult::Visible : SectorCullResult::Occluded;
+                        }
+                    }
+                }
+            });
+
+            for (const FrustumCullStats& stats : cullJobStats)
+            {
+                cullStats += stats;
+            }
+
+            for (int i = 0; i < numSectors; ++i)
+            {
+                occlusionBuffer.numOccludeesTested += sectorCullResults[i] != SectorCullResult::Outside;
+                occlusionBuffer.numOccludeesRejected += sectorCullResults[i] == SectorCullResult::Occluded;
+
+                if (sectorCullResults[i] == SectorCullResult::Visible)
+                {
+                    int sectorIndex = visibleSectors[i];
+                    const Box& bounds = sectorMesh.ranges[sectorIndex].bounds;
+                    const ScreenRect& window = portalWindows.windows[sectorIndex];
+                    DrawSector(packet, sectorIndex, window);
+
+                    // The screen areas of the drawn sectors' bounds, on their own and clipped to their windows,
+                    // estimate how often each pixel is covered without and with the scissors.
+                    ScreenRect boundsRect = portalWindows.ProjectBox(bounds);
+                    packet.boundsArea += boundsRect.GetArea();
+                    packet.windowArea += boundsRect.Intersect(window).GetArea();
+                }
+            }
         }
-        DrawPolygon(vertices.data(), vertices.size(), color);
 
-        drawnSectors++;
+        // Outside the map every sector the frustum touches is drawn unclipped, relying on the depth test alone.
+        int numSectorsOutsideMap = 0;
+        if (cameraSector == -1)
+        {
+            PROFILE_ZONE("Cull all sectors");
+            frustum.ClassifyBoxes(sectorBoxes, sectorBoxResults.data());
+            for (int sectorIndex = 0; sectorIndex < (int)sectorBoxResults.size(); ++sectorIndex)
+            {
+                if (sectorBoxResults[sectorIndex] != CullResult::Outside)
+                {
+                    DrawSector(packet, sectorIndex, ScreenRect());
+                    numSectorsOutsideMap++;
+                }
+            }
+        }
+
+        packet.numVisibleSectors = (int)visibleSectors.size() + numSectorsOutsideMap;
+        packet.numPortalsTested = portalWindows.numPortalsTested;
+        packet.numOccludeesTested = occlusionBuffer.numOccludeesTested;
+        packet.numOccludeesRejected = occlusionBuffer.numOccludeesRejected;
+        packet.numVisibilityHits = visibility.numHits;
+        packet.numVisibilityMisses = visibility.numMisses;
     };
-    
-    std::function<void(const Sector&, std::vector<const Sector*>&)> MarkSectorsVisible = [&](const Sector& sector, std::vector<const Sector*>& visibleSectors)
+
+    // The input to photon latencies of the frames with live input since the statistics were last printed.
+    double photonLatencySum = 0.0;
+    double photonLatencyMax = 0.0;
+    int numPhotonLatencies = 0;
+
+    auto Submit = [&](int, int packetIndex)
     {
-        visibleSectors.push_back(&sector);
+        FramePacket& packet = packets[packetIndex];
+        const Camera& frameCamera = packet.camera;
 
-        for (int i = 0; i < sector.numWalls; ++i)
+        if (columnRenderer)
         {
-            const Wall& wall = walls[sector.firstWall + i];
+            glm::vec3 forward = GetForwardVector(GetCameraRotation(frameCamera));
+            columns.Render(map, packet.cameraSector, frameCamera.position, forward, frameCamera.fov);
 
-            glm::vec2 v2[2] = {
-                wallVertices[wall.v[0]],
-                wallVertices[wall.v[1]]
-            };
+            PROFILE_COUNTER("Drawn sectors", columns.numSectorsDrawn);
+            PROFILE_COUNTER("Pixel writes", columns.numPixelWrites);
 
-            glm::vec3 v3[2] = {
-                glm::vec3(v2[0].x, 0.0f, -v2[0].y),
-                glm::vec3(v2[1].x, 0.0f, -v2[1].y)
-            };
+            if (!headless)
+            {
+                PresentPixels(columns.GetPixels(), windowWidth, windowHeight);
+            }
+        }
+        else
+        {
+            RenderView view = { packet.projectionMatrix, packet.viewMatrix, windowWidth, windowHeight };
+            packet.renderQueue.Flush(*renderBackend, view);
+
+            PROFILE_COUNTER("Visible sectors", packet.numVisibleSectors);
+            PROFILE_COUNTER("Drawn sectors", packet.numDrawnSectors);
+            PROFILE_COUNTER("Portals tested", packet.numPortalsTested);
+            PROFILE_COUNTER("Frustum plane tests", packet.cullStats.numPlaneTests);
+            PROFILE_COUNTER("Occluded sectors", packet.numOccludeesRejected);
+            PROFILE_COUNTER("Draw calls", packet.renderQueue.numBatches);
+        }
 
-            glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-            glm::vec3 right = glm::normalize(glm::cross(v3[1] - v3[0], up));
-            glm::vec3 normal = glm::cross(right, up);
-            float ceilingHeight = 2.0f;
-            float floorHeight = 0.0f;
+        if (!headless)
+        {
+            PROFILE_ZONE("Present");
+            glfwSwapBuffers(window);
+        }
 
-            glm::vec3 v[4] = {
-                v3[0] + up * ceilingHeight,
-                v3[1] + up * ceilingHeight,
-                v3[1] + up * floorHeight,
-                v3[0] + up * floorHeight
-            };
+        // The latency runs from the simulation taking the input to the frame showing it being handed to the display.
+        std::chrono::duration<double, std::milli> latency = std::chrono::steady_clock::now() - packet.inputTime;
+        PROFILE_COUNTER("Input latency", latency.count());
+        if (headless)
+        {
+            frameLatencies.push_back(latency.count());
+        }
 
-            Box box(v, 4);
-            box.Expand(right * 0.05f);
+        // Input to photon runs from the oldest event the frame applied to the swap returning. The display shows the
+        // frame on its next refresh after that, which the program cannot see. Events are stamped when they are
+        // polled, which the limiter does while it sleeps, but events arriving while a frame is worked on are only
+        // stamped after it, so the latency can be short by up to the time the frame took.
+        if (packet.oldestEventTime >= 0.0)
+        {
+            double photonLatency = (GetInputClock() - packet.oldestEventTime) * 1000.0;
+            PROFILE_COUNTER("Input to photon", photonLatency);
+            photonLatencySum += photonLatency;
+            photonLatencyMax = std::max(photonLatencyMax, photonLatency);
+            numPhotonLatencies++;
+        }
 
-            if (wall.sector != -1)
+        if (packet.frameIndex % kStatsInterval == 0)
+        {
+            if (columnRenderer)
             {
-                if (std::find(visibleSectors.begin(), visibleSectors.end(), &sectors[wall.sector]) != visibleSectors.end())
+                printf("Sectors: %d, pixel writes: %d", columns.numSectorsDrawn, columns.numPixelWrites);
+                if (columns.checkOverdraw)
                 {
-                    continue;
+                    printf(", overdrawn pixels: %d", columns.numOverdrawnPixels);
                 }
-
-                glm::mat4 projectionMatrix = GetProjection(camera);
-                glm::mat4 viewMatrix = GetView(camera);
-                Frustum frustum(projectionMatrix * viewMatrix);
-
-                if (frustum.IntersectsBox(box))
+            }
+            else
+            {
+                float numPixels = (float)(windowWidth * windowHeight);
+                printf("Sectors: %d, plane tests: %d, saved: %d, visibility hits: %d/%d, occluded: %d/%d, overdraw estimate: %.2f -> %.2f", packet.numDrawnSectors, packet.cullStats.numPlaneTests, packet.cullStats.GetPlaneTestsSaved(), packet.numVisibilityHits, packet.numVisibilityHits + packet.numVisibilityMisses, packet.numOccludeesRejected, packet.numOccludeesTested, (float)packet.boundsArea / numPixels, (float)packet.windowArea / numPixels);
+                if (softwareBackend)
                 {
-                    MarkSectorsVisible(sectors[wall.sector], visibleSectors);
+                    printf(", overdraw: %.2f", (float)softwareBackend->GetNumFragments() / numPixels);
                 }
             }
+            printf(", latency: %.2f ms", latency.count());
+            if (numPhotonLatencies > 0)
+            {
+                printf(", input to photon from poll: avg %.2f ms, max %.2f ms", photonLatencySum / numPhotonLatencies, photonLatencyMax);
+            }
+            if (inputQueue.GetNumDropped() > 0)
+            {
+                printf(", input events dropped: %d", inputQueue.GetNumDropped());
+            }
+            printf("\n");
+
+            photonLatencySum = 0.0;
+            photonLatencyMax = 0.0;
+            numPhotonLatencies = 0;
         }
     };
-    
+
+    // The submission runs on the main thread, which owns the window and its context.
+    FramePipeline pipeline({ { "Simulate", Simulate }, { "Visibility", FindVisibleSectors }, { "Submit", Submit } }, numFramePackets);
+    auto lastFrameEnd = std::chrono::steady_clock::now();
+
+    // Swapping does not wait for the display, so the limiter paces the frames instead of vsync.
+    FrameLimiter frameLimiter(framesPerSecond);
 
     /* Loop until the user closes the window */
-    while (!glfwWindowShouldClose(window))
+    while (headless ? frameIndex < numHeadlessFrames : !glfwWindowShouldClose(window))
     {
-        // Calculate delta time
-        static double lastTime = glfwGetTime();
-        double currentTime = glfwGetTime();
-        float deltaTime = float(currentTime - lastTime);
-        lastTime = currentTime;
+        uint64_t frameStartAllocations = AllocationCounter::GetCount();
 
-        UpdateCameraMovement(camera, movement, deltaTime);
+        {
+            PROFILE_ZONE("Frame");
+            pipeline.RunFrame();
+        }
 
-        glm::mat4 projectionMatrix = GetProjection(camera);
-        glm::mat4 viewMatrix = GetView(camera);
+        // Once the pipeline is full a frame is submitted every time the slowest stage finishes one, so the frame time
+        // is the time between submissions.
+        auto frameEnd = std::chrono::steady_clock::now();
+        if (headless)
+        {
+            std::chrono::duration<double, std::milli> frameTime = frameEnd - lastFrameEnd;
+            frameTimes.push_back(frameTime.count());
+        }
+        lastFrameEnd = frameEnd;
 
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_CULL_FACE);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // Buffers grow to their steady state size in the first frames, after which a frame should not touch the
+        // heap at all. The count covers the other stages' threads as well.
+        uint64_t frameAllocations = AllocationCounter::GetCount() - frameStartAllocations;
+        PROFILE_COUNTER("Heap allocations", frameAllocations);
+        if (AllocationCounter::kEnabled && frameAllocations > 0)
+        {
+            printf("Frame %d: %d heap allocations\n", frameIndex, (int)frameAllocations);
+        }
 
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        glLoadMatrixf(glm::value_ptr(projectionMatrix));
-                
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
-        glLoadMatrixf(glm::value_ptr(viewMatrix));
-        
-        glViewport(0, 0, windowWidth, windowHeight);
+        // Events are stamped when they are polled, not when they happened, so the limiter polls after every slice it
+        // sleeps to stamp them within about a slice. The last poll comes after the wait, so the next frame simulates
+        // the newest input.
+        frameLimiter.Wait(headless ? nullptr : glfwPollEvents);
 
-        drawnSectors = 0;
-        wallIndex = 0;
+        if (frameIndex % kStatsInterval == kStatsInterval - 1)
+        {
+            FramePacingStats pacing = frameLimiter.TakeStats();
+            printf("Frame pacing: avg %.2f ms, jitter %.2f ms, max %.2f ms, CPU %.0f%%, asleep %.0f%%\n", pacing.meanFrameTime, pacing.jitter, pacing.maxFrameTime, pacing.cpuUsage * 100.0, pacing.sleepShare * 100.0);
+        }
 
+        frameIndex++;
 
-        std::vector<const Sector*> visibleSectors;
-        for (const Sector& sector : sectors)
+        if (!headless)
         {
-            if (PointInSector(camera.position, sector))
+            glfwPollEvents();
+        }
+    }
+
+    // The stages running ahead drop the frames they started.
+    pipeline.Stop();
+
+    if (tracePath && !Profiler::WriteChromeTrace(tracePath))
+    {
+        printf("Failed to write %s%s\n", tracePath, Profiler::kEnabled ? "" : ", the profiler is not compiled in");
+    }
+
+    if (headless)
+    {
+        if (!frameTimes.empty())
+        {
+            double total = 0.0;
+            for (double frameTime : frameTimes)
             {
-                MarkSectorsVisible(sector, visibleSectors);
-                break;
+                total += frameTime;
             }
-        }
 
+            std::vector<double> sortedTimes = frameTimes;
+            std::sort(sortedTimes.begin(), sortedTimes.end());
+            printf("Frames: %d, avg %.3f ms, min %.3f ms, max %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms\n", (int)frameTimes.size(), total / frameTimes.size(), sortedTimes.front(), sortedTimes.back(),
+                Math::GetPercentile(sortedTimes, 50.0), Math::GetPercentile(sortedTimes, 95.0), Math::GetPercentile(sortedTimes, 99.0));
+
+            std::vector<double> sortedLatencies = frameLatencies;
+            std::sort(sortedLatencies.begin(), sortedLatencies.end());
+            printf("Input latency: %d frame packets, %d frames ahead, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms\n", pipeline.GetNumPackets(), pipeline.GetFramesAhead(),
+                Math::GetPercentile(sortedLatencies, 50.0), Math::GetPercentile(sortedLatencies, 95.0), Math::GetPercentile(sortedLatencies, 99.0));
+        }
 
-        for (const Sector* sector : visibleSectors)
+        if (jsonPath && !WriteFrameTimes(jsonPath, frameTimes, frameLatencies, numFramePackets))
         {
-            DrawSector(*sector);
+            printf("Failed to write %s\n", jsonPath);
+            return -1;
         }
-        printf("Sectors: %d\n", drawnSectors);
 
+        bool written = columnRenderer ? columns.WriteImage(imagePath) : softwareBackend->WriteImage(imagePath);
+        if (!written)
+        {
+            printf("Failed to write %s\n", imagePath);
+            return -1;
+        }
 
-        glfwSwapBuffers(window);
+        return 0;
+    }
 
-        mouseDelta = glm::vec2(0.0f);
-        glfwPollEvents();
+    if (recordPath && !inputRecording.Save(recordPath))
+    {
+        printf("Failed to write %s\n", recordPath);
     }
 
     glfwTerminate();
     return 0;
 }
 
-
-
-bool PointInPolygon(const glm::vec3& point, const glm::vec3* vertices, int numVertices)
-{
-    glm::vec3 p = point;
-
-    int i, j, c = 0;
-    for (i = 0, j = numVertices - 1; i < numVertices; j = i++)
-    {
-        if (((vertices[i].z > p.z) != (vertices[j].z > p.z)) &&
-            (p.x < (vertices[j].x - vertices[i].x) * (p.z - vertices[i].z) / (vertices[j].z - vertices[i].z) + vertices[i].x))
-        {
-            c = !c;
-        }
-    }
-    return c;
-}
\ No newline at end of file
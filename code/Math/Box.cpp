@@ -100,6 +100,12 @@ float Box::GetVolume() const
     return size.x * size.y * size.z;
 }
 
+float Box::GetSurfaceArea() const
+{
+    glm::vec3 size = GetSize();
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
 bool Box::ContainsPoint(const glm::vec3& point) const
 {
     return isValid && glm::all(glm::greaterThanEqual(point, min)) && glm::all(glm::lessThanEqual(point, max));
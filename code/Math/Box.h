@@ -49,6 +49,9 @@ struct Box
     // Returns the volume of the box.
     float GetVolume() const;
 
+    // Returns the surface area of the box.
+    float GetSurfaceArea() const;
+
     // Returns true if the box contains the given point.
     bool ContainsPoint(const glm::vec3& point) const;
 
@@ -0,0 +1,87 @@
+#include "BoxArray.h"
+
+namespace
+{
+    // Extent stored for invalid boxes and padding entries. Large enough that no plane can reach it, small enough not to overflow.
+    constexpr float kEmptyExtent = -1.0e30f;
+
+    size_t GetPaddedSize(size_t count)
+    {
+        return (count + kCullBatchLanes - 1) / kCullBatchLanes * kCullBatchLanes;
+    }
+}
+
+BoxArray::BoxArray()
+    : count(0)
+{
+}
+
+void BoxArray::Clear()
+{
+    Resize(0);
+}
+
+void BoxArray::Reserve(size_t count)
+{
+    size_t paddedCount = GetPaddedSize(count);
+    centerX.reserve(paddedCount);
+    centerY.reserve(paddedCount);
+    centerZ.reserve(paddedCount);
+    extentX.reserve(paddedCount);
+    extentY.reserve(paddedCount);
+    extentZ.reserve(paddedCount);
+}
+
+void BoxArray::Add(const Box& box)
+{
+    Resize(count + 1);
+    Set(count - 1, box);
+}
+
+void BoxArray::Set(size_t index, const Box& box)
+{
+    if (box.isValid)
+    {
+        glm::vec3 center = box.GetCenter();
+        glm::vec3 extents = box.GetExtents();
+        centerX[index] = center.x;
+        centerY[index] = center.y;
+        centerZ[index] = center.z;
+        extentX[index] = extents.x;
+        extentY[index] = extents.y;
+        extentZ[index] = extents.z;
+    }
+    else
+    {
+        centerX[index] = 0.0f;
+        centerY[index] = 0.0f;
+        centerZ[index] = 0.0f;
+        extentX[index] = kEmptyExtent;
+        extentY[index] = kEmptyExtent;
+        extentZ[index] = kEmptyExtent;
+    }
+}
+
+size_t BoxArray::GetCount() const
+{
+    return count;
+}
+
+size_t BoxArray::GetPaddedCount() const
+{
+    return centerX.size();
+}
+
+void BoxArray::Resize(size_t newCount)
+{
+    size_t paddedCount = GetPaddedSize(newCount);
+
+    // Padding entries are empty boxes, so the batch tests never report them as visible.
+    centerX.resize(paddedCount, 0.0f);
+    centerY.resize(paddedCount, 0.0f);
+    centerZ.resize(paddedCount, 0.0f);
+    extentX.resize(paddedCount, kEmptyExtent);
+    extentY.resize(paddedCount, kEmptyExtent);
+    extentZ.resize(paddedCount, kEmptyExtent);
+    count = newCount;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <vector>
+#include "Box.h"
+
+// The number of floats each BoxArray and SphereArray column is padded to, so batch tests can always load full SIMD registers.
+constexpr size_t kCullBatchLanes = 8;
+
+struct BoxArray
+{
+    // The centers of the boxes, one column per axis.
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+
+    // The half sizes of the boxes, one column per axis.
+    std::vector<float> extentX;
+    std::vector<float> extentY;
+    std::vector<float> extentZ;
+
+    // Creates a new empty box array.
+    BoxArray();
+
+    // Removes all boxes while keeping the allocated storage.
+    void Clear();
+
+    // Reserves storage for the given number of boxes.
+    void Reserve(size_t count);
+
+    // Appends the given box. Invalid boxes are stored with negative extents so they are always culled.
+    void Add(const Box& box);
+
+    // Replaces the box at the given index.
+    void Set(size_t index, const Box& box);
+
+    // Returns the number of boxes in the array.
+    size_t GetCount() const;
+
+    // Returns the padded number of entries in each column, a multiple of kCullBatchLanes.
+    size_t GetPaddedCount() const;
+
+private:
+    // The number of boxes that have been added.
+    size_t count;
+
+    // Grows the columns so they hold count boxes plus padding.
+    void Resize(size_t newCount);
+};
@@ -1,4 +1,240 @@
 #include "Frustum.h"
+#include <bit>
+#include <cmath>
+#include "SimdLanes.h"
+
+using Math::Lanes;
+
+namespace
+{
+    // Plane coefficients broadcast once per batch. The absolute normal components project a box's extents onto the
+    // plane normal, and the normal length scales sphere radii because the extracted planes are not normalized.
+    struct BatchPlanes
+    {
+        float normalX[6];
+        float normalY[6];
+        float normalZ[6];
+        float absNormalX[6];
+        float absNormalY[6];
+        float absNormalZ[6];
+        float normalLength[6];
+        float distance[6];
+    };
+
+    BatchPlanes GetBatchPlanes(const Plane* planes)
+    {
+        BatchPlanes batch;
+        for (int i = 0; i < 6; ++i)
+        {
+            batch.normalX[i] = planes[i].normal.x;
+            batch.normalY[i] = planes[i].normal.y;
+            batch.normalZ[i] = planes[i].normal.z;
+            batch.absNormalX[i] = std::fabs(planes[i].normal.x);
+            batch.absNormalY[i] = std::fabs(planes[i].normal.y);
+            batch.absNormalZ[i] = std::fabs(planes[i].normal.z);
+            batch.normalLength[i] = glm::length(planes[i].normal);
+            batch.distance[i] = planes[i].distance;
+        }
+        return batch;
+    }
+
+    static_assert(kCullBatchLanes % Lanes::kWidth == 0, "Batch padding must be a multiple of the SIMD width");
+
+    // Classifies Lanes::kWidth boxes starting at index. Bit j of outsideMask is set when box j is fully behind a plane,
+    // and bit j of partialMask when it straddles at least one plane.
+    void ClassifyBoxLanes(const BatchPlanes& planes, const BoxArray& boxes, size_t index, int& outsideMask, int& partialMask)
+    {
+        Lanes::Type centerX = Lanes::Load(&boxes.centerX[index]);
+        Lanes::Type centerY = Lanes::Load(&boxes.centerY[index]);
+        Lanes::Type centerZ = Lanes::Load(&boxes.centerZ[index]);
+        Lanes::Type extentX = Lanes::Load(&boxes.extentX[index]);
+        Lanes::Type extentY = Lanes::Load(&boxes.extentY[index]);
+        Lanes::Type extentZ = Lanes::Load(&boxes.extentZ[index]);
+        Lanes::Type zero = Lanes::Zero();
+        Lanes::Type outside = zero;
+        Lanes::Type partial = zero;
+
+        for (int i = 0; i < 6; ++i)
+        {
+            // Signed distance of the box center, and the distance from the center to the p-vertex along the normal.
+            // Both are summed in the order of the scalar tests so the batches round the same way.
+            Lanes::Type distance = Lanes::Add(Lanes::Add(Lanes::Add(Lanes::Mul(Lanes::Set(planes.normalX[i]), centerX), Lanes::Mul(Lanes::Set(planes.normalY[i]), centerY)), Lanes::Mul(Lanes::Set(planes.normalZ[i]), centerZ)), Lanes::Set(planes.distance[i]));
+            Lanes::Type radius = Lanes::Add(Lanes::Add(Lanes::Mul(Lanes::Set(planes.absNormalX[i]), extentX), Lanes::Mul(Lanes::Set(planes.absNormalY[i]), extentY)), Lanes::Mul(Lanes::Set(planes.absNormalZ[i]), extentZ));
+
+            outside = Lanes::Or(outside, Lanes::LessThan(Lanes::Add(distance, radius), zero));
+            partial = Lanes::Or(partial, Lanes::LessThan(Lanes::Sub(distance, radius), zero));
+
+            if (Lanes::GetMask(outside) == Lanes::kAllMask)
+            {
+                break;
+            }
+        }
+
+        outsideMask = Lanes::GetMask(outside);
+        partialMask = Lanes::GetMask(partial);
+    }
+
+    // Classifies Lanes::kWidth spheres starting at index, with the same mask layout as ClassifyBoxLanes.
+    void ClassifySphereLanes(const BatchPlanes& planes, const SphereArray& spheres, size_t index, int& outsideMask, int& partialMask)
+    {
+        Lanes::Type centerX = Lanes::Load(&spheres.centerX[index]);
+        Lanes::Type centerY = Lanes::Load(&spheres.centerY[index]);
+        Lanes::Type centerZ = Lanes::Load(&spheres.centerZ[index]);
+        Lanes::Type sphereRadius = Lanes::Load(&spheres.radius[index]);
+        Lanes::Type zero = Lanes::Zero();
+        Lanes::Type outside = zero;
+        Lanes::Type partial = zero;
+
+        for (int i = 0; i < 6; ++i)
+        {
+            Lanes::Type distance = Lanes::Add(Lanes::Add(Lanes::Add(Lanes::Mul(Lanes::Set(planes.normalX[i]), centerX), Lanes::Mul(Lanes::Set(planes.normalY[i]), centerY)), Lanes::Mul(Lanes::Set(planes.normalZ[i]), centerZ)), Lanes::Set(planes.distance[i]));
+            Lanes::Type radius = Lanes::Mul(Lanes::Set(planes.normalLength[i]), sphereRadius);
+
+            outside = Lanes::Or(outside, Lanes::LessThan(Lanes::Add(distance, radius), zero));
+            partial = Lanes::Or(partial, Lanes::LessThan(Lanes::Sub(distance, radius), zero));
+
+            if (Lanes::GetMask(outside) == Lanes::kAllMask)
+            {
+                break;
+            }
+        }
+
+        outsideMask = Lanes::GetMask(outside);
+        partialMask = Lanes::GetMask(partial);
+    }
+
+    template<typename Array, typename Classifier>
+    void CullLanes(const Plane* frustumPlanes, const Array& array, uint32_t* visibleMask, Classifier classifyLanes)
+    {
+        BatchPlanes planes = GetBatchPlanes(frustumPlanes);
+        size_t numWords = (array.GetCount() + 31) / 32;
+        for (size_t i = 0; i < numWords; ++i)
+        {
+            visibleMask[i] = 0;
+        }
+
+        // Padding entries are always outside, so whole blocks can be written without masking the tail.
+        for (size_t i = 0; i < array.GetPaddedCount(); i += Lanes::kWidth)
+        {
+            int outsideMask, partialMask;
+            classifyLanes(planes, array, i, outsideMask, partialMask);
+
+            uint32_t visible = uint32_t(~outsideMask & Lanes::kAllMask);
+            visibleMask[i / 32] |= visible << (i % 32);
+        }
+    }
+
+    template<typename Array, typename Classifier>
+    void ClassifyLanes(const Plane* frustumPlanes, const Array& array, CullResult* results, Classifier classifyLanes)
+    {
+        BatchPlanes planes = GetBatchPlanes(frustumPlanes);
+        size_t count = array.GetCount();
+
+        for (size_t i = 0; i < count; i += Lanes::kWidth)
+        {
+            int outsideMask, partialMask;
+            classifyLanes(planes, array, i, outsideMask, partialMask);
+
+            for (size_t j = 0; j < size_t(Lanes::kWidth) && i + j < count; ++j)
+            {
+                if (outsideMask & (1 << j))
+                {
+                    results[i + j] = CullResult::Outside;
+                }
+                else if (partialMask & (1 << j))
+                {
+                    results[i + j] = CullResult::Intersecting;
+                }
+                else
+                {
+                    results[i + j] = CullResult::Inside;
+                }
+            }
+        }
+    }
+
+    // Classifies a volume given its center and a function returning its projected radius along a plane's normal.
+    template<typename GetRadius>
+    CullResult ClassifyCoherent(const Plane* planes, const glm::vec3& center, GetRadius getRadius, uint8_t parentMask, uint8_t& rejectPlane, uint8_t& childMask, FrustumCullStats& stats)
+    {
+        stats.numObjects++;
+        stats.numPlaneTestsMasked += 6 - std::popcount(parentMask);
+        childMask = 0;
+
+        // Objects rejected last frame are usually still behind the same plane, so it is tested before the others.
+        int cachedPlane = -1;
+        if (rejectPlane < 6 && (parentMask & (1 << rejectPlane)))
+        {
+            cachedPlane = rejectPlane;
+            float distance = planes[cachedPlane].GetClosestDistanceToPoint(center);
+            float radius = getRadius(planes[cachedPlane]);
+            stats.numPlaneTests++;
+
+            if (distance + radius < 0.0f)
+            {
+                // In plane order the planes before the cached one would have been tested first.
+                stats.numPlaneTestsCached += std::popcount(uint32_t(parentMask & ((1 << cachedPlane) - 1)));
+                return CullResult::Outside;
+            }
+            if (distance - radius < 0.0f)
+            {
+                childMask |= 1 << cachedPlane;
+            }
+        }
+
+        for (int i = 0; i < 6; ++i)
+        {
+            if (i == cachedPlane || !(parentMask & (1 << i)))
+            {
+                continue;
+            }
+
+            float distance = planes[i].GetClosestDistanceToPoint(center);
+            float radius = getRadius(planes[i]);
+            stats.numPlaneTests++;
+
+            if (distance + radius < 0.0f)
+            {
+                rejectPlane = uint8_t(i);
+                childMask = 0;
+                return CullResult::Outside;
+            }
+            if (distance - radius < 0.0f)
+            {
+                childMask |= 1 << i;
+            }
+        }
+
+        return childMask ? CullResult::Intersecting : CullResult::Inside;
+    }
+}
+
+FrustumCullStats::FrustumCullStats()
+{
+    Reset();
+}
+
+void FrustumCullStats::Reset()
+{
+    numObjects = 0;
+    numPlaneTests = 0;
+    numPlaneTestsMasked = 0;
+    numPlaneTestsCached = 0;
+}
+
+int FrustumCullStats::GetPlaneTestsSaved() const
+{
+    return numPlaneTestsMasked + numPlaneTestsCached;
+}
+
+FrustumCullStats& FrustumCullStats::operator+=(const FrustumCullStats& other)
+{
+    numObjects += other.numObjects;
+    numPlaneTests += other.numPlaneTests;
+    numPlaneTestsMasked += other.numPlaneTestsMasked;
+    numPlaneTestsCached += other.numPlaneTestsCached;
+    return *this;
+}
 
 Frustum::Frustum()
 {
@@ -40,6 +276,12 @@ void Frustum::ExtractFrom(const glm::mat4& projectionViewMatrix)
     planes[4].normal.y = projectionViewMatrix[1][3] + projectionViewMatrix[1][2];
     planes[4].normal.z = projectionViewMatrix[2][3] + projectionViewMatrix[2][2];
     planes[4].distance = projectionViewMatrix[3][3] + projectionViewMatrix[3][2];
+
+    // Far clipping plane
+    planes[5].normal.x = projectionViewMatrix[0][3] - projectionViewMatrix[0][2];
+    planes[5].normal.y = projectionViewMatrix[1][3] - projectionViewMatrix[1][2];
+    planes[5].normal.z = projectionViewMatrix[2][3] - projectionViewMatrix[2][2];
+    planes[5].distance = projectionViewMatrix[3][3] - projectionViewMatrix[3][2];
 }
 
 bool Frustum::ContainsPoint(const glm::vec3& point) const
@@ -59,7 +301,8 @@ bool Frustum::ContainsSphere(const Sphere& sphere) const
 {
     for (int i = 0; i < 6; ++i)
     {
-        if (planes[i].GetClosestDistanceToPoint(sphere.center) < -sphere.radius)
+        // The planes are not normalized, so the radius is scaled into plane units.
+        if (planes[i].GetClosestDistanceToPoint(sphere.center) < -sphere.radius * glm::length(planes[i].normal))
         {
             return false;
         }
@@ -70,12 +313,14 @@ bool Frustum::ContainsSphere(const Sphere& sphere) const
 
 bool Frustum::ContainsBox(const Box& box) const
 {
-    std::array<glm::vec3, 8> cornerVertices;
-    box.GetCornerPoints(cornerVertices);
+    glm::vec3 center = box.GetCenter();
+    glm::vec3 extents = box.GetExtents();
 
-    for (int i = 0; i < 8; ++i)
+    for (int i = 0; i < 6; ++i)
     {
-        if (ContainsPoint(cornerVertices[i]))
+        // The box is inside a plane when its n-vertex, the corner furthest behind the plane, is in front of it.
+        float radius = glm::dot(glm::abs(planes[i].normal), extents);
+        if (planes[i].GetClosestDistanceToPoint(center) - radius < 0.0f)
         {
             return false;
         }
@@ -86,27 +331,57 @@ bool Frustum::ContainsBox(const Box& box) const
 
 bool Frustum::IntersectsBox(const Box& box) const
 {
-    std::array<glm::vec3, 8> cornerVertices;
-    box.GetCornerPoints(cornerVertices);
+    glm::vec3 center = box.GetCenter();
+    glm::vec3 extents = box.GetExtents();
 
     for (int i = 0; i < 6; ++i)
     {
-        bool inside = false;
-
-        for (int j = 0; j < 8; ++j)
-        {
-            if (planes[i].GetClosestDistanceToPoint(cornerVertices[j]) >= 0.0f)
-            {
-                inside = true;
-                break;
-            }
-        }
-
-        if (!inside)
+        // The box is outside a plane when its p-vertex, the corner furthest in front of the plane, is behind it.
+        float radius = glm::dot(glm::abs(planes[i].normal), extents);
+        if (planes[i].GetClosestDistanceToPoint(center) + radius < 0.0f)
         {
             return false;
         }
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+void Frustum::CullBoxes(const BoxArray& boxes, uint32_t* visibleMask) const
+{
+    CullLanes(planes, boxes, visibleMask, ClassifyBoxLanes);
+}
+
+void Frustum::ClassifyBoxes(const BoxArray& boxes, CullResult* results) const
+{
+    ClassifyLanes(planes, boxes, results, ClassifyBoxLanes);
+}
+
+void Frustum::CullSpheres(const SphereArray& spheres, uint32_t* visibleMask) const
+{
+    CullLanes(planes, spheres, visibleMask, ClassifySphereLanes);
+}
+
+void Frustum::ClassifySpheres(const SphereArray& spheres, CullResult* results) const
+{
+    ClassifyLanes(planes, spheres, results, ClassifySphereLanes);
+}
+
+CullResult Frustum::ClassifyBoxCoherent(const Box& box, uint8_t parentMask, uint8_t& rejectPlane, uint8_t& childMask, FrustumCullStats& stats) const
+{
+    glm::vec3 extents = box.GetExtents();
+    auto GetRadius = [&](const Plane& plane)
+    {
+        return glm::dot(glm::abs(plane.normal), extents);
+    };
+    return ClassifyCoherent(planes, box.GetCenter(), GetRadius, parentMask, rejectPlane, childMask, stats);
+}
+
+CullResult Frustum::ClassifySphereCoherent(const Sphere& sphere, uint8_t parentMask, uint8_t& rejectPlane, uint8_t& childMask, FrustumCullStats& stats) const
+{
+    auto GetRadius = [&](const Plane& plane)
+    {
+        return sphere.radius * glm::length(plane.normal);
+    };
+    return ClassifyCoherent(planes, sphere.center, GetRadius, parentMask, rejectPlane, childMask, stats);
+}
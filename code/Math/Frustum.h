@@ -1,7 +1,49 @@
 #pragma once
+#include <cstdint>
 #include "Box.h"
+#include "BoxArray.h"
 #include "Plane.h"
 #include "Sphere.h"
+#include "SphereArray.h"
+
+// The result of classifying a volume against a frustum.
+enum class CullResult : uint8_t
+{
+    Outside,
+    Intersecting,
+    Inside
+};
+
+// A plane mask with a bit set for each of the six frustum planes.
+constexpr uint8_t kAllFrustumPlanes = 0x3f;
+
+// Counters for plane-coherent culling, accumulated until reset.
+struct FrustumCullStats
+{
+    // The number of objects classified.
+    int numObjects;
+
+    // The number of plane tests performed.
+    int numPlaneTests;
+
+    // The number of plane tests skipped because the parent was fully inside those planes.
+    int numPlaneTestsMasked;
+
+    // The number of plane tests skipped because the plane cached from the last frame rejected the object first.
+    int numPlaneTestsCached;
+
+    // Creates and zeroes the counters.
+    FrustumCullStats();
+
+    // Zeroes the counters.
+    void Reset();
+
+    // Returns the total number of plane tests saved compared to testing every plane in order.
+    int GetPlaneTestsSaved() const;
+
+    // Adds the given counters to these.
+    FrustumCullStats& operator+=(const FrustumCullStats& other);
+};
 
 struct Frustum
 {
@@ -28,4 +70,26 @@ struct Frustum
 
     // Returnns true if the given box intersects the frustum.
     bool IntersectsBox(const Box& box) const;
+
+    // Tests every box against the frustum and sets bit i of visibleMask when box i is at least partly inside.
+    // visibleMask must hold (boxes.GetCount() + 31) / 32 words.
+    void CullBoxes(const BoxArray& boxes, uint32_t* visibleMask) const;
+
+    // Classifies every box as outside, intersecting or inside the frustum. results must hold boxes.GetCount() entries.
+    void ClassifyBoxes(const BoxArray& boxes, CullResult* results) const;
+
+    // Tests every sphere against the frustum and sets bit i of visibleMask when sphere i is at least partly inside.
+    // visibleMask must hold (spheres.GetCount() + 31) / 32 words.
+    void CullSpheres(const SphereArray& spheres, uint32_t* visibleMask) const;
+
+    // Classifies every sphere as outside, intersecting or inside the frustum. results must hold spheres.GetCount() entries.
+    void ClassifySpheres(const SphereArray& spheres, CullResult* results) const;
+
+    // Classifies the box against the planes in parentMask, testing the plane that rejected it last frame first.
+    // rejectPlane is the object's cached plane index and is updated when a plane rejects it. childMask receives the
+    // planes the box straddles, which its children still have to test; it is zero when the box is fully inside.
+    CullResult ClassifyBoxCoherent(const Box& box, uint8_t parentMask, uint8_t& rejectPlane, uint8_t& childMask, FrustumCullStats& stats) const;
+
+    // Classifies the sphere like ClassifyBoxCoherent.
+    CullResult ClassifySphereCoherent(const Sphere& sphere, uint8_t parentMask, uint8_t& rejectPlane, uint8_t& childMask, FrustumCullStats& stats) const;
 };
\ No newline at end of file
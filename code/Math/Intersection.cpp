@@ -5,7 +5,7 @@ bool Math::Intersects(const Box& a, const Box& b)
 {
     if (a.isValid && b.isValid)
     {
-        return glm::compMax(glm::min(a.max, b.max) - glm::max(a.min, b.min)) >= 0.0f;
+        return glm::compMin(glm::min(a.max, b.max) - glm::max(a.min, b.min)) >= 0.0f;
     }
     return false;
 }
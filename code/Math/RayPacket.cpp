@@ -0,0 +1,237 @@
+#include "RayPacket.h"
+#include <cfloat>
+#include "SimdLanes.h"
+
+using Math::Lanes;
+
+namespace
+{
+    static_assert(kRayPacketSize % Lanes::kWidth == 0, "Ray packets must be a multiple of the SIMD width");
+
+    // Determinants smaller than this mean the ray is parallel to the triangle.
+    constexpr float kParallelEpsilon = 1e-8f;
+
+    struct LaneTriangle
+    {
+        Lanes::Type v0[3];
+        Lanes::Type edge1[3];
+        Lanes::Type edge2[3];
+    };
+
+    LaneTriangle GetLaneTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2)
+    {
+        glm::vec3 edge1 = v1 - v0;
+        glm::vec3 edge2 = v2 - v0;
+
+        LaneTriangle triangle;
+        for (int i = 0; i < 3; ++i)
+        {
+            triangle.v0[i] = Lanes::Set(v0[i]);
+            triangle.edge1[i] = Lanes::Set(edge1[i]);
+            triangle.edge2[i] = Lanes::Set(edge2[i]);
+        }
+        return triangle;
+    }
+
+    // Möller–Trumbore for Lanes::kWidth rays starting at lane, accepting hits from either side of the triangle.
+    int IntersectTriangleLanes(const RayPacket& packet, int lane, const LaneTriangle& triangle, int triangleId, RayPacketHit& hit)
+    {
+        Lanes::Type directionX = Lanes::Load(&packet.directionX[lane]);
+        Lanes::Type directionY = Lanes::Load(&packet.directionY[lane]);
+        Lanes::Type directionZ = Lanes::Load(&packet.directionZ[lane]);
+
+        // p = direction x edge2
+        Lanes::Type pX = Lanes::Sub(Lanes::Mul(directionY, triangle.edge2[2]), Lanes::Mul(directionZ, triangle.edge2[1]));
+        Lanes::Type pY = Lanes::Sub(Lanes::Mul(directionZ, triangle.edge2[0]), Lanes::Mul(directionX, triangle.edge2[2]));
+        Lanes::Type pZ = Lanes::Sub(Lanes::Mul(directionX, triangle.edge2[1]), Lanes::Mul(directionY, triangle.edge2[0]));
+
+        Lanes::Type determinant = Lanes::Add(Lanes::Add(Lanes::Mul(triangle.edge1[0], pX), Lanes::Mul(triangle.edge1[1], pY)), Lanes::Mul(triangle.edge1[2], pZ));
+        Lanes::Type valid = Lanes::Or(Lanes::GreaterThan(determinant, Lanes::Set(kParallelEpsilon)), Lanes::LessThan(determinant, Lanes::Set(-kParallelEpsilon)));
+        if (Lanes::GetMask(valid) == 0)
+        {
+            return 0;
+        }
+        Lanes::Type inverseDeterminant = Lanes::Div(Lanes::Set(1.0f), determinant);
+
+        Lanes::Type sX = Lanes::Sub(Lanes::Load(&packet.originX[lane]), triangle.v0[0]);
+        Lanes::Type sY = Lanes::Sub(Lanes::Load(&packet.originY[lane]), triangle.v0[1]);
+        Lanes::Type sZ = Lanes::Sub(Lanes::Load(&packet.originZ[lane]), triangle.v0[2]);
+
+        Lanes::Type u = Lanes::Mul(Lanes::Add(Lanes::Add(Lanes::Mul(sX, pX), Lanes::Mul(sY, pY)), Lanes::Mul(sZ, pZ)), inverseDeterminant);
+        valid = Lanes::And(valid, Lanes::GreaterEqual(u, Lanes::Zero()));
+
+        // q = s x edge1
+        Lanes::Type qX = Lanes::Sub(Lanes::Mul(sY, triangle.edge1[2]), Lanes::Mul(sZ, triangle.edge1[1]));
+        Lanes::Type qY = Lanes::Sub(Lanes::Mul(sZ, triangle.edge1[0]), Lanes::Mul(sX, triangle.edge1[2]));
+        Lanes::Type qZ = Lanes::Sub(Lanes::Mul(sX, triangle.edge1[1]), Lanes::Mul(sY, triangle.edge1[0]));
+
+        Lanes::Type v = Lanes::Mul(Lanes::Add(Lanes::Add(Lanes::Mul(directionX, qX), Lanes::Mul(directionY, qY)), Lanes::Mul(directionZ, qZ)), inverseDeterminant);
+        valid = Lanes::And(valid, Lanes::GreaterEqual(v, Lanes::Zero()));
+        valid = Lanes::And(valid, Lanes::LessEqual(Lanes::Add(u, v), Lanes::Set(1.0f)));
+
+        Lanes::Type distance = Lanes::Mul(Lanes::Add(Lanes::Add(Lanes::Mul(triangle.edge2[0], qX), Lanes::Mul(triangle.edge2[1], qY)), Lanes::Mul(triangle.edge2[2], qZ)), inverseDeterminant);
+        Lanes::Type closest = Lanes::Load(&hit.distance[lane]);
+        valid = Lanes::And(valid, Lanes::GreaterThan(distance, Lanes::Zero()));
+        valid = Lanes::And(valid, Lanes::LessThan(distance, closest));
+
+        int mask = Lanes::GetMask(valid);
+        if (mask != 0)
+        {
+            Lanes::Store(&hit.distance[lane], Lanes::Select(valid, distance, closest));
+            Lanes::Store(&hit.u[lane], Lanes::Select(valid, u, Lanes::Load(&hit.u[lane])));
+            Lanes::Store(&hit.v[lane], Lanes::Select(valid, v, Lanes::Load(&hit.v[lane])));
+
+            for (int i = 0; i < Lanes::kWidth; ++i)
+            {
+                if (mask & (1 << i))
+                {
+                    hit.triangle[lane + i] = triangleId;
+                }
+            }
+        }
+        return mask << lane;
+    }
+}
+
+RayPacket::RayPacket()
+    : numRays(0)
+{
+    for (int i = 0; i < kRayPacketSize; ++i)
+    {
+        SetRay(i, Ray(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f)), -1.0f);
+    }
+}
+
+RayPacket::RayPacket(const Ray* rays, int count, float maxDistance)
+    : RayPacket()
+{
+    for (int i = 0; i < count; ++i)
+    {
+        SetRay(i, rays[i], maxDistance);
+    }
+}
+
+void RayPacket::SetRay(int index, const Ray& ray, float maxDistance)
+{
+    originX[index] = ray.origin.x;
+    originY[index] = ray.origin.y;
+    originZ[index] = ray.origin.z;
+    directionX[index] = ray.direction.x;
+    directionY[index] = ray.direction.y;
+    directionZ[index] = ray.direction.z;
+    inverseDirectionX[index] = 1.0f / ray.direction.x;
+    inverseDirectionY[index] = 1.0f / ray.direction.y;
+    inverseDirectionZ[index] = 1.0f / ray.direction.z;
+    this->maxDistance[index] = maxDistance;
+
+    if (index >= numRays && maxDistance >= 0.0f)
+    {
+        numRays = index + 1;
+    }
+}
+
+Ray RayPacket::GetRay(int index) const
+{
+    return Ray(glm::vec3(originX[index], originY[index], originZ[index]), glm::vec3(directionX[index], directionY[index], directionZ[index]));
+}
+
+RayPacketHit::RayPacketHit()
+{
+    for (int i = 0; i < kRayPacketSize; ++i)
+    {
+        distance[i] = FLT_MAX;
+        u[i] = 0.0f;
+        v[i] = 0.0f;
+        triangle[i] = -1;
+    }
+}
+
+RayPacketHit::RayPacketHit(const RayPacket& packet)
+    : RayPacketHit()
+{
+    for (int i = 0; i < kRayPacketSize; ++i)
+    {
+        distance[i] = packet.maxDistance[i];
+    }
+}
+
+int RayPacketHit::GetHitMask() const
+{
+    int mask = 0;
+    for (int i = 0; i < kRayPacketSize; ++i)
+    {
+        if (triangle[i] != -1)
+        {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+}
+
+int Math::Intersects(const RayPacket& packet, const Box& box, float* entryDistances)
+{
+    if (!box.isValid)
+    {
+        return 0;
+    }
+
+    Lanes::Type minX = Lanes::Set(box.min.x);
+    Lanes::Type minY = Lanes::Set(box.min.y);
+    Lanes::Type minZ = Lanes::Set(box.min.z);
+    Lanes::Type maxX = Lanes::Set(box.max.x);
+    Lanes::Type maxY = Lanes::Set(box.max.y);
+    Lanes::Type maxZ = Lanes::Set(box.max.z);
+
+    int mask = 0;
+    for (int lane = 0; lane < kRayPacketSize; lane += Lanes::kWidth)
+    {
+        Lanes::Type originX = Lanes::Load(&packet.originX[lane]);
+        Lanes::Type originY = Lanes::Load(&packet.originY[lane]);
+        Lanes::Type originZ = Lanes::Load(&packet.originZ[lane]);
+        Lanes::Type inverseX = Lanes::Load(&packet.inverseDirectionX[lane]);
+        Lanes::Type inverseY = Lanes::Load(&packet.inverseDirectionY[lane]);
+        Lanes::Type inverseZ = Lanes::Load(&packet.inverseDirectionZ[lane]);
+
+        Lanes::Type t0X = Lanes::Mul(Lanes::Sub(minX, originX), inverseX);
+        Lanes::Type t1X = Lanes::Mul(Lanes::Sub(maxX, originX), inverseX);
+        Lanes::Type t0Y = Lanes::Mul(Lanes::Sub(minY, originY), inverseY);
+        Lanes::Type t1Y = Lanes::Mul(Lanes::Sub(maxY, originY), inverseY);
+        Lanes::Type t0Z = Lanes::Mul(Lanes::Sub(minZ, originZ), inverseZ);
+        Lanes::Type t1Z = Lanes::Mul(Lanes::Sub(maxZ, originZ), inverseZ);
+
+        // Entry is the latest slab entry, clamped to the origin; exit is the earliest slab exit, clamped to the ray length.
+        Lanes::Type entry = Lanes::Max(Lanes::Max(Lanes::Min(t0X, t1X), Lanes::Min(t0Y, t1Y)), Lanes::Max(Lanes::Min(t0Z, t1Z), Lanes::Zero()));
+        Lanes::Type exit = Lanes::Min(Lanes::Min(Lanes::Max(t0X, t1X), Lanes::Max(t0Y, t1Y)), Lanes::Min(Lanes::Max(t0Z, t1Z), Lanes::Load(&packet.maxDistance[lane])));
+
+        mask |= Lanes::GetMask(Lanes::LessEqual(entry, exit)) << lane;
+
+        if (entryDistances)
+        {
+            Lanes::Store(&entryDistances[lane], entry);
+        }
+    }
+    return mask;
+}
+
+int Math::Intersects(const RayPacket& packet, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, int triangle, RayPacketHit& hit)
+{
+    LaneTriangle laneTriangle = GetLaneTriangle(v0, v1, v2);
+
+    int mask = 0;
+    for (int lane = 0; lane < kRayPacketSize; lane += Lanes::kWidth)
+    {
+        mask |= IntersectTriangleLanes(packet, lane, laneTriangle, triangle, hit);
+    }
+    return mask;
+}
+
+int Math::Intersects(const RayPacket& packet, const glm::vec3* positions, const uint32_t* indices, int numTriangles, int firstTriangle, RayPacketHit& hit)
+{
+    int mask = 0;
+    for (int i = 0; i < numTriangles; ++i)
+    {
+        const uint32_t* triangle = &indices[i * 3];
+        mask |= Intersects(packet, positions[triangle[0]], positions[triangle[1]], positions[triangle[2]], firstTriangle + i, hit);
+    }
+    return mask;
+}
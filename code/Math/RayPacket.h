@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include "Box.h"
+#include "Ray.h"
+
+// The number of rays in a packet. Kernels process it in one AVX or two SSE steps.
+constexpr int kRayPacketSize = 8;
+
+struct RayPacket
+{
+    // The origins of the rays, one column per axis.
+    float originX[kRayPacketSize];
+    float originY[kRayPacketSize];
+    float originZ[kRayPacketSize];
+
+    // The directions of the rays, one column per axis.
+    float directionX[kRayPacketSize];
+    float directionY[kRayPacketSize];
+    float directionZ[kRayPacketSize];
+
+    // The reciprocal directions, computed once when a ray is set so slab tests only multiply.
+    float inverseDirectionX[kRayPacketSize];
+    float inverseDirectionY[kRayPacketSize];
+    float inverseDirectionZ[kRayPacketSize];
+
+    // The maximum hit distance of each ray. Unused lanes are negative so they never hit.
+    float maxDistance[kRayPacketSize];
+
+    // The number of rays set in the packet.
+    int numRays;
+
+    // Creates a new packet with no rays.
+    RayPacket();
+
+    // Creates and initializes a new packet from the given rays.
+    RayPacket(const Ray* rays, int count, float maxDistance);
+
+    // Sets the ray at the given lane.
+    void SetRay(int index, const Ray& ray, float maxDistance);
+
+    // Returns the ray at the given lane.
+    Ray GetRay(int index) const;
+};
+
+struct RayPacketHit
+{
+    // The distance to the closest hit so far, or the ray's maximum distance if it has not hit anything.
+    float distance[kRayPacketSize];
+
+    // The barycentric coordinates of the closest hit.
+    float u[kRayPacketSize];
+    float v[kRayPacketSize];
+
+    // The ID of the closest triangle hit, or -1.
+    int triangle[kRayPacketSize];
+
+    // Creates a new hit record with no hits.
+    RayPacketHit();
+
+    // Creates a new hit record limited to the packet's maximum distances.
+    RayPacketHit(const RayPacket& packet);
+
+    // Returns a mask with bit i set when ray i has hit a triangle.
+    int GetHitMask() const;
+};
+
+namespace Math
+{
+    // Slab-tests every ray in the packet against the box. Writes the entry distance of each ray to entryDistances,
+    // when given, and returns a mask with bit i set when ray i enters the box before its maximum distance.
+    int Intersects(const RayPacket& packet, const Box& box, float* entryDistances = nullptr);
+
+    // Tests every ray in the packet against the triangle and records it in hit for each ray it is the closest hit so
+    // far. Returns a mask with bit i set when ray i's closest hit changed.
+    int Intersects(const RayPacket& packet, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, int triangle, RayPacketHit& hit);
+
+    // Tests every ray in the packet against an indexed triangle list. Triangle IDs are firstTriangle plus the
+    // triangle's position in the list. Returns a mask of the rays whose closest hit changed.
+    int Intersects(const RayPacket& packet, const glm::vec3* positions, const uint32_t* indices, int numTriangles, int firstTriangle, RayPacketHit& hit);
+}
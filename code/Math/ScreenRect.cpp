@@ -0,0 +1,51 @@
+#include "ScreenRect.h"
+
+ScreenRect::ScreenRect()
+    : min(0)
+    , max(0)
+{
+}
+
+ScreenRect::ScreenRect(const glm::ivec2& min, const glm::ivec2& max)
+    : min(min)
+    , max(max)
+{
+}
+
+ScreenRect& ScreenRect::operator+=(const ScreenRect& rect)
+{
+    if (IsEmpty())
+    {
+        *this = rect;
+    }
+    else if (!rect.IsEmpty())
+    {
+        min = glm::min(min, rect.min);
+        max = glm::max(max, rect.max);
+    }
+    return *this;
+}
+
+bool ScreenRect::operator==(const ScreenRect& other) const
+{
+    if (IsEmpty() || other.IsEmpty())
+    {
+        return IsEmpty() == other.IsEmpty();
+    }
+    return min == other.min && max == other.max;
+}
+
+ScreenRect ScreenRect::Intersect(const ScreenRect& rect) const
+{
+    return ScreenRect(glm::max(min, rect.min), glm::min(max, rect.max));
+}
+
+bool ScreenRect::IsEmpty() const
+{
+    return min.x >= max.x || min.y >= max.y;
+}
+
+int ScreenRect::GetArea() const
+{
+    return IsEmpty() ? 0 : (max.x - min.x) * (max.y - min.y);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// A rectangle of pixels with the origin at the top left of the screen. The minimum is inclusive and the maximum is
+// exclusive, so a zeroed rectangle is empty.
+struct ScreenRect
+{
+    // The first pixel column and row inside the rectangle.
+    glm::ivec2 min;
+
+    // The pixel column and row just past the rectangle.
+    glm::ivec2 max;
+
+    // Creates a new empty rectangle.
+    ScreenRect();
+
+    // Creates and initializes a new rectangle from the given extents.
+    ScreenRect(const glm::ivec2& min, const glm::ivec2& max);
+
+    // Extends the rectangle to include the given rectangle.
+    ScreenRect& operator+=(const ScreenRect& rect);
+
+    // Returns true if both rectangles cover the same pixels.
+    bool operator==(const ScreenRect& other) const;
+
+    // Returns the pixels covered by both rectangles.
+    ScreenRect Intersect(const ScreenRect& rect) const;
+
+    // Returns true if the rectangle covers no pixels.
+    bool IsEmpty() const;
+
+    // Returns the number of pixels covered by the rectangle.
+    int GetArea() const;
+};
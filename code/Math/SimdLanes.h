@@ -0,0 +1,94 @@
+#pragma once
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define MATH_SIMD_AVX
+#elif defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#include <xmmintrin.h>
+#define MATH_SIMD_SSE
+#endif
+
+// Thin wrappers over the widest float vector available, so batch kernels are written once for AVX, SSE and scalar
+// builds. Comparisons return lane masks that are only meant to be combined with And/Or/Select and read by GetMask.
+namespace Math
+{
+#if defined(MATH_SIMD_AVX)
+    struct Lanes
+    {
+        using Type = __m256;
+        static constexpr int kWidth = 8;
+        static constexpr int kAllMask = 0xff;
+
+        static Type Load(const float* values) { return _mm256_loadu_ps(values); }
+        static void Store(float* values, Type a) { _mm256_storeu_ps(values, a); }
+        static Type Set(float value) { return _mm256_set1_ps(value); }
+        static Type Zero() { return _mm256_setzero_ps(); }
+        static Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+        static Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+        static Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+        static Type Div(Type a, Type b) { return _mm256_div_ps(a, b); }
+        static Type Min(Type a, Type b) { return _mm256_min_ps(a, b); }
+        static Type Max(Type a, Type b) { return _mm256_max_ps(a, b); }
+        static Type And(Type a, Type b) { return _mm256_and_ps(a, b); }
+        static Type Or(Type a, Type b) { return _mm256_or_ps(a, b); }
+        static Type Select(Type mask, Type a, Type b) { return _mm256_blendv_ps(b, a, mask); }
+        static Type LessThan(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static Type LessEqual(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        static Type GreaterThan(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        static Type GreaterEqual(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+        static int GetMask(Type a) { return _mm256_movemask_ps(a); }
+    };
+#elif defined(MATH_SIMD_SSE)
+    struct Lanes
+    {
+        using Type = __m128;
+        static constexpr int kWidth = 4;
+        static constexpr int kAllMask = 0xf;
+
+        static Type Load(const float* values) { return _mm_loadu_ps(values); }
+        static void Store(float* values, Type a) { _mm_storeu_ps(values, a); }
+        static Type Set(float value) { return _mm_set1_ps(value); }
+        static Type Zero() { return _mm_setzero_ps(); }
+        static Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+        static Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+        static Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+        static Type Div(Type a, Type b) { return _mm_div_ps(a, b); }
+        static Type Min(Type a, Type b) { return _mm_min_ps(a, b); }
+        static Type Max(Type a, Type b) { return _mm_max_ps(a, b); }
+        static Type And(Type a, Type b) { return _mm_and_ps(a, b); }
+        static Type Or(Type a, Type b) { return _mm_or_ps(a, b); }
+        static Type Select(Type mask, Type a, Type b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+        static Type LessThan(Type a, Type b) { return _mm_cmplt_ps(a, b); }
+        static Type LessEqual(Type a, Type b) { return _mm_cmple_ps(a, b); }
+        static Type GreaterThan(Type a, Type b) { return _mm_cmpgt_ps(a, b); }
+        static Type GreaterEqual(Type a, Type b) { return _mm_cmpge_ps(a, b); }
+        static int GetMask(Type a) { return _mm_movemask_ps(a); }
+    };
+#else
+    struct Lanes
+    {
+        using Type = float;
+        static constexpr int kWidth = 1;
+        static constexpr int kAllMask = 0x1;
+
+        static Type Load(const float* values) { return *values; }
+        static void Store(float* values, Type a) { *values = a; }
+        static Type Set(float value) { return value; }
+        static Type Zero() { return 0.0f; }
+        static Type Add(Type a, Type b) { return a + b; }
+        static Type Sub(Type a, Type b) { return a - b; }
+        static Type Mul(Type a, Type b) { return a * b; }
+        static Type Div(Type a, Type b) { return a / b; }
+        static Type Min(Type a, Type b) { return a < b ? a : b; }
+        static Type Max(Type a, Type b) { return a > b ? a : b; }
+        static Type And(Type a, Type b) { return (a != 0.0f && b != 0.0f) ? 1.0f : 0.0f; }
+        static Type Or(Type a, Type b) { return (a != 0.0f || b != 0.0f) ? 1.0f : 0.0f; }
+        static Type Select(Type mask, Type a, Type b) { return mask != 0.0f ? a : b; }
+        static Type LessThan(Type a, Type b) { return a < b ? 1.0f : 0.0f; }
+        static Type LessEqual(Type a, Type b) { return a <= b ? 1.0f : 0.0f; }
+        static Type GreaterThan(Type a, Type b) { return a > b ? 1.0f : 0.0f; }
+        static Type GreaterEqual(Type a, Type b) { return a >= b ? 1.0f : 0.0f; }
+        static int GetMask(Type a) { return a != 0.0f ? 1 : 0; }
+    };
+#endif
+}
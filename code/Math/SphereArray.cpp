@@ -0,0 +1,65 @@
+#include "SphereArray.h"
+
+namespace
+{
+    // Radius stored for padding entries so they are always culled.
+    constexpr float kEmptyRadius = -1.0e30f;
+
+    size_t GetPaddedSize(size_t count)
+    {
+        return (count + kCullBatchLanes - 1) / kCullBatchLanes * kCullBatchLanes;
+    }
+}
+
+SphereArray::SphereArray()
+    : count(0)
+{
+}
+
+void SphereArray::Clear()
+{
+    Resize(0);
+}
+
+void SphereArray::Reserve(size_t count)
+{
+    size_t paddedCount = GetPaddedSize(count);
+    centerX.reserve(paddedCount);
+    centerY.reserve(paddedCount);
+    centerZ.reserve(paddedCount);
+    radius.reserve(paddedCount);
+}
+
+void SphereArray::Add(const Sphere& sphere)
+{
+    Resize(count + 1);
+    Set(count - 1, sphere);
+}
+
+void SphereArray::Set(size_t index, const Sphere& sphere)
+{
+    centerX[index] = sphere.center.x;
+    centerY[index] = sphere.center.y;
+    centerZ[index] = sphere.center.z;
+    radius[index] = sphere.radius;
+}
+
+size_t SphereArray::GetCount() const
+{
+    return count;
+}
+
+size_t SphereArray::GetPaddedCount() const
+{
+    return centerX.size();
+}
+
+void SphereArray::Resize(size_t newCount)
+{
+    size_t paddedCount = GetPaddedSize(newCount);
+    centerX.resize(paddedCount, 0.0f);
+    centerY.resize(paddedCount, 0.0f);
+    centerZ.resize(paddedCount, 0.0f);
+    radius.resize(paddedCount, kEmptyRadius);
+    count = newCount;
+}
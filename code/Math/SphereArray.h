@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include "BoxArray.h"
+#include "Sphere.h"
+
+struct SphereArray
+{
+    // The centers of the spheres, one column per axis.
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+
+    // The radii of the spheres.
+    std::vector<float> radius;
+
+    // Creates a new empty sphere array.
+    SphereArray();
+
+    // Removes all spheres while keeping the allocated storage.
+    void Clear();
+
+    // Reserves storage for the given number of spheres.
+    void Reserve(size_t count);
+
+    // Appends the given sphere.
+    void Add(const Sphere& sphere);
+
+    // Replaces the sphere at the given index.
+    void Set(size_t index, const Sphere& sphere);
+
+    // Returns the number of spheres in the array.
+    size_t GetCount() const;
+
+    // Returns the padded number of entries in each column, a multiple of kCullBatchLanes.
+    size_t GetPaddedCount() const;
+
+private:
+    // The number of spheres that have been added.
+    size_t count;
+
+    // Grows the columns so they hold count spheres plus padding.
+    void Resize(size_t newCount);
+};
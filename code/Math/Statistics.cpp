@@ -0,0 +1,14 @@
+#include "Statistics.h"
+#include <algorithm>
+#include <cmath>
+
+double Math::GetPercentile(const std::vector<double>& sortedValues, double percentile)
+{
+    if (sortedValues.empty())
+    {
+        return 0.0;
+    }
+
+    size_t rank = (size_t)std::ceil(percentile / 100.0 * (double)sortedValues.size());
+    return sortedValues[std::clamp(rank, (size_t)1, sortedValues.size()) - 1];
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <vector>
+
+namespace Math
+{
+    // Returns the given percentile, from 0 to 100, of the values by nearest rank. The values must be sorted in
+    // ascending order. Returns 0 if there are no values.
+    double GetPercentile(const std::vector<double>& sortedValues, double percentile);
+}
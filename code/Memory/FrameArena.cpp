@@ -0,0 +1,54 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena(size_t capacity)
+    : block(std::make_unique<std::byte[]>(capacity))
+    , capacity(capacity)
+    , offset(0)
+    , overflowSize(0)
+{
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.get());
+    size_t alignedOffset = ((base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+
+    if (alignedOffset + size <= capacity)
+    {
+        offset = alignedOffset + size;
+        return block.get() + alignedOffset;
+    }
+
+    // The padding for the alignment is counted as well, so the grown block fits the same allocations in any order.
+    overflowBlocks.push_back(std::make_unique<std::byte[]>(size + alignment));
+    overflowSize += size + alignment;
+
+    uintptr_t overflow = reinterpret_cast<uintptr_t>(overflowBlocks.back().get());
+    return reinterpret_cast<void*>((overflow + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+void FrameArena::Reset()
+{
+    if (!overflowBlocks.empty())
+    {
+        // Growing by at least half again keeps a slowly growing frame from reallocating the block every frame.
+        capacity = std::max(offset + overflowSize, capacity + capacity / 2);
+        block = std::make_unique<std::byte[]>(capacity);
+        overflowBlocks.clear();
+        overflowSize = 0;
+    }
+
+    offset = 0;
+}
+
+size_t FrameArena::GetUsed() const
+{
+    return offset + overflowSize;
+}
+
+size_t FrameArena::GetCapacity() const
+{
+    return capacity;
+}
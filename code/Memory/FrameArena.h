@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Hands out memory for data that only lives for one frame by bumping an offset into a single block, and takes all
+// of it back at once when the frame ends. Allocations that do not fit are served from the heap for the rest of the
+// frame, and the block grows to cover them on the next reset, so a frame stops touching the heap once the arena has
+// seen its largest frame.
+class FrameArena
+{
+public:
+    // Creates a new arena with a block of the given size in bytes.
+    explicit FrameArena(size_t capacity = 1 << 20);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Returns size bytes aligned to the given power of two. The memory stays valid until the next reset.
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // Takes back everything allocated since the last reset, growing the block if the frame did not fit into it.
+    void Reset();
+
+    // Returns the number of bytes allocated since the last reset.
+    size_t GetUsed() const;
+
+    // Returns the size of the block in bytes.
+    size_t GetCapacity() const;
+
+private:
+    std::unique_ptr<std::byte[]> block;
+    size_t capacity;
+    size_t offset;
+
+    // The bytes allocated on the heap since the last reset because they did not fit into the block.
+    std::vector<std::unique_ptr<std::byte[]>> overflowBlocks;
+    size_t overflowSize;
+};
+
+// Lets standard containers allocate from a frame arena. Memory is never handed back one allocation at a time, so
+// containers in an arena must not outlive its next reset; a container that grows leaves its old storage behind
+// until then, so reserving up front keeps the arena small.
+template <typename T>
+struct FrameAllocator
+{
+    using value_type = T;
+
+    // Containers take the arena with them when assigned or swapped, so a container can be pointed at a fresh
+    // arena by assigning an empty one to it.
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    // The arena the memory comes from.
+    FrameArena* arena;
+
+    // Creates a new allocator taking memory from the given arena.
+    FrameAllocator(FrameArena& arena)
+        : arena(&arena)
+    {
+    }
+
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U>& other)
+        : arena(other.arena)
+    {
+    }
+
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(arena->Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t)
+    {
+    }
+
+    template <typename U>
+    bool operator==(const FrameAllocator<U>& other) const
+    {
+        return arena == other.arena;
+    }
+};
+
+// A vector whose storage lives in a frame arena.
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
@@ -0,0 +1,439 @@
+#include "ColumnRenderer.h"
+#include <algorithm>
+#include <cmath>
+
+#include <stb_image_write.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define COLUMN_RENDERER_SSE2
+#endif
+
+namespace
+{
+    // Walls closer than this to the eye plane are clipped.
+    constexpr float kNearDepth = 0.01f;
+
+    // Portal loops in non-convex layouts are cut off after this many visits of the same sector.
+    constexpr int kMaxSectorVisits = 32;
+
+    // The tint that faces are shaded with by the absolute value of their normal, as in SectorMesh.
+    constexpr glm::vec3 kShade = glm::vec3(0.8f, 0.65f, 0.9f);
+
+    int ToShade(float shade)
+    {
+        return glm::clamp((int)(shade * 256.0f), 0, 256);
+    }
+
+    uint32_t ShadeTexel(uint32_t texel, int shade)
+    {
+        uint32_t r = ((texel & 0xFF) * shade) >> 8;
+        uint32_t g = (((texel >> 8) & 0xFF) * shade) >> 8;
+        uint32_t b = (((texel >> 16) & 0xFF) * shade) >> 8;
+        return 0xFF000000u | (b << 16) | (g << 8) | r;
+    }
+
+#ifdef COLUMN_RENDERER_SSE2
+    // Multiplies the color channels of four texels by the shade in 8.8 fixed point.
+    __m128i ShadeTexels(__m128i texels, __m128i shade)
+    {
+        __m128i zero = _mm_setzero_si128();
+        __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(texels, zero), shade), 8);
+        __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(texels, zero), shade), 8);
+        return _mm_or_si128(_mm_packus_epi16(lo, hi), _mm_set1_epi32((int)0xFF000000u));
+    }
+
+    // Rounds four floats towards negative infinity, which SSE2 has no instruction for.
+    __m128i FloorToInt(__m128 value)
+    {
+        __m128i truncated = _mm_cvttps_epi32(value);
+        __m128 greater = _mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), value);
+        return _mm_add_epi32(truncated, _mm_castps_si128(greater));
+    }
+
+    // Stores four pixels down a column.
+    void StoreColumn(uint32_t* dst, int stride, __m128i texels)
+    {
+        alignas(16) uint32_t values[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(values), texels);
+        dst[0] = values[0];
+        dst[stride] = values[1];
+        dst[stride * 2] = values[2];
+        dst[stride * 3] = values[3];
+    }
+#endif
+}
+
+ColumnRenderer::ColumnRenderer(int width, int height)
+    : numPixelWrites(0)
+    , numOverdrawnPixels(0)
+    , numSectorsDrawn(0)
+    , checkOverdraw(false)
+    , width(width)
+    , height(height)
+    , pixels(width * height, 0xFF000000u)
+    , columnTop(width)
+    , columnBottom(width)
+    , columnVisit(width)
+{
+    uint32_t checker[64 * 64];
+    for (int y = 0; y < 64; ++y)
+    {
+        for (int x = 0; x < 64; ++x)
+        {
+            checker[y * 64 + x] = ((x / 8 + y / 8) & 1) ? 0xFFFFFFFFu : 0xFFB0B0B0u;
+        }
+    }
+    SetTexture(checker, 64, 64);
+}
+
+void ColumnRenderer::SetTexture(const uint32_t* texturePixels, int width, int height)
+{
+    textureWidth = width;
+    textureHeight = height;
+    textureShift = 0;
+    while ((1 << textureShift) < width)
+    {
+        textureShift++;
+    }
+    texture.assign(texturePixels, texturePixels + width * height);
+}
+
+void ColumnRenderer::Render(const Map& map, int sector, const glm::vec3& eye, const glm::vec3& forward, float fovY)
+{
+    std::fill(pixels.begin(), pixels.end(), 0xFF000000u);
+    std::fill(columnTop.begin(), columnTop.end(), 0);
+    std::fill(columnBottom.begin(), columnBottom.end(), height - 1);
+    std::fill(columnVisit.begin(), columnVisit.end(), -1);
+
+    if (checkOverdraw)
+    {
+        writeCounts.assign(width * height, 0);
+    }
+
+    numPixelWrites = 0;
+    numOverdrawnPixels = 0;
+    numSectorsDrawn = 0;
+
+    if (sector < 0)
+    {
+        return;
+    }
+
+    eye2D = glm::vec2(eye.x, -eye.z);
+    forward2D = glm::vec2(forward.x, -forward.z);
+    forward2D = glm::length(forward2D) > 1e-6f ? glm::normalize(forward2D) : glm::vec2(0.0f, 1.0f);
+    right2D = glm::vec2(forward2D.y, -forward2D.x);
+    eyeHeight = eye.y;
+    focalLength = (height * 0.5f) / std::tan(fovY * 0.5f);
+
+    // Looking up and down shears the view instead of rotating it.
+    float pitch = std::asin(glm::clamp(forward.y, -0.99f, 0.99f));
+    horizon = height * 0.5f + std::tan(pitch) * focalLength;
+
+    // Every window of the last frame counted one visit of its sector, so only those are cleared and the cost does
+    // not depend on the map size.
+    if (sectorVisits.size() != map.sectors.size())
+    {
+        sectorVisits.assign(map.sectors.size(), 0);
+    }
+    else
+    {
+        for (const Window& visited : windows)
+        {
+            sectorVisits[visited.sector] = 0;
+        }
+    }
+    windows.clear();
+    windows.push_back({ sector, 0, width - 1 });
+
+    for (size_t windowIndex = 0; windowIndex < windows.size(); ++windowIndex)
+    {
+        Window window = windows[windowIndex];
+
+        if (sectorVisits[window.sector]++ >= kMaxSectorVisits)
+        {
+            continue;
+        }
+
+        numSectorsDrawn++;
+
+        const Sector& current = map.sectors[window.sector];
+        CollectWalls(map, current);
+
+        for (const WallSpan& span : wallSpans)
+        {
+            const Wall& wall = map.walls[span.wall];
+            const Sector* other = wall.sector != -1 ? &map.sectors[wall.sector] : nullptr;
+
+            glm::vec2 normal = glm::normalize(map.wallVertices[wall.v[1]] - map.wallVertices[wall.v[0]]);
+            int wallShade = ToShade(glm::dot(kShade, glm::abs(glm::vec3(normal.y, 0.0f, normal.x))));
+            int flatShade = ToShade(kShade.y);
+
+            int x1 = std::max((int)std::ceil(span.x[0] - 0.5f), window.x1);
+            int x2 = std::min((int)std::ceil(span.x[1] - 0.5f) - 1, window.x2);
+            // The portal columns start out empty even when the span misses the window and x1 is past x2.
+            int portalX1 = window.x2 + 1;
+            int portalX2 = window.x1 - 1;
+
+            for (int x = x1; x <= x2; ++x)
+            {
+                if (columnVisit[x] == (int)windowIndex || columnTop[x] > columnBottom[x])
+                {
+                    continue;
+                }
+                columnVisit[x] = (int)windowIndex;
+
+                // 1/depth and u/depth are linear in screen space.
+                float s = (x + 0.5f - span.x[0]) / (span.x[1] - span.x[0]);
+                float invDepth = span.invDepth[0] + (span.invDepth[1] - span.invDepth[0]) * s;
+                float depth = 1.0f / invDepth;
+                float u = (span.uOverDepth[0] + (span.uOverDepth[1] - span.uOverDepth[0]) * s) * depth;
+                int textureU = (int)std::floor(u * textureWidth) & (textureWidth - 1);
+
+                float scale = focalLength * invDepth;
+                float vStep = textureHeight / scale;
+
+                auto ScreenY = [&](float worldHeight) {
+                    return glm::clamp((int)std::ceil(horizon - (worldHeight - eyeHeight) * scale - 0.5f), columnTop[x], columnBottom[x] + 1);
+                };
+
+                auto WorldV = [&](int y) {
+                    return (eyeHeight + (horizon - (y + 0.5f)) / scale) * -(float)textureHeight;
+                };
+
+                int top = columnTop[x];
+                int bottom = columnBottom[x];
+                int ceilingY = ScreenY(current.ceilingHeight);
+                int floorY = ScreenY(current.floorHeight);
+
+                DrawFlatColumn(x, top, ceilingY - 1, current.ceilingHeight, flatShade);
+                DrawFlatColumn(x, floorY, bottom, current.floorHeight, flatShade);
+
+                if (!other)
+                {
+                    DrawWallColumn(x, ceilingY, floorY - 1, textureU, WorldV(ceilingY), vStep, wallShade);
+                    columnTop[x] = bottom + 1;
+                    continue;
+                }
+
+                int otherCeilingY = std::max(ScreenY(other->ceilingHeight), ceilingY);
+                int otherFloorY = std::min(ScreenY(other->floorHeight), floorY);
+
+                DrawWallColumn(x, ceilingY, otherCeilingY - 1, textureU, WorldV(ceilingY), vStep, wallShade);
+                DrawWallColumn(x, otherFloorY, floorY - 1, textureU, WorldV(otherFloorY), vStep, wallShade);
+
+                columnTop[x] = otherCeilingY;
+                columnBottom[x] = otherFloorY - 1;
+
+                if (columnTop[x] <= columnBottom[x])
+                {
+                    portalX1 = std::min(portalX1, x);
+                    portalX2 = std::max(portalX2, x);
+                }
+            }
+
+            if (other && portalX1 <= portalX2)
+            {
+                windows.push_back({ wall.sector, portalX1, portalX2 });
+            }
+        }
+    }
+
+    if (checkOverdraw)
+    {
+        for (uint8_t count : writeCounts)
+        {
+            numOverdrawnPixels += count > 1;
+        }
+    }
+}
+
+const uint32_t* ColumnRenderer::GetPixels() const
+{
+    return pixels.data();
+}
+
+bool ColumnRenderer::WriteImage(const char* path) const
+{
+    return stbi_write_png(path, width, height, 4, pixels.data(), width * 4) != 0;
+}
+
+void ColumnRenderer::CollectWalls(const Map& map, const Sector& sector)
+{
+    wallSpans.clear();
+
+    for (int i = 0; i < sector.numWalls; ++i)
+    {
+        int wallIndex = sector.firstWall + i;
+        const Wall& wall = map.walls[wallIndex];
+
+        glm::vec2 a = map.wallVertices[wall.v[0]];
+        glm::vec2 b = map.wallVertices[wall.v[1]];
+
+        // Walls are only seen from the inside of their sector.
+        glm::vec2 normal = glm::vec2(b.y - a.y, a.x - b.x);
+        if (glm::dot(normal, eye2D - a) >= 0.0f)
+        {
+            continue;
+        }
+
+        glm::vec2 view[2] = {
+            glm::vec2(glm::dot(a - eye2D, right2D), glm::dot(a - eye2D, forward2D)),
+            glm::vec2(glm::dot(b - eye2D, right2D), glm::dot(b - eye2D, forward2D))
+        };
+        float u[2] = { 0.0f, glm::distance(a, b) };
+
+        if (view[0].y < kNearDepth && view[1].y < kNearDepth)
+        {
+            continue;
+        }
+
+        for (int j = 0; j < 2; ++j)
+        {
+            if (view[j].y < kNearDepth)
+            {
+                float t = (kNearDepth - view[j].y) / (view[1 - j].y - view[j].y);
+                view[j] = glm::mix(view[j], view[1 - j], t);
+                u[j] = u[j] + (u[1 - j] - u[j]) * t;
+            }
+        }
+
+        WallSpan span;
+        span.wall = wallIndex;
+        span.nearestDepth = std::min(view[0].y, view[1].y);
+
+        for (int j = 0; j < 2; ++j)
+        {
+            span.x[j] = width * 0.5f + view[j].x / view[j].y * focalLength;
+            span.invDepth[j] = 1.0f / view[j].y;
+            span.uOverDepth[j] = u[j] / view[j].y;
+        }
+
+        if (span.x[0] > span.x[1])
+        {
+            std::swap(span.x[0], span.x[1]);
+            std::swap(span.invDepth[0], span.invDepth[1]);
+            std::swap(span.uOverDepth[0], span.uOverDepth[1]);
+        }
+
+        if (span.x[1] - span.x[0] > 1e-4f)
+        {
+            wallSpans.push_back(span);
+        }
+    }
+
+    std::sort(wallSpans.begin(), wallSpans.end(), [](const WallSpan& a, const WallSpan& b) {
+        return a.nearestDepth < b.nearestDepth;
+    });
+}
+
+void ColumnRenderer::DrawWallColumn(int x, int y0, int y1, int u, float v, float vStep, int shade)
+{
+    if (y0 > y1)
+    {
+        return;
+    }
+
+    CountWrites(x, y0, y1);
+
+    uint32_t* dst = &pixels[y0 * width + x];
+    const uint32_t* column = &texture[u];
+    int maskV = textureHeight - 1;
+    int y = y0;
+
+#ifdef COLUMN_RENDERER_SSE2
+    __m128 v4 = _mm_add_ps(_mm_set1_ps(v), _mm_mul_ps(_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f), _mm_set1_ps(vStep)));
+    __m128 step4 = _mm_set1_ps(vStep * 4.0f);
+    __m128i mask4 = _mm_set1_epi32(maskV);
+    __m128i shade8 = _mm_set1_epi16((short)shade);
+
+    for (; y + 3 <= y1; y += 4, dst += width * 4)
+    {
+        alignas(16) int rows[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(rows), _mm_slli_epi32(_mm_and_si128(FloorToInt(v4), mask4), textureShift));
+        v4 = _mm_add_ps(v4, step4);
+
+        __m128i texels = _mm_setr_epi32((int)column[rows[0]], (int)column[rows[1]], (int)column[rows[2]], (int)column[rows[3]]);
+        StoreColumn(dst, width, ShadeTexels(texels, shade8));
+    }
+
+    v += vStep * (y - y0);
+#endif
+
+    for (; y <= y1; ++y, dst += width, v += vStep)
+    {
+        *dst = ShadeTexel(column[((int)std::floor(v) & maskV) << textureShift], shade);
+    }
+}
+
+void ColumnRenderer::DrawFlatColumn(int x, int y0, int y1, float flatHeight, int shade)
+{
+    if (y0 > y1)
+    {
+        return;
+    }
+
+    CountWrites(x, y0, y1);
+
+    // The view ray through the column, per unit of depth.
+    glm::vec2 ray = forward2D + right2D * ((x + 0.5f - width * 0.5f) / focalLength);
+    float k = (flatHeight - eyeHeight) * focalLength;
+
+    uint32_t* dst = &pixels[y0 * width + x];
+    int maskU = textureWidth - 1;
+    int maskV = textureHeight - 1;
+    int y = y0;
+
+#ifdef COLUMN_RENDERER_SSE2
+    __m128 rowOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    __m128 horizon4 = _mm_set1_ps(horizon);
+    __m128 k4 = _mm_set1_ps(k);
+    __m128 eyeU = _mm_set1_ps(eye2D.x * textureWidth);
+    __m128 eyeV = _mm_set1_ps(-eye2D.y * textureHeight);
+    __m128 rayU = _mm_set1_ps(ray.x * textureWidth);
+    __m128 rayV = _mm_set1_ps(-ray.y * textureHeight);
+    __m128i maskU4 = _mm_set1_epi32(maskU);
+    __m128i maskV4 = _mm_set1_epi32(maskV);
+    __m128i shade8 = _mm_set1_epi16((short)shade);
+
+    for (; y + 3 <= y1; y += 4, dst += width * 4)
+    {
+        // Depth of each row: the flat's height above the eye over the row's slope.
+        __m128 rowY = _mm_add_ps(_mm_set1_ps((float)y), rowOffset);
+        __m128 depth = _mm_div_ps(k4, _mm_sub_ps(horizon4, rowY));
+
+        __m128i u = _mm_and_si128(FloorToInt(_mm_add_ps(eyeU, _mm_mul_ps(rayU, depth))), maskU4);
+        __m128i v = _mm_and_si128(FloorToInt(_mm_add_ps(eyeV, _mm_mul_ps(rayV, depth))), maskV4);
+
+        alignas(16) int index[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_or_si128(_mm_slli_epi32(v, textureShift), u));
+
+        __m128i texels = _mm_setr_epi32((int)texture[index[0]], (int)texture[index[1]], (int)texture[index[2]], (int)texture[index[3]]);
+        StoreColumn(dst, width, ShadeTexels(texels, shade8));
+    }
+#endif
+
+    for (; y <= y1; ++y, dst += width)
+    {
+        float depth = k / (horizon - (y + 0.5f));
+        glm::vec2 world = eye2D + ray * depth;
+        int u = (int)std::floor(world.x * textureWidth) & maskU;
+        int v = (int)std::floor(-world.y * textureHeight) & maskV;
+        *dst = ShadeTexel(texture[(v << textureShift) | u], shade);
+    }
+}
+
+void ColumnRenderer::CountWrites(int x, int y0, int y1)
+{
+    numPixelWrites += y1 - y0 + 1;
+
+    if (checkOverdraw)
+    {
+        for (int y = y0; y <= y1; ++y)
+        {
+            uint8_t& count = writeCounts[y * width + x];
+            count = count < 255 ? count + 1 : count;
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "World/Map.h"
+
+// Renders a map the way classic sector engines do: walls are drawn column by column, and every
+// screen column keeps a top and bottom clip bound that narrows while portals are entered. Each
+// pixel is written at most once, so no depth buffer is needed.
+struct ColumnRenderer
+{
+    // The number of pixels written by the last frame.
+    int numPixelWrites;
+
+    // The number of pixels written more than once by the last frame, if overdraw checking is enabled.
+    int numOverdrawnPixels;
+
+    // The number of sector visits of the last frame.
+    int numSectorsDrawn;
+
+    // Whether every pixel write is counted to detect overdraw. Costs an extra buffer write per pixel.
+    bool checkOverdraw;
+
+    // Creates a new renderer with a target of the given size and a checker texture.
+    ColumnRenderer(int width, int height);
+
+    // Replaces the texture used for walls and flats. Both sizes must be powers of two.
+    void SetTexture(const uint32_t* pixels, int width, int height);
+
+    // Renders the map as seen from the given eye in the given sector.
+    void Render(const Map& map, int sector, const glm::vec3& eye, const glm::vec3& forward, float fovY);
+
+    // Returns the RGBA pixels of the last frame, top row first.
+    const uint32_t* GetPixels() const;
+
+    // Writes the last frame to the given PNG file. Returns false if the file could not be written.
+    bool WriteImage(const char* path) const;
+
+private:
+    struct Window
+    {
+        int sector;
+        int x1;
+        int x2;
+    };
+
+    struct WallSpan
+    {
+        int wall;
+        float nearestDepth;
+
+        // The screen x, 1/depth and texture u divided by depth at the left and right end.
+        float x[2];
+        float invDepth[2];
+        float uOverDepth[2];
+    };
+
+    // Projects the front facing walls of the sector and sorts them from near to far.
+    void CollectWalls(const Map& map, const Sector& sector);
+
+    // Draws rows y0 to y1 of the wall column with the texture column u.
+    void DrawWallColumn(int x, int y0, int y1, int u, float v, float vStep, int shade);
+
+    // Draws rows y0 to y1 of a floor or ceiling at the given height in column x.
+    void DrawFlatColumn(int x, int y0, int y1, float height, int shade);
+
+    // Counts the pixel writes of a column run.
+    void CountWrites(int x, int y0, int y1);
+
+    int width;
+    int height;
+
+    int textureWidth;
+    int textureHeight;
+    int textureShift;
+    std::vector<uint32_t> texture;
+
+    std::vector<uint32_t> pixels;
+    std::vector<uint8_t> writeCounts;
+
+    // The first and last row that may still be written in each column.
+    std::vector<int> columnTop;
+    std::vector<int> columnBottom;
+
+    // The sector visit that last drew into each column, so only the nearest wall of a sector claims it.
+    std::vector<int> columnVisit;
+
+    std::vector<Window> windows;
+    std::vector<WallSpan> wallSpans;
+    std::vector<int> sectorVisits;
+
+    // The view of the current frame in map space.
+    glm::vec2 eye2D;
+    glm::vec2 forward2D;
+    glm::vec2 right2D;
+    float eyeHeight;
+    float focalLength;
+    float horizon;
+};
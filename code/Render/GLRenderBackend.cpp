@@ -0,0 +1,130 @@
+#include "GLRenderBackend.h"
+#include <GLFW/glfw3.h>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Debug/Profiler.h"
+
+GLRenderBackend::GLRenderBackend()
+    : currentTexture(0)
+    , currentPointSize(1.0f)
+    , currentLineWidth(1.0f)
+    , viewHeight(0)
+{
+}
+
+uint32_t GLRenderBackend::CreateTexture(const uint32_t* pixels, int width, int height)
+{
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, GL_FALSE, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glBindTexture(GL_TEXTURE_2D, currentTexture);
+    return texture;
+}
+
+void GLRenderBackend::BeginFrame(const RenderView& view)
+{
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixf(glm::value_ptr(view.projection));
+
+    glMatrixMode(GL_MODELVIEW);
+    glLoadMatrixf(glm::value_ptr(view.view));
+
+    glViewport(0, 0, view.width, view.height);
+    viewHeight = view.height;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+}
+
+void GLRenderBackend::DrawBatch(const RenderBatch& batch)
+{
+    PROFILE_ZONE("Draw batch");
+
+    const RenderState& state = batch.state;
+
+    if (state.texture != currentTexture)
+    {
+        if (state.texture != 0)
+        {
+            glEnable(GL_TEXTURE_2D);
+            glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+            glBindTexture(GL_TEXTURE_2D, state.texture);
+        }
+        else
+        {
+            glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+            glDisable(GL_TEXTURE_2D);
+        }
+        currentTexture = state.texture;
+    }
+
+    if (state.primitive == PrimitiveType::Points && state.size != currentPointSize)
+    {
+        glPointSize(state.size);
+        currentPointSize = state.size;
+    }
+    else if (state.primitive == PrimitiveType::Lines && state.size != currentLineWidth)
+    {
+        glLineWidth(state.size);
+        currentLineWidth = state.size;
+    }
+
+    if (!(state.scissor == currentScissor))
+    {
+        if (state.scissor.IsEmpty())
+        {
+            glDisable(GL_SCISSOR_TEST);
+        }
+        else
+        {
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(state.scissor.min.x, viewHeight - state.scissor.max.y, state.scissor.max.x - state.scissor.min.x, state.scissor.max.y - state.scissor.min.y);
+        }
+        currentScissor = state.scissor;
+    }
+
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex), &batch.vertices[0].position);
+    glColorPointer(3, GL_FLOAT, sizeof(Vertex), &batch.vertices[0].color);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &batch.vertices[0].texCoord);
+
+    GLenum mode = GL_TRIANGLES;
+    if (state.primitive == PrimitiveType::Lines)
+    {
+        mode = GL_LINES;
+    }
+    else if (state.primitive == PrimitiveType::Points)
+    {
+        mode = GL_POINTS;
+    }
+
+    glDrawElements(mode, batch.numIndices, GL_UNSIGNED_INT, batch.indices);
+}
+
+void GLRenderBackend::EndFrame()
+{
+    if (currentTexture != 0)
+    {
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glDisable(GL_TEXTURE_2D);
+        currentTexture = 0;
+    }
+
+    if (!currentScissor.IsEmpty())
+    {
+        glDisable(GL_SCISSOR_TEST);
+        currentScissor = ScreenRect();
+    }
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "RenderBackend.h"
+
+// Draws batches with client side vertex arrays on the current OpenGL context.
+class GLRenderBackend : public RenderBackend
+{
+public:
+    // Creates a new backend for the current OpenGL context.
+    GLRenderBackend();
+
+    uint32_t CreateTexture(const uint32_t* pixels, int width, int height) override;
+    void BeginFrame(const RenderView& view) override;
+    void DrawBatch(const RenderBatch& batch) override;
+    void EndFrame() override;
+
+private:
+    // The state of the last batch, so unchanged state is not sent again.
+    uint32_t currentTexture;
+    float currentPointSize;
+    float currentLineWidth;
+    ScreenRect currentScissor;
+
+    // The height of the viewport, since scissor rectangles are given from the top while OpenGL counts from the bottom.
+    int viewHeight;
+};
@@ -0,0 +1,354 @@
+#include "OcclusionBuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Debug/Profiler.h"
+#include "Math/SimdLanes.h"
+
+namespace
+{
+    // Clip space vertices closer than this to the eye plane are clipped away.
+    constexpr float kNearClipEpsilon = 1e-5f;
+
+    // The depth of pixels no occluder was drawn into.
+    constexpr float kClearDepth = 1.0f;
+
+    // The x offset of each SIMD lane from the first pixel of a block.
+    constexpr float kLaneOffsets[8] = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+
+    float Edge(const glm::vec2& a, const glm::vec2& b, const glm::vec2& p)
+    {
+        return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+    }
+}
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+    : numOccluderTriangles(0)
+    , numOccludeesTested(0)
+    , numOccludeesRejected(0)
+    , width((width + Math::Lanes::kWidth - 1) / Math::Lanes::kWidth * Math::Lanes::kWidth)
+    , height(height)
+    , viewProjection(1.0f)
+{
+    depthBuffer.assign(this->width * height, kClearDepth);
+
+    int levelWidth = this->width;
+    int levelHeight = height;
+
+    while (true)
+    {
+        Level level;
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.minDepth.assign(levelWidth * levelHeight, kClearDepth);
+        level.maxDepth.assign(levelWidth * levelHeight, kClearDepth);
+        levels.push_back(std::move(level));
+
+        if (levelWidth == 1 && levelHeight == 1)
+        {
+            break;
+        }
+
+        levelWidth = std::max(1, (levelWidth + 1) / 2);
+        levelHeight = std::max(1, (levelHeight + 1) / 2);
+    }
+}
+
+void OcclusionBuffer::Begin(const glm::mat4& viewProjection)
+{
+    this->viewProjection = viewProjection;
+    std::fill(depthBuffer.begin(), depthBuffer.end(), kClearDepth);
+
+    numOccluderTriangles = 0;
+    numOccludeesTested = 0;
+    numOccludeesRejected = 0;
+}
+
+void OcclusionBuffer::AddTriangles(const Vertex* vertices, const uint32_t* indices, int numIndices, uint32_t baseVertex)
+{
+    for (int i = 0; i + 2 < numIndices; i += 3)
+    {
+        glm::vec4 triangle[3];
+        for (int j = 0; j < 3; ++j)
+        {
+            triangle[j] = viewProjection * glm::vec4(vertices[indices[i + j] - baseVertex].position, 1.0f);
+        }
+
+        AddClipTriangle(triangle);
+    }
+}
+
+void OcclusionBuffer::AddClipTriangle(const glm::vec4 vertices[3])
+{
+    glm::vec4 polygon[4];
+    int numVertices = 0;
+
+    // Clip against the near plane, z >= -w, which turns the triangle into at most a quad.
+    for (int i = 0; i < 3; ++i)
+    {
+        const glm::vec4& a = vertices[i];
+        const glm::vec4& b = vertices[(i + 1) % 3];
+        float da = a.z + a.w;
+        float db = b.z + b.w;
+
+        if (da >= kNearClipEpsilon)
+        {
+            polygon[numVertices++] = a;
+        }
+
+        if ((da >= kNearClipEpsilon) != (db >= kNearClipEpsilon))
+        {
+            polygon[numVertices++] = glm::mix(a, b, (kNearClipEpsilon - da) / (db - da));
+        }
+    }
+
+    for (int i = 1; i + 1 < numVertices; ++i)
+    {
+        glm::vec4 triangle[3] = { polygon[0], polygon[i], polygon[i + 1] };
+        RasterizeTriangle(triangle);
+    }
+}
+
+void OcclusionBuffer::RasterizeTriangle(const glm::vec4 vertices[3])
+{
+    using Math::Lanes;
+
+    glm::vec2 p[3];
+    float depth[3];
+
+    for (int i = 0; i < 3; ++i)
+    {
+        float invW = 1.0f / vertices[i].w;
+        glm::vec3 ndc = glm::vec3(vertices[i]) * invW;
+        p[i] = glm::vec2((ndc.x * 0.5f + 0.5f) * width, (0.5f - ndc.y * 0.5f) * height);
+        depth[i] = ndc.z * 0.5f + 0.5f;
+    }
+
+    // Counter-clockwise triangles face the viewer, which is clockwise once y points down. The renderers cull the
+    // others, so they hide nothing.
+    float area = Edge(p[0], p[1], p[2]);
+    if (!(area < 0.0f))
+    {
+        return;
+    }
+
+    // Rasterization expects a positive area.
+    std::swap(p[1], p[2]);
+    std::swap(depth[1], depth[2]);
+    area = -area;
+
+    numOccluderTriangles++;
+
+    // Only pixels whose whole square lies inside the triangle are covered.
+    int minX = std::max(0, (int)std::ceil(std::min({ p[0].x, p[1].x, p[2].x })));
+    int minY = std::max(0, (int)std::ceil(std::min({ p[0].y, p[1].y, p[2].y })));
+    int maxX = std::min(width - 1, (int)std::floor(std::max({ p[0].x, p[1].x, p[2].x })) - 1);
+    int maxY = std::min(height - 1, (int)std::floor(std::max({ p[0].y, p[1].y, p[2].y })) - 1);
+
+    if (minX > maxX || minY > maxY)
+    {
+        return;
+    }
+
+    // The edge functions step by these amounts per pixel, and a pixel lies fully inside an edge when the function
+    // at its center exceeds half the sum of both steps.
+    float stepX[3] = { p[1].y - p[2].y, p[2].y - p[0].y, p[0].y - p[1].y };
+    float stepY[3] = { p[2].x - p[1].x, p[0].x - p[2].x, p[1].x - p[0].x };
+    float bias[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        bias[i] = 0.5f * (std::abs(stepX[i]) + std::abs(stepY[i]));
+    }
+
+    // Depth is linear in screen space. Each pixel is written with the farthest depth the triangle reaches in it.
+    float invArea = 1.0f / area;
+    float depthStepX = (stepX[0] * depth[0] + stepX[1] * depth[1] + stepX[2] * depth[2]) * invArea;
+    float depthStepY = (stepY[0] * depth[0] + stepY[1] * depth[1] + stepY[2] * depth[2]) * invArea;
+    float depthBias = 0.5f * (std::abs(depthStepX) + std::abs(depthStepY));
+
+    Lanes::Type offsets = Lanes::Load(kLaneOffsets);
+    Lanes::Type laneStep0 = Lanes::Mul(offsets, Lanes::Set(stepX[0]));
+    Lanes::Type laneStep1 = Lanes::Mul(offsets, Lanes::Set(stepX[1]));
+    Lanes::Type laneStep2 = Lanes::Mul(offsets, Lanes::Set(stepX[2]));
+    Lanes::Type laneDepthStep = Lanes::Mul(offsets, Lanes::Set(depthStepX));
+    Lanes::Type bias0 = Lanes::Set(bias[0]);
+    Lanes::Type bias1 = Lanes::Set(bias[1]);
+    Lanes::Type bias2 = Lanes::Set(bias[2]);
+    Lanes::Type first = Lanes::Set((float)minX);
+    Lanes::Type last = Lanes::Set((float)maxX);
+
+    // Blocks start on a multiple of the SIMD width, which the buffer width is rounded to.
+    int startX = minX - minX % Lanes::kWidth;
+
+    for (int y = minY; y <= maxY; ++y)
+    {
+        float* row = &depthBuffer[y * width];
+
+        for (int x = startX; x <= maxX; x += Lanes::kWidth)
+        {
+            glm::vec2 center = glm::vec2(x + 0.5f, y + 0.5f);
+            float w0 = Edge(p[1], p[2], center);
+            float w1 = Edge(p[2], p[0], center);
+            float w2 = Edge(p[0], p[1], center);
+            float z = (w0 * depth[0] + w1 * depth[1] + w2 * depth[2]) * invArea + depthBias;
+
+            Lanes::Type laneX = Lanes::Add(Lanes::Set((float)x), offsets);
+            Lanes::Type inside = Lanes::And(Lanes::GreaterEqual(laneX, first), Lanes::LessEqual(laneX, last));
+            inside = Lanes::And(inside, Lanes::GreaterEqual(Lanes::Add(Lanes::Set(w0), laneStep0), bias0));
+            inside = Lanes::And(inside, Lanes::GreaterEqual(Lanes::Add(Lanes::Set(w1), laneStep1), bias1));
+            inside = Lanes::And(inside, Lanes::GreaterEqual(Lanes::Add(Lanes::Set(w2), laneStep2), bias2));
+
+            if (Lanes::GetMask(inside) == 0)
+            {
+                continue;
+            }
+
+            Lanes::Type laneDepth = Lanes::Add(Lanes::Set(z), laneDepthStep);
+            Lanes::Type current = Lanes::Load(row + x);
+            Lanes::Store(row + x, Lanes::Select(inside, Lanes::Min(current, laneDepth), current));
+        }
+    }
+}
+
+void OcclusionBuffer::BuildHierarchy()
+{
+    PROFILE_ZONE("Occlusion hierarchy");
+
+    levels[0].minDepth = depthBuffer;
+    levels[0].maxDepth = depthBuffer;
+
+    for (size_t i = 1; i < levels.size(); ++i)
+    {
+        const Level& source = levels[i - 1];
+        Level& level = levels[i];
+
+        for (int y = 0; y < level.height; ++y)
+        {
+            int y0 = std::min(y * 2, source.height - 1) * source.width;
+            int y1 = std::min(y * 2 + 1, source.height - 1) * source.width;
+
+            for (int x = 0; x < level.width; ++x)
+            {
+                int x0 = std::min(x * 2, source.width - 1);
+                int x1 = std::min(x * 2 + 1, source.width - 1);
+
+                level.minDepth[y * level.width + x] = std::min({ source.minDepth[y0 + x0], source.minDepth[y0 + x1], source.minDepth[y1 + x0], source.minDepth[y1 + x1] });
+                level.maxDepth[y * level.width + x] = std::max({ source.maxDepth[y0 + x0], source.maxDepth[y0 + x1], source.maxDepth[y1 + x0], source.maxDepth[y1 + x1] });
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::IsVisible(const Box& box)
+{
+    numOccludeesTested++;
+
+    if (TestBox(box))
+    {
+        return true;
+    }
+
+    numOccludeesRejected++;
+    return false;
+}
+
+bool OcclusionBuffer::TestBox(const Box& box) const
+{
+    std::array<glm::vec3, 8> corners;
+    box.GetCornerPoints(corners);
+
+    glm::vec2 min = glm::vec2(std::numeric_limits<float>::max());
+    glm::vec2 max = glm::vec2(std::numeric_limits<float>::lowest());
+    float nearestDepth = kClearDepth;
+
+    for (const glm::vec3& corner : corners)
+    {
+        glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+
+        // Boxes reaching past the near plane are too close to say anything about.
+        if (clip.z + clip.w < kNearClipEpsilon)
+        {
+            return true;
+        }
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        glm::vec2 position = glm::vec2((ndc.x * 0.5f + 0.5f) * width, (0.5f - ndc.y * 0.5f) * height);
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+        nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+    }
+
+    int minX = std::max(0, (int)std::floor(min.x));
+    int minY = std::max(0, (int)std::floor(min.y));
+    int maxX = std::min(width - 1, (int)std::floor(max.x));
+    int maxY = std::min(height - 1, (int)std::floor(max.y));
+
+    // Boxes outside the screen are left to frustum culling.
+    if (minX > maxX || minY > maxY)
+    {
+        return true;
+    }
+
+    // Start at the level where the box covers at most a few texels in each direction.
+    int level = 0;
+    while (level + 1 < (int)levels.size() && std::max(maxX - minX, maxY - minY) >> level > 1)
+    {
+        level++;
+    }
+
+    return IsRegionVisible(level, minX, minY, maxX, maxY, nearestDepth);
+}
+
+bool OcclusionBuffer::IsRegionVisible(int level, int minX, int minY, int maxX, int maxY, float depth) const
+{
+    const Level& source = levels[level];
+
+    for (int y = minY >> level; y <= maxY >> level; ++y)
+    {
+        for (int x = minX >> level; x <= maxX >> level; ++x)
+        {
+            int index = y * source.width + x;
+
+            // Every occluder below the texel is nearer than the box.
+            if (depth > source.maxDepth[index])
+            {
+                continue;
+            }
+
+            // The box is nearer than every occluder below the texel, or there are no finer texels to look at.
+            if (level == 0 || depth <= source.minDepth[index])
+            {
+                return true;
+            }
+
+            // Otherwise only the finer texels tell, restricted to the part of the box inside this texel.
+            int childMinX = std::max(minX, x << level);
+            int childMinY = std::max(minY, y << level);
+            int childMaxX = std::min(maxX, ((x + 1) << level) - 1);
+            int childMaxY = std::min(maxY, ((y + 1) << level) - 1);
+
+            if (IsRegionVisible(level - 1, childMinX, childMinY, childMaxX, childMaxY, depth))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+int OcclusionBuffer::GetWidth() const
+{
+    return width;
+}
+
+int OcclusionBuffer::GetHeight() const
+{
+    return height;
+}
+
+int OcclusionBuffer::GetNumLevels() const
+{
+    return (int)levels.size();
+}
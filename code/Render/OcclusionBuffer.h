@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Math/Box.h"
+#include "Vertex.h"
+
+// A low resolution depth buffer of occluders on the CPU. The buffer keeps a chain of mip levels holding the nearest
+// and farthest depth below each texel, and boxes are tested against the chain from coarse to fine so everything
+// hidden behind the occluders can be skipped before it is submitted. Occluders only cover pixels they cover fully,
+// at their farthest depth within the pixel, so a box is never rejected while any part of it could be seen.
+struct OcclusionBuffer
+{
+    // The number of occluder triangles rasterized since the last Begin.
+    int numOccluderTriangles;
+
+    // The number of boxes tested since the last Begin.
+    int numOccludeesTested;
+
+    // The number of boxes found hidden since the last Begin.
+    int numOccludeesRejected;
+
+    // Creates a new buffer of the given size. The width is rounded up to a multiple of the SIMD width.
+    OcclusionBuffer(int width = 256, int height = 128);
+
+    // Clears the buffer and the counters for a new frame seen through the given view projection.
+    void Begin(const glm::mat4& viewProjection);
+
+    // Rasterizes the given indexed triangles into the buffer. The indices are relative to the given base vertex.
+    // Back faces are skipped, since the renderers cull them and they hide nothing.
+    void AddTriangles(const Vertex* vertices, const uint32_t* indices, int numIndices, uint32_t baseVertex = 0);
+
+    // Builds the mip levels from the rasterized occluders. Must be called before any box is tested.
+    void BuildHierarchy();
+
+    // Returns false if the box is hidden behind the occluders, and counts the test.
+    bool IsVisible(const Box& box);
+
+    // Returns false if the box is hidden behind the occluders without counting the test, so boxes can be tested from
+    // several threads at once.
+    bool TestBox(const Box& box) const;
+
+    // Returns the width of the buffer.
+    int GetWidth() const;
+
+    // Returns the height of the buffer.
+    int GetHeight() const;
+
+    // Returns the number of mip levels, including the full resolution level.
+    int GetNumLevels() const;
+
+private:
+    struct Level
+    {
+        int width;
+        int height;
+
+        // The nearest and farthest occluder depth below each texel, with 1 where nothing was drawn.
+        std::vector<float> minDepth;
+        std::vector<float> maxDepth;
+    };
+
+    // Rasterizes a clip space triangle that lies in front of the near plane.
+    void RasterizeTriangle(const glm::vec4 vertices[3]);
+
+    // Clips a clip space triangle against the near plane and rasterizes what remains.
+    void AddClipTriangle(const glm::vec4 vertices[3]);
+
+    // Returns true if any part of the texel rectangle at the given level could show something at the given depth.
+    bool IsRegionVisible(int level, int minX, int minY, int maxX, int maxY, float depth) const;
+
+    int width;
+    int height;
+
+    glm::mat4 viewProjection;
+
+    // The full resolution occluder depth, nearest depth per pixel.
+    std::vector<float> depthBuffer;
+
+    std::vector<Level> levels;
+};
@@ -0,0 +1,72 @@
+#include "RecordingRenderBackend.h"
+
+RecordingRenderBackend::RecordingRenderBackend()
+    : recordBatches(false)
+    , current()
+    , numTextures(0)
+{
+}
+
+uint32_t RecordingRenderBackend::CreateTexture(const uint32_t* pixels, int width, int height)
+{
+    return ++numTextures;
+}
+
+void RecordingRenderBackend::BeginFrame(const RenderView& view)
+{
+    current = FrameStats();
+    currentBatches.clear();
+    currentBatchVertices.clear();
+    currentBatchIndices.clear();
+}
+
+void RecordingRenderBackend::DrawBatch(const RenderBatch& batch)
+{
+    int indicesPerPrimitive = 3;
+    if (batch.state.primitive == PrimitiveType::Lines)
+    {
+        indicesPerPrimitive = 2;
+    }
+    else if (batch.state.primitive == PrimitiveType::Points)
+    {
+        indicesPerPrimitive = 1;
+    }
+
+    current.numDrawCalls++;
+    current.numVertices += batch.numVertices;
+    current.numPrimitives += batch.numIndices / indicesPerPrimitive;
+
+    if (recordBatches)
+    {
+        currentBatchVertices.emplace_back(batch.vertices, batch.vertices + batch.numVertices);
+        currentBatchIndices.emplace_back(batch.indices, batch.indices + batch.numIndices);
+
+        RenderBatch copy = batch;
+        copy.vertices = currentBatchVertices.back().data();
+        copy.indices = currentBatchIndices.back().data();
+        currentBatches.push_back(copy);
+    }
+}
+
+void RecordingRenderBackend::EndFrame()
+{
+    frames.push_back(current);
+    batches.swap(currentBatches);
+    batchVertices.swap(currentBatchVertices);
+    batchIndices.swap(currentBatchIndices);
+}
+
+float RecordingRenderBackend::GetAverageDrawCalls() const
+{
+    if (frames.empty())
+    {
+        return 0.0f;
+    }
+
+    int numDrawCalls = 0;
+    for (const FrameStats& frame : frames)
+    {
+        numDrawCalls += frame.numDrawCalls;
+    }
+    return (float)numDrawCalls / (float)frames.size();
+}
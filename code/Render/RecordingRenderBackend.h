@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+
+#include "RenderBackend.h"
+
+// Records what would have been drawn without drawing anything, for headless runs and batching statistics.
+class RecordingRenderBackend : public RenderBackend
+{
+public:
+    struct FrameStats
+    {
+        // The number of batches drawn during the frame.
+        int numDrawCalls;
+
+        // The number of vertices submitted during the frame.
+        int numVertices;
+
+        // The number of primitives submitted during the frame.
+        int numPrimitives;
+    };
+
+    // The statistics of every finished frame.
+    std::vector<FrameStats> frames;
+
+    // The batches of the last finished frame when batch recording is enabled.
+    std::vector<RenderBatch> batches;
+
+    // Whether the batches of each frame are kept. Their vertices and indices are copied, so they stay valid after
+    // the queue that submitted them is cleared, until the next frame finishes.
+    bool recordBatches;
+
+    // Creates a new backend that only records statistics.
+    RecordingRenderBackend();
+
+    uint32_t CreateTexture(const uint32_t* pixels, int width, int height) override;
+    void BeginFrame(const RenderView& view) override;
+    void DrawBatch(const RenderBatch& batch) override;
+    void EndFrame() override;
+
+    // Returns the average number of draw calls per frame.
+    float GetAverageDrawCalls() const;
+
+private:
+    FrameStats current;
+    std::vector<RenderBatch> currentBatches;
+
+    // The copies the recorded batches point to. Moving the inner vectors keeps their data in place.
+    std::vector<std::vector<Vertex>> batchVertices;
+    std::vector<std::vector<uint32_t>> batchIndices;
+    std::vector<std::vector<Vertex>> currentBatchVertices;
+    std::vector<std::vector<uint32_t>> currentBatchIndices;
+    uint32_t numTextures;
+};
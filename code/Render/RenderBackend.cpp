@@ -0,0 +1,26 @@
+#include "RenderBackend.h"
+#include <cstring>
+
+uint64_t RenderState::GetSortKey() const
+{
+    uint32_t sizeBits;
+    std::memcpy(&sizeBits, &size, sizeof(sizeBits));
+    return (uint64_t(primitive) << 62) | (uint64_t(texture) << 30) | (sizeBits >> 2);
+}
+
+size_t RenderState::GetHash() const
+{
+    // FNV-1a over the sort key and the scissor extents.
+    uint64_t values[] = { GetSortKey(), uint64_t(uint32_t(scissor.min.x)), uint64_t(uint32_t(scissor.min.y)), uint64_t(uint32_t(scissor.max.x)), uint64_t(uint32_t(scissor.max.y)) };
+    size_t hash = 14695981039346656037ull;
+    for (uint64_t value : values)
+    {
+        hash = (hash ^ value) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool RenderState::operator==(const RenderState& other) const
+{
+    return primitive == other.primitive && texture == other.texture && size == other.size && scissor == other.scissor;
+}
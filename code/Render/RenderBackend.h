@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "Math/ScreenRect.h"
+#include "Vertex.h"
+
+enum class PrimitiveType : uint8_t
+{
+    Triangles,
+    Lines,
+    Points
+};
+
+struct RenderState
+{
+    // The type of primitives the indices describe.
+    PrimitiveType primitive;
+
+    // The texture to sample or 0 if the primitives are untextured.
+    uint32_t texture;
+
+    // The point size or line width.
+    float size;
+
+    // The pixels the primitives are clipped to, or an empty rectangle to draw to the whole target.
+    ScreenRect scissor;
+
+    // Returns the key that batches are sorted by. The scissor is not part of the key, so batches that only differ
+    // in their scissor keep the order they were submitted in.
+    uint64_t GetSortKey() const;
+
+    // Returns a hash of all fields, including the scissor.
+    size_t GetHash() const;
+
+    // Returns true if both states can be drawn in the same batch.
+    bool operator==(const RenderState& other) const;
+};
+
+struct RenderView
+{
+    // The projection matrix of the frame.
+    glm::mat4 projection;
+
+    // The view matrix of the frame.
+    glm::mat4 view;
+
+    // The width of the viewport in pixels.
+    int width;
+
+    // The height of the viewport in pixels.
+    int height;
+};
+
+struct RenderBatch
+{
+    // The state all primitives of the batch are drawn with.
+    RenderState state;
+
+    // The vertices of the batch.
+    const Vertex* vertices;
+
+    // The number of vertices of the batch.
+    int numVertices;
+
+    // The indices into the vertices of the batch.
+    const uint32_t* indices;
+
+    // The number of indices of the batch.
+    int numIndices;
+};
+
+class RenderBackend
+{
+public:
+    virtual ~RenderBackend() = default;
+
+    // Creates a texture from the given RGBA pixels and returns its non-zero id.
+    virtual uint32_t CreateTexture(const uint32_t* pixels, int width, int height) = 0;
+
+    // Starts a new frame seen through the given view and clears the targets.
+    virtual void BeginFrame(const RenderView& view) = 0;
+
+    // Draws the given batch.
+    virtual void DrawBatch(const RenderBatch& batch) = 0;
+
+    // Finishes the current frame.
+    virtual void EndFrame() = 0;
+};
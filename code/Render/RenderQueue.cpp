@@ -0,0 +1,168 @@
+#include "RenderQueue.h"
+#include <algorithm>
+
+#include "Debug/Profiler.h"
+
+RenderQueue::RenderQueue()
+    : numItems(0)
+    , numBatches(0)
+    , buckets(frameArena)
+    , sortedBuckets(frameArena)
+    , bucketIndices(FrameAllocator<std::pair<const RenderState, int>>(frameArena))
+    , lastBucket(-1)
+    , numQueuedItems(0)
+{
+}
+
+void RenderQueue::Add(const RenderState& state, const Vertex* vertices, int numVertices, const uint32_t* indices, int numIndices, uint32_t baseVertex)
+{
+    Bucket& bucket = GetBucket(state);
+    uint32_t offset = (uint32_t)bucket.vertices.size();
+
+    bucket.vertices.insert(bucket.vertices.end(), vertices, vertices + numVertices);
+
+    size_t firstIndex = bucket.indices.size();
+    bucket.indices.resize(firstIndex + numIndices);
+    for (int i = 0; i < numIndices; ++i)
+    {
+        bucket.indices[firstIndex + i] = indices[i] - baseVertex + offset;
+    }
+
+    numQueuedItems++;
+}
+
+void RenderQueue::AddPoints(const glm::vec3* points, int count, const glm::vec3& color, float size)
+{
+    Bucket& bucket = GetBucket({ PrimitiveType::Points, 0, size, ScreenRect() });
+
+    for (int i = 0; i < count; ++i)
+    {
+        bucket.indices.push_back((uint32_t)bucket.vertices.size());
+        bucket.vertices.push_back({ points[i], glm::vec2(0.0f), color });
+    }
+
+    numQueuedItems++;
+}
+
+void RenderQueue::AddLines(const glm::vec3* points, int count, const glm::vec3& color, float width)
+{
+    Bucket& bucket = GetBucket({ PrimitiveType::Lines, 0, width, ScreenRect() });
+
+    for (int i = 0; i + 1 < count; i += 2)
+    {
+        uint32_t offset = (uint32_t)bucket.vertices.size();
+        bucket.vertices.push_back({ points[i], glm::vec2(0.0f), color });
+        bucket.vertices.push_back({ points[i + 1], glm::vec2(0.0f), color });
+        bucket.indices.push_back(offset);
+        bucket.indices.push_back(offset + 1);
+    }
+
+    numQueuedItems++;
+}
+
+void RenderQueue::AddLineLoop(const glm::vec3* points, int count, const glm::vec3& color, float width)
+{
+    Bucket& bucket = GetBucket({ PrimitiveType::Lines, 0, width, ScreenRect() });
+    uint32_t offset = (uint32_t)bucket.vertices.size();
+
+    for (int i = 0; i < count; ++i)
+    {
+        bucket.vertices.push_back({ points[i], glm::vec2(0.0f), color });
+        bucket.indices.push_back(offset + i);
+        bucket.indices.push_back(offset + (i + 1) % count);
+    }
+
+    numQueuedItems++;
+}
+
+void RenderQueue::AddPolygon(const Vertex* vertices, int count, uint32_t texture)
+{
+    Bucket& bucket = GetBucket({ PrimitiveType::Triangles, texture, 1.0f, ScreenRect() });
+    uint32_t offset = (uint32_t)bucket.vertices.size();
+
+    bucket.vertices.insert(bucket.vertices.end(), vertices, vertices + count);
+    for (int i = 1; i + 1 < count; ++i)
+    {
+        bucket.indices.push_back(offset);
+        bucket.indices.push_back(offset + i);
+        bucket.indices.push_back(offset + i + 1);
+    }
+
+    numQueuedItems++;
+}
+
+void RenderQueue::Flush(RenderBackend& backend, const RenderView& view)
+{
+    PROFILE_ZONE("Flush");
+
+    sortedBuckets.reserve(buckets.size());
+    for (Bucket& bucket : buckets)
+    {
+        if (!bucket.indices.empty())
+        {
+            sortedBuckets.push_back(&bucket);
+        }
+    }
+
+    // Buckets are stored in the order their states were first queued, so comparing their addresses keeps that order
+    // among states that only differ in their scissor. std::stable_sort would do the same but takes a buffer from the
+    // heap on every flush.
+    std::sort(sortedBuckets.begin(), sortedBuckets.end(), [](const Bucket* a, const Bucket* b) {
+        return a->sortKey != b->sortKey ? a->sortKey < b->sortKey : a < b;
+    });
+
+    backend.BeginFrame(view);
+
+    for (const Bucket* bucket : sortedBuckets)
+    {
+        RenderBatch batch;
+        batch.state = bucket->state;
+        batch.vertices = bucket->vertices.data();
+        batch.numVertices = (int)bucket->vertices.size();
+        batch.indices = bucket->indices.data();
+        batch.numIndices = (int)bucket->indices.size();
+        backend.DrawBatch(batch);
+    }
+
+    backend.EndFrame();
+
+    numItems = numQueuedItems;
+    numBatches = (int)sortedBuckets.size();
+    Clear();
+}
+
+void RenderQueue::Clear()
+{
+    size_t numBuckets = buckets.size();
+
+    // The buckets, their contents and their index live in the arena, so they are destroyed before resetting it,
+    // which may free the block they were taken from.
+    buckets = FrameVector<Bucket>(frameArena);
+    sortedBuckets = FrameVector<Bucket*>(frameArena);
+    bucketIndices = BucketMap(FrameAllocator<std::pair<const RenderState, int>>(frameArena));
+    frameArena.Reset();
+    buckets.reserve(numBuckets);
+    bucketIndices.reserve(numBuckets);
+
+    lastBucket = -1;
+    numQueuedItems = 0;
+}
+
+RenderQueue::Bucket& RenderQueue::GetBucket(const RenderState& state)
+{
+    // Consecutive items usually share their state.
+    if (lastBucket != -1 && buckets[lastBucket].state == state)
+    {
+        return buckets[lastBucket];
+    }
+
+    auto [it, inserted] = bucketIndices.try_emplace(state, (int)buckets.size());
+    lastBucket = it->second;
+    if (!inserted)
+    {
+        return buckets[lastBucket];
+    }
+
+    buckets.push_back({ state, state.GetSortKey(), FrameVector<Vertex>(frameArena), FrameVector<uint32_t>(frameArena) });
+    return buckets.back();
+}
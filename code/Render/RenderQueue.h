@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "RenderBackend.h"
+#include "Vertex.h"
+#include "Memory/FrameArena.h"
+
+struct RenderQueue
+{
+    // The number of draw items submitted by the last flush.
+    int numItems;
+
+    // The number of batches the last flush submitted to the backend.
+    int numBatches;
+
+    // Creates a new empty render queue.
+    RenderQueue();
+
+    // Adds indexed primitives. The indices are relative to the given base vertex.
+    void Add(const RenderState& state, const Vertex* vertices, int numVertices, const uint32_t* indices, int numIndices, uint32_t baseVertex = 0);
+
+    // Adds the given points.
+    void AddPoints(const glm::vec3* points, int count, const glm::vec3& color, float size);
+
+    // Adds independent lines, two points per line.
+    void AddLines(const glm::vec3* points, int count, const glm::vec3& color, float width);
+
+    // Adds a closed loop of lines through the given points.
+    void AddLineLoop(const glm::vec3* points, int count, const glm::vec3& color, float width);
+
+    // Adds a convex polygon as a fan of triangles.
+    void AddPolygon(const Vertex* vertices, int count, uint32_t texture = 0);
+
+    // Sorts the queued items by state, submits one batch per state to the backend and clears the queue.
+    void Flush(RenderBackend& backend, const RenderView& view);
+
+    // Removes all queued items and takes back their storage.
+    void Clear();
+
+private:
+    struct Bucket
+    {
+        RenderState state;
+        uint64_t sortKey;
+        FrameVector<Vertex> vertices;
+        FrameVector<uint32_t> indices;
+    };
+
+    struct StateHash
+    {
+        size_t operator()(const RenderState& state) const
+        {
+            return state.GetHash();
+        }
+    };
+
+    using BucketMap = std::unordered_map<RenderState, int, StateHash, std::equal_to<RenderState>, FrameAllocator<std::pair<const RenderState, int>>>;
+
+    // Returns the bucket collecting the given state, adding a new one if no bucket has it yet.
+    Bucket& GetBucket(const RenderState& state);
+
+    // Every state of a frame gets its own bucket, and with scissors that is one per drawn sector, so the buckets
+    // and their contents are taken from an arena that is reset once the backend consumed them.
+    FrameArena frameArena;
+    FrameVector<Bucket> buckets;
+    FrameVector<Bucket*> sortedBuckets;
+
+    // The index of the bucket of every state queued this frame.
+    BucketMap bucketIndices;
+    int lastBucket;
+    int numQueuedItems;
+};
@@ -0,0 +1,462 @@
+#include "SoftwareRenderBackend.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include <stb_image_write.h>
+
+#include "Debug/Profiler.h"
+
+namespace
+{
+    // Clip space vertices closer than this to the eye plane are clipped away.
+    constexpr float kNearClipEpsilon = 1e-5f;
+
+    float Edge(const glm::vec2& a, const glm::vec2& b, const glm::vec2& p)
+    {
+        return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+    }
+
+    // Returns true if pixels exactly on the edge belong to the triangle.
+    bool IsTopLeft(const glm::vec2& a, const glm::vec2& b)
+    {
+        glm::vec2 d = b - a;
+        return d.y < 0.0f || (d.y == 0.0f && d.x > 0.0f);
+    }
+
+    uint32_t PackColor(const glm::vec3& color)
+    {
+        glm::vec3 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+        return 0xFF000000u | (uint32_t(c.b) << 16) | (uint32_t(c.g) << 8) | uint32_t(c.r);
+    }
+
+    glm::vec3 UnpackColor(uint32_t color)
+    {
+        return glm::vec3(color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF) / 255.0f;
+    }
+}
+
+SoftwareRenderBackend::SoftwareRenderBackend(int width, int height, JobSystem* jobs)
+    : width(0)
+    , height(0)
+    , numTilesX(0)
+    , numTilesY(0)
+    , jobs(jobs)
+    , viewProjection(1.0f)
+    , primitives(frameArena)
+{
+    RenderView view = { glm::mat4(1.0f), glm::mat4(1.0f), width, height };
+    BeginFrame(view);
+}
+
+uint32_t SoftwareRenderBackend::CreateTexture(const uint32_t* pixels, int width, int height)
+{
+    Texture texture;
+    texture.width = width;
+    texture.height = height;
+    texture.pixels.assign(pixels, pixels + width * height);
+    textures.push_back(std::move(texture));
+    return (uint32_t)textures.size();
+}
+
+void SoftwareRenderBackend::BeginFrame(const RenderView& view)
+{
+    if (view.width != width || view.height != height)
+    {
+        width = view.width;
+        height = view.height;
+        numTilesX = (width + kTileSize - 1) / kTileSize;
+        numTilesY = (height + kTileSize - 1) / kTileSize;
+        colorBuffer.resize(width * height);
+        depthBuffer.resize(width * height);
+        bins.assign(numTilesX * numTilesY, FrameVector<uint32_t>(frameArena));
+        tileFragments.resize(numTilesX * numTilesY);
+    }
+
+    viewProjection = view.projection * view.view;
+
+    std::fill(colorBuffer.begin(), colorBuffer.end(), 0xFF000000u);
+    std::fill(depthBuffer.begin(), depthBuffer.end(), 1.0f);
+
+    frameArena.Reset();
+
+    size_t numPrimitives = primitives.size();
+    primitives = FrameVector<Primitive>(frameArena);
+    primitives.reserve(numPrimitives);
+
+    for (FrameVector<uint32_t>& bin : bins)
+    {
+        size_t binSize = bin.size();
+        bin = FrameVector<uint32_t>(frameArena);
+        bin.reserve(binSize);
+    }
+}
+
+void SoftwareRenderBackend::DrawBatch(const RenderBatch& batch)
+{
+    PROFILE_ZONE("Bin batch");
+
+    clipVertices.resize(batch.numVertices);
+    for (int i = 0; i < batch.numVertices; ++i)
+    {
+        const Vertex& vertex = batch.vertices[i];
+        clipVertices[i] = { viewProjection * glm::vec4(vertex.position, 1.0f), vertex.color, vertex.texCoord };
+    }
+
+    const RenderState& state = batch.state;
+
+    if (state.primitive == PrimitiveType::Triangles)
+    {
+        for (int i = 0; i + 2 < batch.numIndices; i += 3)
+        {
+            ClipVertex triangle[3] = {
+                clipVertices[batch.indices[i]],
+                clipVertices[batch.indices[i + 1]],
+                clipVertices[batch.indices[i + 2]]
+            };
+            AddTriangle(state, triangle);
+        }
+    }
+    else if (state.primitive == PrimitiveType::Lines)
+    {
+        for (int i = 0; i + 1 < batch.numIndices; i += 2)
+        {
+            ClipVertex line[2] = { clipVertices[batch.indices[i]], clipVertices[batch.indices[i + 1]] };
+            float d0 = line[0].position.z + line[0].position.w;
+            float d1 = line[1].position.z + line[1].position.w;
+
+            if (d0 < kNearClipEpsilon && d1 < kNearClipEpsilon)
+            {
+                continue;
+            }
+
+            if (d0 < kNearClipEpsilon || d1 < kNearClipEpsilon)
+            {
+                int outside = d0 < kNearClipEpsilon ? 0 : 1;
+                float t = (kNearClipEpsilon - d0) / (d1 - d0);
+                line[outside].position = glm::mix(line[0].position, line[1].position, t);
+                line[outside].color = glm::mix(line[0].color, line[1].color, t);
+                line[outside].texCoord = glm::mix(line[0].texCoord, line[1].texCoord, t);
+            }
+
+            AddPrimitive(PrimitiveType::Lines, state, line);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < batch.numIndices; ++i)
+        {
+            const ClipVertex& point = clipVertices[batch.indices[i]];
+            if (point.position.z + point.position.w >= kNearClipEpsilon)
+            {
+                AddPrimitive(PrimitiveType::Points, state, &point);
+            }
+        }
+    }
+}
+
+void SoftwareRenderBackend::EndFrame()
+{
+    PROFILE_ZONE("Rasterize");
+
+    int numTiles = numTilesX * numTilesY;
+
+    auto RasterizeTiles = [&](int begin, int end) {
+        PROFILE_ZONE("Rasterize tiles");
+        for (int tile = begin; tile < end; ++tile)
+        {
+            RasterizeTile(tile);
+        }
+    };
+
+    if (jobs)
+    {
+        jobs->ParallelFor(numTiles, kTilesPerJob, RasterizeTiles);
+    }
+    else
+    {
+        RasterizeTiles(0, numTiles);
+    }
+}
+
+const uint32_t* SoftwareRenderBackend::GetPixels() const
+{
+    return colorBuffer.data();
+}
+
+int SoftwareRenderBackend::GetWidth() const
+{
+    return width;
+}
+
+int SoftwareRenderBackend::GetHeight() const
+{
+    return height;
+}
+
+int SoftwareRenderBackend::GetNumPrimitives() const
+{
+    return (int)primitives.size();
+}
+
+int SoftwareRenderBackend::GetNumFragments() const
+{
+    return std::accumulate(tileFragments.begin(), tileFragments.end(), 0);
+}
+
+bool SoftwareRenderBackend::WriteImage(const char* path) const
+{
+    return stbi_write_png(path, width, height, 4, colorBuffer.data(), width * 4) != 0;
+}
+
+void SoftwareRenderBackend::AddTriangle(const RenderState& state, const ClipVertex vertices[3])
+{
+    ClipVertex polygon[4];
+    int numVertices = 0;
+
+    // Clip against the near plane, z >= -w, which turns the triangle into at most a quad.
+    for (int i = 0; i < 3; ++i)
+    {
+        const ClipVertex& a = vertices[i];
+        const ClipVertex& b = vertices[(i + 1) % 3];
+        float da = a.position.z + a.position.w;
+        float db = b.position.z + b.position.w;
+
+        if (da >= kNearClipEpsilon)
+        {
+            polygon[numVertices++] = a;
+        }
+
+        if ((da >= kNearClipEpsilon) != (db >= kNearClipEpsilon))
+        {
+            float t = (kNearClipEpsilon - da) / (db - da);
+            polygon[numVertices++] = {
+                glm::mix(a.position, b.position, t),
+                glm::mix(a.color, b.color, t),
+                glm::mix(a.texCoord, b.texCoord, t)
+            };
+        }
+    }
+
+    for (int i = 1; i + 1 < numVertices; ++i)
+    {
+        ClipVertex triangle[3] = { polygon[0], polygon[i], polygon[i + 1] };
+        AddPrimitive(PrimitiveType::Triangles, state, triangle);
+    }
+}
+
+void SoftwareRenderBackend::AddPrimitive(PrimitiveType type, const RenderState& state, const ClipVertex* vertices)
+{
+    int numVertices = type == PrimitiveType::Triangles ? 3 : (type == PrimitiveType::Lines ? 2 : 1);
+
+    Primitive primitive;
+    primitive.type = type;
+    primitive.texture = state.texture;
+    primitive.size = state.size;
+
+    glm::vec2 min = glm::vec2(std::numeric_limits<float>::max());
+    glm::vec2 max = glm::vec2(std::numeric_limits<float>::lowest());
+
+    for (int i = 0; i < numVertices; ++i)
+    {
+        const ClipVertex& vertex = vertices[i];
+        float invW = 1.0f / vertex.position.w;
+        glm::vec3 ndc = glm::vec3(vertex.position) * invW;
+
+        primitive.position[i] = glm::vec2((ndc.x * 0.5f + 0.5f) * width, (0.5f - ndc.y * 0.5f) * height);
+        primitive.depth[i] = ndc.z * 0.5f + 0.5f;
+        primitive.invW[i] = invW;
+        primitive.color[i] = vertex.color * invW;
+        primitive.texCoord[i] = vertex.texCoord * invW;
+
+        min = glm::min(min, primitive.position[i]);
+        max = glm::max(max, primitive.position[i]);
+    }
+
+    if (type == PrimitiveType::Triangles)
+    {
+        float area = Edge(primitive.position[0], primitive.position[1], primitive.position[2]);
+
+        // Counter-clockwise triangles face the viewer, which is clockwise once y points down.
+        if (area >= 0.0f)
+        {
+            return;
+        }
+
+        // Rasterization expects a positive area.
+        std::swap(primitive.position[1], primitive.position[2]);
+        std::swap(primitive.depth[1], primitive.depth[2]);
+        std::swap(primitive.invW[1], primitive.invW[2]);
+        std::swap(primitive.color[1], primitive.color[2]);
+        std::swap(primitive.texCoord[1], primitive.texCoord[2]);
+    }
+    else
+    {
+        min -= glm::vec2(primitive.size * 0.5f);
+        max += glm::vec2(primitive.size * 0.5f);
+    }
+
+    min = glm::max(glm::floor(min), glm::vec2(0.0f));
+    max = glm::min(glm::ceil(max), glm::vec2((float)width - 1.0f, (float)height - 1.0f));
+
+    // Restricting the pixel bounds to the scissor keeps the primitive out of other tiles and pixels altogether.
+    if (!state.scissor.IsEmpty())
+    {
+        min = glm::max(min, glm::vec2(state.scissor.min));
+        max = glm::min(max, glm::vec2(state.scissor.max - 1));
+    }
+
+    if (min.x > max.x || min.y > max.y)
+    {
+        return;
+    }
+
+    primitive.min = glm::ivec2(min);
+    primitive.max = glm::ivec2(max);
+
+    uint32_t index = (uint32_t)primitives.size();
+    primitives.push_back(primitive);
+
+    for (int y = primitive.min.y / kTileSize; y <= primitive.max.y / kTileSize; ++y)
+    {
+        for (int x = primitive.min.x / kTileSize; x <= primitive.max.x / kTileSize; ++x)
+        {
+            bins[y * numTilesX + x].push_back(index);
+        }
+    }
+}
+
+void SoftwareRenderBackend::RasterizeTile(int tileIndex)
+{
+    glm::ivec2 tileMin = glm::ivec2(tileIndex % numTilesX, tileIndex / numTilesX) * kTileSize;
+    glm::ivec2 tileMax = glm::min(tileMin + kTileSize - 1, glm::ivec2(width - 1, height - 1));
+
+    int numFragments = 0;
+
+    for (uint32_t index : bins[tileIndex])
+    {
+        const Primitive& primitive = primitives[index];
+
+        if (primitive.type == PrimitiveType::Triangles)
+        {
+            numFragments += RasterizeTriangle(primitive, tileMin, tileMax);
+        }
+        else if (primitive.type == PrimitiveType::Lines)
+        {
+            numFragments += RasterizeLine(primitive, tileMin, tileMax);
+        }
+        else
+        {
+            numFragments += RasterizePoint(primitive, tileMin, tileMax);
+        }
+    }
+
+    tileFragments[tileIndex] = numFragments;
+}
+
+int SoftwareRenderBackend::RasterizeTriangle(const Primitive& primitive, const glm::ivec2& tileMin, const glm::ivec2& tileMax)
+{
+    const glm::vec2* p = primitive.position;
+    glm::ivec2 min = glm::max(primitive.min, tileMin);
+    glm::ivec2 max = glm::min(primitive.max, tileMax);
+
+    float invArea = 1.0f / Edge(p[0], p[1], p[2]);
+
+    // Pixels exactly on an edge only belong to the triangle if the edge is a top or left edge.
+    float bias0 = IsTopLeft(p[1], p[2]) ? 0.0f : -1e-7f;
+    float bias1 = IsTopLeft(p[2], p[0]) ? 0.0f : -1e-7f;
+    float bias2 = IsTopLeft(p[0], p[1]) ? 0.0f : -1e-7f;
+
+    // Edge function steps per pixel in x.
+    float step0 = p[1].y - p[2].y;
+    float step1 = p[2].y - p[0].y;
+    float step2 = p[0].y - p[1].y;
+
+    int numFragments = 0;
+
+    for (int y = min.y; y <= max.y; ++y)
+    {
+        glm::vec2 start = glm::vec2(min.x + 0.5f, y + 0.5f);
+        float w0 = Edge(p[1], p[2], start) + bias0;
+        float w1 = Edge(p[2], p[0], start) + bias1;
+        float w2 = Edge(p[0], p[1], start) + bias2;
+
+        for (int x = min.x; x <= max.x; ++x, w0 += step0, w1 += step1, w2 += step2)
+        {
+            if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f)
+            {
+                glm::vec3 weights = glm::vec3(w0, w1, w2) * invArea;
+                float depth = weights.x * primitive.depth[0] + weights.y * primitive.depth[1] + weights.z * primitive.depth[2];
+                ShadePixel(primitive, x, y, depth, weights);
+                numFragments++;
+            }
+        }
+    }
+
+    return numFragments;
+}
+
+int SoftwareRenderBackend::RasterizeLine(const Primitive& primitive, const glm::ivec2& tileMin, const glm::ivec2& tileMax)
+{
+    glm::vec2 delta = primitive.position[1] - primitive.position[0];
+    int numSteps = std::max(1, (int)std::ceil(std::max(std::abs(delta.x), std::abs(delta.y))));
+    int numFragments = 0;
+
+    for (int i = 0; i <= numSteps; ++i)
+    {
+        float t = (float)i / (float)numSteps;
+        glm::ivec2 pixel = glm::ivec2(glm::floor(primitive.position[0] + delta * t));
+
+        if (pixel.x >= tileMin.x && pixel.y >= tileMin.y && pixel.x <= tileMax.x && pixel.y <= tileMax.y)
+        {
+            float depth = primitive.depth[0] + (primitive.depth[1] - primitive.depth[0]) * t;
+            ShadePixel(primitive, pixel.x, pixel.y, depth, glm::vec3(1.0f - t, t, 0.0f));
+            numFragments++;
+        }
+    }
+
+    return numFragments;
+}
+
+int SoftwareRenderBackend::RasterizePoint(const Primitive& primitive, const glm::ivec2& tileMin, const glm::ivec2& tileMax)
+{
+    glm::ivec2 min = glm::max(primitive.min, tileMin);
+    glm::ivec2 max = glm::min(primitive.max, tileMax);
+
+    for (int y = min.y; y <= max.y; ++y)
+    {
+        for (int x = min.x; x <= max.x; ++x)
+        {
+            ShadePixel(primitive, x, y, primitive.depth[0], glm::vec3(1.0f, 0.0f, 0.0f));
+        }
+    }
+
+    return std::max(0, max.x - min.x + 1) * std::max(0, max.y - min.y + 1);
+}
+
+void SoftwareRenderBackend::ShadePixel(const Primitive& primitive, int x, int y, float depth, const glm::vec3& weights)
+{
+    int pixel = y * width + x;
+
+    if (depth < 0.0f || depth > 1.0f || depth >= depthBuffer[pixel])
+    {
+        return;
+    }
+
+    float w = 1.0f / (weights.x * primitive.invW[0] + weights.y * primitive.invW[1] + weights.z * primitive.invW[2]);
+    glm::vec3 color = (primitive.color[0] * weights.x + primitive.color[1] * weights.y + primitive.color[2] * weights.z) * w;
+
+    if (primitive.texture != 0)
+    {
+        const Texture& texture = textures[primitive.texture - 1];
+        glm::vec2 texCoord = (primitive.texCoord[0] * weights.x + primitive.texCoord[1] * weights.y + primitive.texCoord[2] * weights.z) * w;
+
+        int u = glm::clamp((int)(texCoord.x * texture.width), 0, texture.width - 1);
+        int v = glm::clamp((int)(texCoord.y * texture.height), 0, texture.height - 1);
+        color *= UnpackColor(texture.pixels[v * texture.width + u]);
+    }
+
+    depthBuffer[pixel] = depth;
+    colorBuffer[pixel] = PackColor(color);
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "RenderBackend.h"
+#include "Jobs/JobSystem.h"
+#include "Memory/FrameArena.h"
+
+// Rasterizes batches on the CPU into a color and depth buffer. Primitives are binned into
+// screen tiles while batches are submitted, and the tiles are rasterized in parallel when the
+// frame ends.
+class SoftwareRenderBackend : public RenderBackend
+{
+public:
+    // The width and height of a screen tile in pixels.
+    static constexpr int kTileSize = 32;
+
+    // The number of tiles rasterized by each job. Tiles differ a lot in cost, so jobs stay small enough for idle
+    // workers to steal the remaining ones.
+    static constexpr int kTilesPerJob = 4;
+
+    // Creates a new backend rendering into a target of the given size. The tiles are rasterized in parallel
+    // over the given jobs if there are any.
+    SoftwareRenderBackend(int width, int height, JobSystem* jobs = nullptr);
+
+    uint32_t CreateTexture(const uint32_t* pixels, int width, int height) override;
+    void BeginFrame(const RenderView& view) override;
+    void DrawBatch(const RenderBatch& batch) override;
+    void EndFrame() override;
+
+    // Returns the RGBA pixels of the last frame, top row first.
+    const uint32_t* GetPixels() const;
+
+    // Returns the width of the target.
+    int GetWidth() const;
+
+    // Returns the height of the target.
+    int GetHeight() const;
+
+    // Returns the number of primitives binned during the last frame.
+    int GetNumPrimitives() const;
+
+    // Returns the number of pixels rasterized during the last frame, including those that failed the depth test.
+    // Divided by the size of the target this gives the average overdraw.
+    int GetNumFragments() const;
+
+    // Writes the last frame to the given PNG file. Returns false if the file could not be written.
+    bool WriteImage(const char* path) const;
+
+private:
+    struct Texture
+    {
+        int width;
+        int height;
+        std::vector<uint32_t> pixels;
+    };
+
+    struct Primitive
+    {
+        PrimitiveType type;
+        uint32_t texture;
+        float size;
+
+        // Screen space position, depth and 1/w of each vertex.
+        glm::vec2 position[3];
+        float depth[3];
+        float invW[3];
+
+        // Attributes divided by w for perspective correct interpolation.
+        glm::vec3 color[3];
+        glm::vec2 texCoord[3];
+
+        // The inclusive pixel bounds of the primitive.
+        glm::ivec2 min;
+        glm::ivec2 max;
+    };
+
+    struct ClipVertex
+    {
+        glm::vec4 position;
+        glm::vec3 color;
+        glm::vec2 texCoord;
+    };
+
+    // Sets up the given clip space primitive and adds it to the bins of the tiles it overlaps.
+    void AddPrimitive(PrimitiveType type, const RenderState& state, const ClipVertex* vertices);
+
+    // Clips the triangle against the near plane and adds the remaining triangles.
+    void AddTriangle(const RenderState& state, const ClipVertex vertices[3]);
+
+    // Rasterizes all primitives binned into the given tile. The primitive rasterizers return the number of
+    // pixels they rasterized.
+    void RasterizeTile(int tileIndex);
+    int RasterizeTriangle(const Primitive& primitive, const glm::ivec2& tileMin, const glm::ivec2& tileMax);
+    int RasterizeLine(const Primitive& primitive, const glm::ivec2& tileMin, const glm::ivec2& tileMax);
+    int RasterizePoint(const Primitive& primitive, const glm::ivec2& tileMin, const glm::ivec2& tileMax);
+
+    // Depth tests the pixel and writes the shaded color if it passes.
+    void ShadePixel(const Primitive& primitive, int x, int y, float depth, const glm::vec3& weights);
+
+    int width;
+    int height;
+    int numTilesX;
+    int numTilesY;
+    JobSystem* jobs;
+
+    glm::mat4 viewProjection;
+
+    std::vector<uint32_t> colorBuffer;
+    std::vector<float> depthBuffer;
+    std::vector<Texture> textures;
+
+    // The primitives and the bins only live for one frame, so they are taken from an arena that is reset when the
+    // next frame begins. Both are reserved at the sizes of the last frame, which keeps them from leaving behind
+    // storage in the arena as they grow.
+    FrameArena frameArena;
+    FrameVector<Primitive> primitives;
+    std::vector<FrameVector<uint32_t>> bins;
+
+    // The number of pixels rasterized in each tile during the last frame.
+    std::vector<int> tileFragments;
+    std::vector<ClipVertex> clipVertices;
+};
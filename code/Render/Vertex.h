@@ -0,0 +1,14 @@
+#pragma once
+#include <glm/glm.hpp>
+
+struct Vertex
+{
+    // The position of the vertex.
+    glm::vec3 position;
+
+    // The texture coordinate of the vertex.
+    glm::vec2 texCoord;
+
+    // The color of the vertex.
+    glm::vec3 color;
+};
@@ -0,0 +1,180 @@
+#include "FrameLimiter.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+    // The limiter sleeps in slices this long, which most schedulers can keep close to.
+    constexpr std::chrono::microseconds kSleepSlice(1000);
+
+    // The number of sleeps measured before the estimate of their length is trusted over the requested length.
+    constexpr int kMinSleepSamples = 4;
+
+#if defined(_WIN32)
+    // The timer resolution requested while limiting, in milliseconds.
+    constexpr UINT kTimerPeriod = 1;
+#endif
+
+    double ToSeconds(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<double>(duration).count();
+    }
+}
+
+FrameLimiter::FrameLimiter(double framesPerSecond)
+    : frameTime(framesPerSecond > 0.0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond)) : Clock::duration::zero())
+    , nextFrame(Clock::now())
+    , lastFrame(Clock::now())
+    , numSleeps(0)
+    , sleepMean(0.0)
+    , sleepSquares(0.0)
+    , numFrames(0)
+    , frameTimeSum(0.0)
+    , frameTimeSquares(0.0)
+    , maxFrameTime(0.0)
+    , sleptTime(0.0)
+    , statsStart(Clock::now())
+    , statsStartCpuTime(GetProcessCpuTime())
+{
+#if defined(_WIN32)
+    if (frameTime > Clock::duration::zero())
+    {
+        timeBeginPeriod(kTimerPeriod);
+    }
+#endif
+}
+
+FrameLimiter::~FrameLimiter()
+{
+#if defined(_WIN32)
+    if (frameTime > Clock::duration::zero())
+    {
+        timeEndPeriod(kTimerPeriod);
+    }
+#endif
+}
+
+void FrameLimiter::Wait(const std::function<void()>& onSleep)
+{
+    if (frameTime > Clock::duration::zero())
+    {
+        nextFrame += frameTime;
+
+        Clock::time_point now = Clock::now();
+        if (nextFrame < now)
+        {
+            nextFrame = now;
+        }
+
+        // Sleeps run over by about their deviation, so one more sleep is only taken while the time left covers the
+        // mean sleep plus its deviation.
+        for (;;)
+        {
+            double sleepEstimate = ToSeconds(kSleepSlice);
+            if (numSleeps >= kMinSleepSamples)
+            {
+                sleepEstimate = sleepMean + std::sqrt(sleepSquares / (numSleeps - 1));
+            }
+
+            if (ToSeconds(nextFrame - Clock::now()) <= sleepEstimate)
+            {
+                break;
+            }
+
+            Sleep();
+            if (onSleep)
+            {
+                onSleep();
+            }
+        }
+
+        while (Clock::now() < nextFrame)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    Clock::time_point frameStart = Clock::now();
+    double frameMilliseconds = ToSeconds(frameStart - lastFrame) * 1000.0;
+    lastFrame = frameStart;
+
+    numFrames++;
+    frameTimeSum += frameMilliseconds;
+    frameTimeSquares += frameMilliseconds * frameMilliseconds;
+    maxFrameTime = std::max(maxFrameTime, frameMilliseconds);
+}
+
+FramePacingStats FrameLimiter::TakeStats()
+{
+    Clock::time_point now = Clock::now();
+    double cpuTime = GetProcessCpuTime();
+    double elapsed = std::max(ToSeconds(now - statsStart), 1e-9);
+
+    FramePacingStats stats = {};
+    stats.numFrames = numFrames;
+    if (numFrames > 0)
+    {
+        stats.meanFrameTime = frameTimeSum / numFrames;
+        stats.jitter = std::sqrt(std::max(frameTimeSquares / numFrames - stats.meanFrameTime * stats.meanFrameTime, 0.0));
+        stats.maxFrameTime = maxFrameTime;
+    }
+    stats.cpuUsage = (cpuTime - statsStartCpuTime) / elapsed;
+    stats.sleepShare = sleptTime / elapsed;
+
+    numFrames = 0;
+    frameTimeSum = 0.0;
+    frameTimeSquares = 0.0;
+    maxFrameTime = 0.0;
+    sleptTime = 0.0;
+    statsStart = now;
+    statsStartCpuTime = cpuTime;
+
+    return stats;
+}
+
+double FrameLimiter::GetProcessCpuTime()
+{
+#if defined(_WIN32)
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+    {
+        return 0.0;
+    }
+
+    // File times count 100 nanosecond intervals.
+    ULARGE_INTEGER kernel = { { kernelTime.dwLowDateTime, kernelTime.dwHighDateTime } };
+    ULARGE_INTEGER user = { { userTime.dwLowDateTime, userTime.dwHighDateTime } };
+    return (double)(kernel.QuadPart + user.QuadPart) * 1e-7;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0.0;
+    }
+
+    return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
+void FrameLimiter::Sleep()
+{
+    Clock::time_point start = Clock::now();
+    std::this_thread::sleep_for(kSleepSlice);
+    double slept = ToSeconds(Clock::now() - start);
+    sleptTime += slept;
+
+    numSleeps++;
+    double delta = slept - sleepMean;
+    sleepMean += delta / numSleeps;
+    sleepSquares += delta * (slept - sleepMean);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <chrono>
+#include <functional>
+
+// The pacing of the frames since the statistics were last taken.
+struct FramePacingStats
+{
+    // The number of frames measured.
+    int numFrames;
+
+    // The mean and the standard deviation of the time between frames, in milliseconds. The deviation is the jitter.
+    double meanFrameTime;
+    double jitter;
+
+    // The longest time between two frames, in milliseconds.
+    double maxFrameTime;
+
+    // The processor time of all threads as a share of the time passed, where 1 is one core kept busy.
+    double cpuUsage;
+
+    // The share of the time passed the limiter slept.
+    double sleepShare;
+};
+
+// Keeps frames from starting more often than the target frame rate. Sleeping is cheap but wakes up late by up to
+// the scheduler's granularity, and spinning is exact but keeps a core busy, so the limiter sleeps in short slices
+// while the time left is longer than a sleep has been seen to take, and spins for the rest. On Windows a limiter
+// raises the system timer resolution to 1 ms while it exists, since sleeps otherwise last a whole 15.6 ms tick.
+class FrameLimiter
+{
+public:
+    // Creates a new limiter for the given number of frames per second, or one that never waits if it is 0.
+    explicit FrameLimiter(double framesPerSecond = 0.0);
+
+    // Restores the system timer resolution.
+    ~FrameLimiter();
+
+    FrameLimiter(const FrameLimiter&) = delete;
+    FrameLimiter& operator=(const FrameLimiter&) = delete;
+
+    // Waits until the next frame is due and counts the frame. A frame that starts late moves the following ones
+    // back instead of letting them catch up. The given function is called after every slice slept, so the caller
+    // can handle events while it waits instead of after.
+    void Wait(const std::function<void()>& onSleep = nullptr);
+
+    // Returns the pacing of the frames since the last call and starts measuring again.
+    FramePacingStats TakeStats();
+
+    // Returns the processor time all threads of the process used so far, in seconds.
+    static double GetProcessCpuTime();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // Sleeps for one slice and updates the estimate of how long a slice really takes.
+    void Sleep();
+
+    Clock::duration frameTime;
+    Clock::time_point nextFrame;
+    Clock::time_point lastFrame;
+
+    // The mean and deviation of the sleeps measured, in seconds, kept with Welford's method.
+    int numSleeps;
+    double sleepMean;
+    double sleepSquares;
+
+    // The sums the statistics are computed from.
+    int numFrames;
+    double frameTimeSum;
+    double frameTimeSquares;
+    double maxFrameTime;
+    double sleptTime;
+    Clock::time_point statsStart;
+    double statsStartCpuTime;
+};
@@ -0,0 +1,98 @@
+#include "LineOfSightService.h"
+#include <algorithm>
+
+#include "Debug/Profiler.h"
+#include "SectorTrace.h"
+
+namespace
+{
+    // The most queries a job traces.
+    constexpr int kQueriesPerJob = 64;
+}
+
+LineOfSightService::LineOfSightService(JobSystem* jobs)
+    : numCacheHits(0)
+    , numTraced(0)
+    , jobs(jobs)
+    , runIndex(0)
+{
+}
+
+void LineOfSightService::Run(const Map& map, const LineOfSightQuery* queries, int count, std::vector<uint32_t>& visibleBits)
+{
+    PROFILE_ZONE("Line of sight");
+
+    runIndex++;
+    visibleBits.assign((count + 31) / 32, 0);
+    pending.clear();
+    numCacheHits = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const LineOfSightQuery& query = queries[i];
+        auto it = cache.find(query.pairKey);
+        if (it != cache.end() && it->second.fromSector == query.fromSector && it->second.toSector == query.toSector)
+        {
+            it->second.lastRun = runIndex;
+            visibleBits[i / 32] |= uint32_t(it->second.visible) << (i % 32);
+            numCacheHits++;
+        }
+        else
+        {
+            pending.push_back(i);
+        }
+    }
+
+    // Queries from the same sector touch the same walls, so tracing them together keeps those walls in cache.
+    std::sort(pending.begin(), pending.end(), [&](int a, int b)
+    {
+        return queries[a].fromSector < queries[b].fromSector;
+    });
+
+    int numPending = (int)pending.size();
+    pendingVisible.resize(numPending);
+
+    auto TraceQueries = [&](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+        {
+            const LineOfSightQuery& query = queries[pending[i]];
+            pendingVisible[i] = query.fromSector != -1 && LineOfSight(map, query.fromSector, Line(query.from, query.to));
+        }
+    };
+
+    if (jobs)
+    {
+        jobs->ParallelFor(numPending, kQueriesPerJob, TraceQueries);
+    }
+    else
+    {
+        TraceQueries(0, numPending);
+    }
+
+    for (int i = 0; i < numPending; ++i)
+    {
+        const LineOfSightQuery& query = queries[pending[i]];
+        visibleBits[pending[i] / 32] |= uint32_t(pendingVisible[i]) << (pending[i] % 32);
+        cache[query.pairKey] = { query.fromSector, query.toSector, runIndex, pendingVisible[i] != 0 };
+    }
+    numTraced = numPending;
+
+    // Pairs that were not queried this run are dropped once they outnumber the live ones.
+    if (cache.size() > 2 * (size_t)count)
+    {
+        std::erase_if(cache, [&](const auto& entry)
+        {
+            return entry.second.lastRun != runIndex;
+        });
+    }
+}
+
+void LineOfSightService::ClearCache()
+{
+    cache.clear();
+}
+
+bool LineOfSightService::IsVisible(const std::vector<uint32_t>& visibleBits, int index)
+{
+    return (visibleBits[index / 32] >> (index % 32)) & 1;
+}
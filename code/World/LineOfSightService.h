@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Map.h"
+#include "Jobs/JobSystem.h"
+
+struct LineOfSightQuery
+{
+    // The start of the line.
+    glm::vec3 from;
+
+    // The end of the line.
+    glm::vec3 to;
+
+    // The sector containing the start, or -1 if it is outside the map.
+    int fromSector;
+
+    // The sector containing the end.
+    int toSector;
+
+    // A caller chosen key identifying the pair across ticks, such as two agent IDs packed together.
+    uint64_t pairKey;
+};
+
+struct LineOfSightService
+{
+    // The number of queries answered from the cache in the last run.
+    int numCacheHits;
+
+    // The number of queries traced in the last run.
+    int numTraced;
+
+    // Creates a new service tracing on the given jobs, or on the calling thread if there are none.
+    LineOfSightService(JobSystem* jobs = nullptr);
+
+    // Answers every query and sets bit i of visibleBits when query i has line of sight. Queries whose pair has a
+    // cached result and whose endpoints are still in the same sectors are not traced again; the rest are sorted by
+    // start sector and traced in parallel.
+    void Run(const Map& map, const LineOfSightQuery* queries, int count, std::vector<uint32_t>& visibleBits);
+
+    // Forgets all cached results, for example after the map changed.
+    void ClearCache();
+
+    // Returns true if bit index is set in the given result bits.
+    static bool IsVisible(const std::vector<uint32_t>& visibleBits, int index);
+
+private:
+    struct CacheEntry
+    {
+        int fromSector;
+        int toSector;
+        int lastRun;
+        bool visible;
+    };
+
+    JobSystem* jobs;
+    int runIndex;
+
+    std::unordered_map<uint64_t, CacheEntry> cache;
+
+    // Indices of the queries to trace this run, and their results.
+    std::vector<int> pending;
+    std::vector<uint8_t> pendingVisible;
+};
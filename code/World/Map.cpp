@@ -0,0 +1,194 @@
+#include "Map.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace
+{
+    // Reads a number at the cursor and moves the cursor past it. Returns false if there is no number.
+    bool ParseFloat(const char*& cursor, float& value)
+    {
+        char* end;
+        value = strtof(cursor, &end);
+        bool parsed = end != cursor;
+        cursor = end;
+        return parsed;
+    }
+
+    bool ParseInt(const char*& cursor, int& value)
+    {
+        char* end;
+        value = (int)strtol(cursor, &end, 10);
+        bool parsed = end != cursor;
+        cursor = end;
+        return parsed;
+    }
+}
+
+glm::vec3 Map::GetVertexPosition(int vertexIndex, float height) const
+{
+    const glm::vec2& v = wallVertices[vertexIndex];
+    return glm::vec3(v.x, height, -v.y);
+}
+
+void Map::GetWallPositions(const Wall& wall, float height, glm::vec3 positions[2]) const
+{
+    positions[0] = GetVertexPosition(wall.v[0], height);
+    positions[1] = GetVertexPosition(wall.v[1], height);
+}
+
+glm::vec3 Map::GetWallNormal(const Wall& wall) const
+{
+    glm::vec3 v[2];
+    GetWallPositions(wall, 0.0f, v);
+    return glm::normalize(glm::cross(v[1] - v[0], glm::vec3(0.0f, 1.0f, 0.0f)));
+}
+
+void Map::ComputeSectorBounds()
+{
+    std::vector<SectorBounds> bounds(sectors.size());
+
+    for (size_t i = 0; i < sectors.size(); ++i)
+    {
+        const Sector& sector = sectors[i];
+        bounds[i].min = glm::vec2(std::numeric_limits<float>::max());
+        bounds[i].max = glm::vec2(std::numeric_limits<float>::lowest());
+
+        for (int j = 0; j < sector.numWalls; ++j)
+        {
+            const glm::vec2& v = wallVertices[walls[sector.firstWall + j].v[0]];
+            bounds[i].min = glm::min(bounds[i].min, v);
+            bounds[i].max = glm::max(bounds[i].max, v);
+        }
+    }
+
+    sectorBounds = std::move(bounds);
+}
+
+bool Map::LoadText(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    std::vector<char> text;
+    char buffer[4096];
+    size_t numRead;
+    while ((numRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        text.insert(text.end(), buffer, buffer + numRead);
+    }
+    fclose(file);
+    text.push_back('\0');
+
+    std::vector<glm::vec2> newVertices;
+    std::vector<Sector> newSectors;
+    std::vector<Wall> newWalls;
+
+    const char* cursor = text.data();
+    while (*cursor)
+    {
+        const char* lineEnd = strchr(cursor, '\n');
+        if (!lineEnd)
+        {
+            lineEnd = cursor + strlen(cursor);
+        }
+
+        while (*cursor == ' ' || *cursor == '\t')
+        {
+            cursor++;
+        }
+
+        bool parsed = true;
+
+        if (strncmp(cursor, "vertex ", 7) == 0)
+        {
+            cursor += 7;
+            glm::vec2 v;
+            parsed = ParseFloat(cursor, v.x) && ParseFloat(cursor, v.y);
+            newVertices.push_back(v);
+        }
+        else if (strncmp(cursor, "sector ", 7) == 0)
+        {
+            cursor += 7;
+            Sector sector;
+            sector.firstWall = (int)newWalls.size();
+            sector.numWalls = 0;
+            parsed = ParseFloat(cursor, sector.floorHeight) && ParseFloat(cursor, sector.ceilingHeight);
+            newSectors.push_back(sector);
+        }
+        else if (strncmp(cursor, "wall ", 5) == 0 && !newSectors.empty())
+        {
+            cursor += 5;
+            Wall wall;
+            parsed = ParseInt(cursor, wall.v[0]) && ParseInt(cursor, wall.v[1]) && ParseInt(cursor, wall.sector);
+            newWalls.push_back(wall);
+            newSectors.back().numWalls++;
+        }
+        else if (*cursor == '#')
+        {
+            cursor = lineEnd;
+        }
+
+        // Anything but whitespace after the values means the line was malformed.
+        while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r'))
+        {
+            cursor++;
+        }
+        if (!parsed || cursor != lineEnd)
+        {
+            return false;
+        }
+
+        cursor = *lineEnd ? lineEnd + 1 : lineEnd;
+    }
+
+    for (const Wall& wall : newWalls)
+    {
+        if (wall.v[0] < 0 || wall.v[1] < 0 || wall.v[0] >= (int)newVertices.size() || wall.v[1] >= (int)newVertices.size()
+            || wall.sector < -1 || wall.sector >= (int)newSectors.size())
+        {
+            return false;
+        }
+    }
+
+    wallVertices = std::move(newVertices);
+    sectors = std::move(newSectors);
+    walls = std::move(newWalls);
+    ComputeSectorBounds();
+    return true;
+}
+
+bool Map::SaveText(const char* path) const
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    // Nine significant digits round trip every float exactly.
+    bool written = fprintf(file, "# Tremble map\n") > 0;
+
+    for (const glm::vec2& v : wallVertices)
+    {
+        written = written && fprintf(file, "vertex %.9g %.9g\n", v.x, v.y) > 0;
+    }
+
+    for (const Sector& sector : sectors)
+    {
+        written = written && fprintf(file, "sector %.9g %.9g\n", sector.floorHeight, sector.ceilingHeight) > 0;
+
+        for (int i = 0; i < sector.numWalls; ++i)
+        {
+            const Wall& wall = walls[sector.firstWall + i];
+            written = written && fprintf(file, "wall %d %d %d\n", wall.v[0], wall.v[1], wall.sector) > 0;
+        }
+    }
+
+    return fclose(file) == 0 && written;
+}
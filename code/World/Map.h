@@ -0,0 +1,77 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include "MapArray.h"
+
+struct Sector
+{
+    // The index of the first wall of the sector.
+    int firstWall;
+
+    // The number of walls of the sector.
+    int numWalls;
+
+    // The height of the floor.
+    float floorHeight;
+
+    // The height of the ceiling.
+    float ceilingHeight;
+};
+
+struct Wall
+{
+    // The indices of the start and end vertex of the wall.
+    int v[2];
+
+    // The index of the sector on the other side of the wall or -1 if the wall is solid.
+    int sector;
+};
+
+struct SectorBounds
+{
+    // The minimum corner of the sector in map space.
+    glm::vec2 min;
+
+    // The maximum corner of the sector in map space.
+    glm::vec2 max;
+};
+
+// The elements of a map are either owned by the map or viewed in place in a mapped map file.
+struct Map
+{
+    // The 2D vertices referenced by the walls.
+    MapArray<glm::vec2> wallVertices;
+
+    // The sectors of the map.
+    MapArray<Sector> sectors;
+
+    // The walls of all sectors, stored contiguously per sector.
+    MapArray<Wall> walls;
+
+    // The map space bounds of each sector, or empty until they are computed or loaded with the map.
+    MapArray<SectorBounds> sectorBounds;
+
+    // Computes the bounds of all sectors from their walls.
+    void ComputeSectorBounds();
+
+    // Loads the map from the given text file, replacing the current one. Each line holds one element:
+    //   vertex <x> <y>
+    //   sector <floor height> <ceiling height>
+    //   wall <start vertex> <end vertex> <sector behind or -1>
+    // Walls belong to the sector declared last, and lines starting with # are ignored. Returns false if the file
+    // could not be read or an element is malformed or refers to a missing element.
+    bool LoadText(const char* path);
+
+    // Saves the map to the given text file in the format read by LoadText. Returns false if the file could not
+    // be written.
+    bool SaveText(const char* path) const;
+
+    // Returns the world space position of the given wall vertex at the given height.
+    glm::vec3 GetVertexPosition(int vertexIndex, float height) const;
+
+    // Returns the world space start and end of the given wall at the given height.
+    void GetWallPositions(const Wall& wall, float height, glm::vec3 positions[2]) const;
+
+    // Returns the outward facing normal of the given wall.
+    glm::vec3 GetWallNormal(const Wall& wall) const;
+};
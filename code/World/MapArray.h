@@ -0,0 +1,129 @@
+#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+// A read-only array of map elements that either owns its elements or views memory owned by someone else, such as
+// a mapped map file. Views are never copied, so a map loaded from a file is used in place. The interface follows
+// the standard containers, so the arrays can be indexed, sized and iterated like the vectors they replace.
+template <typename T>
+struct MapArray
+{
+    // Creates a new empty array.
+    MapArray()
+        : elements(nullptr)
+        , count(0)
+    {
+    }
+
+    // Creates a new array owning the given elements.
+    MapArray(std::initializer_list<T> values)
+        : storage(values)
+    {
+        Reset();
+    }
+
+    // Creates a new array owning the given elements.
+    MapArray(std::vector<T>&& values)
+        : storage(std::move(values))
+    {
+        Reset();
+    }
+
+    // Copies the elements of owning arrays and the pointer of views.
+    MapArray(const MapArray& other)
+        : storage(other.storage)
+    {
+        if (other.IsView())
+        {
+            elements = other.elements;
+            count = other.count;
+        }
+        else
+        {
+            Reset();
+        }
+    }
+
+    MapArray(MapArray&& other) noexcept
+        : storage(std::move(other.storage))
+    {
+        if (other.IsView())
+        {
+            elements = other.elements;
+            count = other.count;
+        }
+        else
+        {
+            Reset();
+        }
+        other.storage.clear();
+        other.Reset();
+    }
+
+    MapArray& operator=(MapArray other)
+    {
+        storage.swap(other.storage);
+        if (other.IsView())
+        {
+            elements = other.elements;
+            count = other.count;
+        }
+        else
+        {
+            Reset();
+        }
+        return *this;
+    }
+
+    // Replaces the elements with the given owned elements.
+    MapArray& operator=(std::initializer_list<T> values)
+    {
+        storage.assign(values);
+        Reset();
+        return *this;
+    }
+
+    // Replaces the elements with the given owned elements.
+    MapArray& operator=(std::vector<T>&& values)
+    {
+        storage = std::move(values);
+        Reset();
+        return *this;
+    }
+
+    // Replaces the elements with a view of the given memory, which must outlive the array.
+    void SetView(const T* values, size_t numValues)
+    {
+        storage.clear();
+        storage.shrink_to_fit();
+        elements = values;
+        count = numValues;
+    }
+
+    // Returns true if the array views memory it does not own.
+    bool IsView() const
+    {
+        return count > 0 && elements != storage.data();
+    }
+
+    const T& operator[](size_t index) const { return elements[index]; }
+    const T* data() const { return elements; }
+    const T* begin() const { return elements; }
+    const T* end() const { return elements + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+private:
+    // Points the array at its own storage.
+    void Reset()
+    {
+        elements = storage.data();
+        count = storage.size();
+    }
+
+    std::vector<T> storage;
+    const T* elements;
+    size_t count;
+};
@@ -0,0 +1,305 @@
+#include "MapFile.h"
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // The elements are stored exactly as they are laid out in memory.
+    static_assert(std::is_trivially_copyable_v<glm::vec2> && sizeof(glm::vec2) == 8, "unexpected vertex layout");
+    static_assert(std::is_trivially_copyable_v<Wall> && sizeof(Wall) == 12, "unexpected wall layout");
+    static_assert(std::is_trivially_copyable_v<Sector> && sizeof(Sector) == 16, "unexpected sector layout");
+    static_assert(std::is_trivially_copyable_v<SectorBounds> && sizeof(SectorBounds) == 16, "unexpected sector bounds layout");
+    static_assert(sizeof(MapFileHeader) % 8 == 0, "the checksum starts on a word boundary");
+
+    constexpr uint64_t kChecksumBasis = 0xCBF29CE484222325ull;
+    constexpr uint64_t kChecksumPrime = 0x00000100000001B3ull;
+
+    size_t Align(size_t offset)
+    {
+        return (offset + kMapFileAlignment - 1) & ~(kMapFileAlignment - 1);
+    }
+
+    // Returns true if the section holds elements of the given size and lies within the file.
+    bool IsSectionValid(const MapFileSectionInfo& section, size_t elementSize, size_t fileSize)
+    {
+        return section.elementSize == elementSize
+            && section.offset % kMapFileAlignment == 0
+            && section.offset <= fileSize
+            && section.count <= (fileSize - section.offset) / elementSize;
+    }
+
+    template <typename T>
+    void SetSectionView(MapArray<T>& array, const uint8_t* data, const MapFileSectionInfo& section)
+    {
+        array.SetView(reinterpret_cast<const T*>(data + section.offset), (size_t)section.count);
+    }
+}
+
+MapFile::MapFile()
+    : data(nullptr)
+    , size(0)
+    , fileHandle(nullptr)
+    , mappingHandle(nullptr)
+{
+}
+
+MapFile::~MapFile()
+{
+    Close();
+}
+
+bool MapFile::Open(const char* path, bool verify)
+{
+    Close();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(MapFileHeader))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    size = (size_t)fileSize.QuadPart;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || status.st_size < (off_t)sizeof(MapFileHeader))
+    {
+        close(file);
+        return false;
+    }
+
+    void* view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+    // The mapping keeps the file alive on its own.
+    close(file);
+
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+
+    size = (size_t)status.st_size;
+#endif
+
+    data = static_cast<const uint8_t*>(view);
+
+    const MapFileHeader& header = GetHeader();
+    bool valid = header.magic == kMapFileMagic && header.version == kMapFileVersion && header.fileSize == size && size % 8 == 0
+        && IsSectionValid(header.sections[(int)MapFileSection::WallVertices], sizeof(glm::vec2), size)
+        && IsSectionValid(header.sections[(int)MapFileSection::Walls], sizeof(Wall), size)
+        && IsSectionValid(header.sections[(int)MapFileSection::Sectors], sizeof(Sector), size)
+        && IsSectionValid(header.sections[(int)MapFileSection::SectorBounds], sizeof(SectorBounds), size)
+        && header.sections[(int)MapFileSection::SectorBounds].count == header.sections[(int)MapFileSection::Sectors].count;
+
+    if (valid)
+    {
+        SetSectionView(map.wallVertices, data, header.sections[(int)MapFileSection::WallVertices]);
+        SetSectionView(map.walls, data, header.sections[(int)MapFileSection::Walls]);
+        SetSectionView(map.sectors, data, header.sections[(int)MapFileSection::Sectors]);
+        SetSectionView(map.sectorBounds, data, header.sections[(int)MapFileSection::SectorBounds]);
+    }
+
+    if (valid && verify)
+    {
+        valid = ComputeChecksum(data + sizeof(MapFileHeader), size - sizeof(MapFileHeader)) == header.checksum && ValidateIndices();
+    }
+
+    if (!valid)
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void MapFile::Close()
+{
+    map = Map();
+
+    if (!data)
+    {
+        return;
+    }
+
+#if defined(_WIN32)
+    UnmapViewOfFile(data);
+    CloseHandle((HANDLE)mappingHandle);
+    CloseHandle((HANDLE)fileHandle);
+#else
+    munmap(const_cast<uint8_t*>(data), size);
+#endif
+
+    data = nullptr;
+    size = 0;
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+}
+
+bool MapFile::IsOpen() const
+{
+    return data != nullptr;
+}
+
+const MapFileHeader& MapFile::GetHeader() const
+{
+    return *reinterpret_cast<const MapFileHeader*>(data);
+}
+
+bool MapFile::Save(const char* path, const Map& map)
+{
+    const Map* source = &map;
+    Map withBounds;
+
+    if (map.sectorBounds.size() != map.sectors.size())
+    {
+        withBounds = map;
+        withBounds.ComputeSectorBounds();
+        source = &withBounds;
+    }
+
+    MapFileHeader header = {};
+    header.magic = kMapFileMagic;
+    header.version = kMapFileVersion;
+
+    const void* sectionData[(int)MapFileSection::Count] = {
+        source->wallVertices.data(),
+        source->walls.data(),
+        source->sectors.data(),
+        source->sectorBounds.data(),
+    };
+
+    size_t sectionCounts[(int)MapFileSection::Count] = {
+        source->wallVertices.size(),
+        source->walls.size(),
+        source->sectors.size(),
+        source->sectorBounds.size(),
+    };
+
+    uint32_t elementSizes[(int)MapFileSection::Count] = {
+        sizeof(glm::vec2),
+        sizeof(Wall),
+        sizeof(Sector),
+        sizeof(SectorBounds),
+    };
+
+    size_t offset = Align(sizeof(MapFileHeader));
+    for (int i = 0; i < (int)MapFileSection::Count; ++i)
+    {
+        header.sections[i].offset = offset;
+        header.sections[i].count = sectionCounts[i];
+        header.sections[i].elementSize = elementSizes[i];
+        offset = Align(offset + sectionCounts[i] * elementSizes[i]);
+    }
+    header.fileSize = offset;
+
+    // The padding between sections is zeroed, so the same map always produces the same file.
+    std::vector<uint8_t> bytes(offset, 0);
+    for (int i = 0; i < (int)MapFileSection::Count; ++i)
+    {
+        if (sectionCounts[i] > 0)
+        {
+            std::memcpy(&bytes[header.sections[i].offset], sectionData[i], sectionCounts[i] * elementSizes[i]);
+        }
+    }
+
+    header.checksum = ComputeChecksum(bytes.data() + sizeof(MapFileHeader), bytes.size() - sizeof(MapFileHeader));
+    std::memcpy(bytes.data(), &header, sizeof(header));
+
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return fclose(file) == 0 && written;
+}
+
+uint64_t MapFile::ComputeChecksum(const void* data, size_t size)
+{
+    // FNV-1a over 64 bit words instead of bytes, which keeps it cheap enough to run on every load.
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t checksum = kChecksumBasis;
+
+    for (size_t i = 0; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        checksum = (checksum ^ word) * kChecksumPrime;
+    }
+
+    return checksum;
+}
+
+bool MapFile::ValidateIndices() const
+{
+    size_t numVertices = map.wallVertices.size();
+    size_t numWalls = map.walls.size();
+    size_t numSectors = map.sectors.size();
+
+    for (const Sector& sector : map.sectors)
+    {
+        if (sector.firstWall < 0 || sector.numWalls < 0 || (size_t)sector.firstWall + (size_t)sector.numWalls > numWalls)
+        {
+            return false;
+        }
+    }
+
+    for (const Wall& wall : map.walls)
+    {
+        if (wall.v[0] < 0 || wall.v[1] < 0 || (size_t)wall.v[0] >= numVertices || (size_t)wall.v[1] >= numVertices)
+        {
+            return false;
+        }
+        if (wall.sector < -1 || (wall.sector >= 0 && (size_t)wall.sector >= numSectors))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "Map.h"
+
+// The sections of a binary map file, in the order they are stored.
+enum class MapFileSection : uint32_t
+{
+    WallVertices,
+    Walls,
+    Sectors,
+    SectorBounds,
+    Count
+};
+
+struct MapFileSectionInfo
+{
+    // The offset of the first element from the start of the file, a multiple of kMapFileAlignment.
+    uint64_t offset;
+
+    // The number of elements in the section.
+    uint64_t count;
+
+    // The size of each element in bytes.
+    uint32_t elementSize;
+
+    // Unused, always 0.
+    uint32_t reserved;
+};
+
+// The header at the start of every binary map file. All values are little endian.
+struct MapFileHeader
+{
+    // Always kMapFileMagic.
+    uint32_t magic;
+
+    // The version of the layout, kMapFileVersion for files this build can read.
+    uint32_t version;
+
+    // The size of the whole file in bytes, a multiple of kMapFileAlignment.
+    uint64_t fileSize;
+
+    // The checksum of everything after the header.
+    uint64_t checksum;
+
+    // Where to find each section.
+    MapFileSectionInfo sections[(int)MapFileSection::Count];
+};
+
+// "TMAP" read as a little endian integer.
+constexpr uint32_t kMapFileMagic = 0x50414D54;
+
+// Bumped whenever the layout of the header or any element changes.
+constexpr uint32_t kMapFileVersion = 1;
+
+// Sections start on cache line boundaries, so their elements can be used in place.
+constexpr size_t kMapFileAlignment = 64;
+
+// A binary map file mapped into memory. The arrays of the map view the mapping directly, so opening a file costs
+// no parsing and no allocation per element, and pages are only read from disk once they are touched.
+struct MapFile
+{
+    // The map stored in the file. Its arrays are only valid while the file is open.
+    Map map;
+
+    // Creates a new closed map file.
+    MapFile();
+
+    // Closes the file.
+    ~MapFile();
+
+    MapFile(const MapFile&) = delete;
+    MapFile& operator=(const MapFile&) = delete;
+
+    // Maps the given file and points the map at its sections. Verifying the file also checks the checksum and that
+    // every index in the map is in range, which reads the whole file; without it only the header is checked.
+    // Returns false if the file could not be mapped or is not a valid map file of this version.
+    bool Open(const char* path, bool verify = true);
+
+    // Unmaps the file and clears the map.
+    void Close();
+
+    // Returns true if a file is open.
+    bool IsOpen() const;
+
+    // Returns the header of the open file.
+    const MapFileHeader& GetHeader() const;
+
+    // Saves the given map to the given binary file. The sector bounds are computed if the map has none. Returns
+    // false if the file could not be written.
+    static bool Save(const char* path, const Map& map);
+
+    // Returns the checksum of the given bytes as stored in the header. The size must be a multiple of 8.
+    static uint64_t ComputeChecksum(const void* data, size_t size);
+
+private:
+    // Returns true if every index in the map refers to an existing element.
+    bool ValidateIndices() const;
+
+    const uint8_t* data;
+    size_t size;
+
+    // The platform handles of the mapping.
+    void* fileHandle;
+    void* mappingHandle;
+};
@@ -0,0 +1,210 @@
+#include "MapGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+    // The share of grid cells that become sectors. Leaving room around the tree lets it branch in any direction.
+    constexpr float kFillRatio = 0.5f;
+
+    // The grid offsets of the neighbours behind the four walls of a cell, in the order its walls are stored.
+    constexpr int kNeighbourX[4] = { 0, 1, 0, -1 };
+    constexpr int kNeighbourY[4] = { -1, 0, 1, 0 };
+
+    // Floors follow a smooth wave, so neighbouring floors stay close and every portal keeps an opening.
+    constexpr float kFloorAmplitude = 0.5f;
+    constexpr float kFloorFrequencyX = 0.37f;
+    constexpr float kFloorFrequencyY = 0.29f;
+    constexpr float kMinRoomHeight = 2.75f;
+    constexpr float kMaxRoomHeight = 3.75f;
+
+    struct Candidate
+    {
+        int cell;
+        int parentCell;
+    };
+
+    // Tracks which walls between cells are open. Each cell stores the wall to its right in bit 0 and the wall
+    // above it in bit 1, so both sides of a wall read the same bit.
+    struct OpenWalls
+    {
+        int gridSize;
+        std::vector<uint8_t> bits;
+
+        bool IsOpen(int cell, int direction) const
+        {
+            switch (direction)
+            {
+            case 0: return bits[cell - gridSize] & 2;
+            case 1: return bits[cell] & 1;
+            case 2: return bits[cell] & 2;
+            default: return bits[cell - 1] & 1;
+            }
+        }
+
+        void Open(int cell, int direction)
+        {
+            switch (direction)
+            {
+            case 0: bits[cell - gridSize] |= 2; break;
+            case 1: bits[cell] |= 1; break;
+            case 2: bits[cell] |= 2; break;
+            default: bits[cell - 1] |= 1; break;
+            }
+        }
+    };
+}
+
+MapGenerator::MapGenerator()
+    : numSectors(1000)
+    , branching(0.3f)
+    , openness(0.1f)
+    , cellSize(4.0f)
+    , seed(1)
+{
+}
+
+Map MapGenerator::Generate() const
+{
+    Map map;
+
+    if (numSectors <= 0)
+    {
+        return map;
+    }
+
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    int gridSize = std::max(1, (int)std::ceil(std::sqrt((float)numSectors / kFillRatio)));
+    std::vector<int> cellSectors(gridSize * gridSize, -1);
+    std::vector<int> sectorCells;
+    sectorCells.reserve(numSectors);
+
+    OpenWalls openWalls = { gridSize, std::vector<uint8_t>(gridSize * gridSize, 0) };
+
+    // Grow the spanning tree from the centre. Taking the newest candidate extends the current corridor, while a
+    // random one starts a branch somewhere along the tree.
+    std::vector<Candidate> frontier;
+    frontier.push_back({ (gridSize / 2) * gridSize + gridSize / 2, -1 });
+
+    int directions[4] = { 0, 1, 2, 3 };
+
+    while ((int)sectorCells.size() < numSectors && !frontier.empty())
+    {
+        size_t pick = unit(random) < branching ? (size_t)(random() % frontier.size()) : frontier.size() - 1;
+        Candidate candidate = frontier[pick];
+        frontier[pick] = frontier.back();
+        frontier.pop_back();
+
+        if (cellSectors[candidate.cell] != -1)
+        {
+            continue;
+        }
+
+        int cell = candidate.cell;
+        int x = cell % gridSize;
+        int y = cell / gridSize;
+
+        cellSectors[cell] = (int)sectorCells.size();
+        sectorCells.push_back(cell);
+
+        std::shuffle(directions, directions + 4, random);
+
+        for (int direction : directions)
+        {
+            int neighbourX = x + kNeighbourX[direction];
+            int neighbourY = y + kNeighbourY[direction];
+            if (neighbourX < 0 || neighbourY < 0 || neighbourX >= gridSize || neighbourY >= gridSize)
+            {
+                continue;
+            }
+
+            int neighbour = neighbourY * gridSize + neighbourX;
+            if (neighbour == candidate.parentCell)
+            {
+                openWalls.Open(cell, direction);
+            }
+            else if (cellSectors[neighbour] == -1)
+            {
+                frontier.push_back({ neighbour, cell });
+            }
+        }
+    }
+
+    // Open some of the remaining walls between sectors, which adds loops to the tree.
+    for (int cell : sectorCells)
+    {
+        for (int direction = 1; direction <= 2; ++direction)
+        {
+            int neighbourX = cell % gridSize + kNeighbourX[direction];
+            int neighbourY = cell / gridSize + kNeighbourY[direction];
+            if (neighbourX < gridSize && neighbourY < gridSize && cellSectors[neighbourY * gridSize + neighbourX] != -1 && unit(random) < openness)
+            {
+                openWalls.Open(cell, direction);
+            }
+        }
+    }
+
+    std::vector<glm::vec2> vertices;
+    std::vector<Sector> sectors;
+    std::vector<Wall> walls;
+    std::vector<int> gridVertices((gridSize + 1) * (gridSize + 1), -1);
+
+    sectors.reserve(sectorCells.size());
+    walls.reserve(sectorCells.size() * 4);
+
+    auto GetVertex = [&](int x, int y) {
+        int& index = gridVertices[y * (gridSize + 1) + x];
+        if (index == -1)
+        {
+            index = (int)vertices.size();
+            vertices.push_back(glm::vec2((float)x, (float)y) * cellSize);
+        }
+        return index;
+    };
+
+    float phaseX = unit(random) * 6.28318f;
+    float phaseY = unit(random) * 6.28318f;
+
+    for (int cell : sectorCells)
+    {
+        int x = cell % gridSize;
+        int y = cell / gridSize;
+
+        Sector sector;
+        sector.firstWall = (int)walls.size();
+        sector.numWalls = 4;
+        sector.floorHeight = kFloorAmplitude * (1.0f + std::sin((float)x * kFloorFrequencyX + phaseX) * std::cos((float)y * kFloorFrequencyY + phaseY));
+        sector.ceilingHeight = sector.floorHeight + kMinRoomHeight + (kMaxRoomHeight - kMinRoomHeight) * unit(random);
+        sectors.push_back(sector);
+
+        // The corners run counter-clockwise, like the walls of every other map.
+        int corners[4] = { GetVertex(x, y), GetVertex(x + 1, y), GetVertex(x + 1, y + 1), GetVertex(x, y + 1) };
+
+        for (int direction = 0; direction < 4; ++direction)
+        {
+            Wall wall;
+            wall.v[0] = corners[direction];
+            wall.v[1] = corners[(direction + 1) % 4];
+            wall.sector = -1;
+
+            int neighbourX = x + kNeighbourX[direction];
+            int neighbourY = y + kNeighbourY[direction];
+            if (neighbourX >= 0 && neighbourY >= 0 && neighbourX < gridSize && neighbourY < gridSize && openWalls.IsOpen(cell, direction))
+            {
+                wall.sector = cellSectors[neighbourY * gridSize + neighbourX];
+            }
+
+            walls.push_back(wall);
+        }
+    }
+
+    map.wallVertices = std::move(vertices);
+    map.sectors = std::move(sectors);
+    map.walls = std::move(walls);
+    map.ComputeSectorBounds();
+    return map;
+}
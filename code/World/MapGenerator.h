@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+
+#include "Map.h"
+
+// Generates maps of square sectors carved out of a grid by a randomized spanning tree, so every sector is reachable
+// through portals. Both sides of every portal refer to each other, and neighbouring floors and ceilings always
+// leave an opening, so the maps are valid input for everything that traverses portals.
+struct MapGenerator
+{
+    // The number of sectors to generate.
+    int numSectors;
+
+    // How often the carving branches off instead of extending the newest corridor, from 0 for long winding
+    // corridors to 1 for bushy trees.
+    float branching;
+
+    // The chance that two neighbouring sectors not joined by the spanning tree get a portal anyway, from 0 for a
+    // pure maze to 1 for open halls.
+    float openness;
+
+    // The width and depth of each sector.
+    float cellSize;
+
+    // The seed of the random numbers. The same settings and seed always generate the same map.
+    uint32_t seed;
+
+    // Creates a new generator with settings for a small map.
+    MapGenerator();
+
+    // Generates a new map with the current settings. The sector bounds are computed as well.
+    Map Generate() const;
+};
@@ -0,0 +1,230 @@
+#include "PortalWindows.h"
+#include <array>
+#include <cfloat>
+
+#include "Debug/Profiler.h"
+
+namespace
+{
+    // Portals closer to the eye than this pass the window of the sector they belong to on unchanged, since their
+    // projection degenerates when standing inside the portal.
+    constexpr float kNearPortalDistance = 0.2f;
+
+    // Polygons are clipped against the plane at this clip space w before they are projected.
+    constexpr float kMinClipW = 1e-3f;
+
+    // A clipped quad gains at most one vertex.
+    constexpr int kMaxPortalVertices = 5;
+
+    // Returns the pixels covering the given NDC extents on a target of the given size.
+    ScreenRect GetScreenRect(const glm::vec2& min, const glm::vec2& max, int width, int height)
+    {
+        // Screen rows grow downwards while NDC y grows upwards.
+        glm::vec2 size = glm::vec2((float)width, (float)height);
+        glm::vec2 screenMin = glm::clamp(glm::vec2(min.x + 1.0f, 1.0f - max.y) * 0.5f * size, glm::vec2(0.0f), size);
+        glm::vec2 screenMax = glm::clamp(glm::vec2(max.x + 1.0f, 1.0f - min.y) * 0.5f * size, glm::vec2(0.0f), size);
+
+        return ScreenRect(glm::ivec2(glm::floor(screenMin)), glm::ivec2(glm::ceil(screenMax)));
+    }
+}
+
+PortalWindows::PortalWindows()
+    : numPortalsTested(0)
+    , numPortalsEmpty(0)
+    , viewProjection(1.0f)
+    , width(0)
+    , height(0)
+{
+}
+
+void PortalWindows::Compute(const Map& map, int startSector, const glm::vec3& eye, const glm::mat4& viewProjection, int width, int height)
+{
+    PROFILE_ZONE("Portal windows");
+
+    this->viewProjection = viewProjection;
+    this->width = width;
+    this->height = height;
+
+    if (windows.size() != map.sectors.size())
+    {
+        windows.assign(map.sectors.size(), ScreenRect());
+    }
+    else
+    {
+        // Only clear what the last traversal touched, so the cost does not depend on the map size.
+        for (int sectorIndex : visibleSectors)
+        {
+            windows[sectorIndex] = ScreenRect();
+        }
+    }
+
+    visibleSectors.clear();
+    stack.clear();
+    numPortalsTested = 0;
+    numPortalsEmpty = 0;
+
+    if (startSector < 0)
+    {
+        return;
+    }
+
+    windows[startSector] = ScreenRect(glm::ivec2(0), glm::ivec2(width, height));
+    visibleSectors.push_back(startSector);
+    stack.push_back(startSector);
+
+    while (!stack.empty())
+    {
+        int sectorIndex = stack.back();
+        stack.pop_back();
+
+        const Sector& sector = map.sectors[sectorIndex];
+
+        // The window may have grown since the sector was pushed; passing the grown one on covers both paths at once.
+        ScreenRect window = windows[sectorIndex];
+
+        for (int i = 0; i < sector.numWalls; ++i)
+        {
+            const Wall& wall = map.walls[sector.firstWall + i];
+
+            if (wall.sector == -1 || wall.sector == startSector)
+            {
+                continue;
+            }
+
+            numPortalsTested++;
+
+            const Sector& otherSector = map.sectors[wall.sector];
+            float floorHeight = glm::max(sector.floorHeight, otherSector.floorHeight);
+            float ceilingHeight = glm::min(sector.ceilingHeight, otherSector.ceilingHeight);
+
+            if (ceilingHeight <= floorHeight)
+            {
+                continue;
+            }
+
+            glm::vec3 bottom[2];
+            map.GetWallPositions(wall, floorHeight, bottom);
+
+            // Portals are only seen from the inside of the sector they belong to.
+            float eyeDistance = -glm::dot(map.GetWallNormal(wall), eye - bottom[0]);
+
+            if (eyeDistance <= 0.0f)
+            {
+                continue;
+            }
+
+            ScreenRect portalWindow = window;
+
+            if (eyeDistance >= kNearPortalDistance)
+            {
+                glm::vec3 up = glm::vec3(0.0f, ceilingHeight - floorHeight, 0.0f);
+
+                glm::vec4 vertices[4] = {
+                    viewProjection * glm::vec4(bottom[0] + up, 1.0f),
+                    viewProjection * glm::vec4(bottom[1] + up, 1.0f),
+                    viewProjection * glm::vec4(bottom[1], 1.0f),
+                    viewProjection * glm::vec4(bottom[0], 1.0f),
+                };
+
+                portalWindow = ProjectPolygon(vertices, 4).Intersect(window);
+            }
+
+            if (portalWindow.IsEmpty())
+            {
+                numPortalsEmpty++;
+                continue;
+            }
+
+            ScreenRect& otherWindow = windows[wall.sector];
+            if (otherWindow.IsEmpty())
+            {
+                visibleSectors.push_back(wall.sector);
+            }
+
+            // A sector is only traversed again when another path shows more of it, which ends loops of portals
+            // once their windows stop growing.
+            ScreenRect grown = otherWindow;
+            grown += portalWindow;
+
+            if (!(grown == otherWindow))
+            {
+                otherWindow = grown;
+                stack.push_back(wall.sector);
+            }
+        }
+    }
+}
+
+ScreenRect PortalWindows::GetWindow(int sectorIndex) const
+{
+    if (sectorIndex < 0 || sectorIndex >= (int)windows.size())
+    {
+        return ScreenRect();
+    }
+    return windows[sectorIndex];
+}
+
+ScreenRect PortalWindows::ProjectBox(const Box& box) const
+{
+    std::array<glm::vec3, 8> corners;
+    box.GetCornerPoints(corners);
+
+    glm::vec2 min = glm::vec2(FLT_MAX);
+    glm::vec2 max = glm::vec2(-FLT_MAX);
+
+    for (const glm::vec3& corner : corners)
+    {
+        glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+        if (clip.w < kMinClipW)
+        {
+            return ScreenRect(glm::ivec2(0), glm::ivec2(width, height));
+        }
+
+        glm::vec2 ndc = glm::vec2(clip) / clip.w;
+        min = glm::min(min, ndc);
+        max = glm::max(max, ndc);
+    }
+
+    return GetScreenRect(min, max, width, height);
+}
+
+ScreenRect PortalWindows::ProjectPolygon(const glm::vec4* vertices, int numVertices) const
+{
+    glm::vec4 clipped[kMaxPortalVertices];
+    int numClipped = 0;
+
+    for (int i = 0; i < numVertices; ++i)
+    {
+        const glm::vec4& a = vertices[i];
+        const glm::vec4& b = vertices[(i + 1) % numVertices];
+        float da = a.w - kMinClipW;
+        float db = b.w - kMinClipW;
+
+        if (da >= 0.0f)
+        {
+            clipped[numClipped++] = a;
+        }
+
+        if ((da >= 0.0f) != (db >= 0.0f))
+        {
+            clipped[numClipped++] = a + (b - a) * (da / (da - db));
+        }
+    }
+
+    if (numClipped < 3)
+    {
+        return ScreenRect();
+    }
+
+    glm::vec2 min = glm::vec2(FLT_MAX);
+    glm::vec2 max = glm::vec2(-FLT_MAX);
+
+    for (int i = 0; i < numClipped; ++i)
+    {
+        glm::vec2 ndc = glm::vec2(clipped[i]) / clipped[i].w;
+        min = glm::min(min, ndc);
+        max = glm::max(max, ndc);
+    }
+
+    return GetScreenRect(min, max, width, height);
+}
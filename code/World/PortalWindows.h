@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Map.h"
+#include "Math/Box.h"
+#include "Math/ScreenRect.h"
+
+// Finds the screen rectangle each sector can be seen through. The rectangle of every portal is intersected with the
+// window of the sector it belongs to, so a sector's window is the union of the rectangles along all paths that reach
+// it. The windows bound the pixels a sector can cover, which makes them usable as scissors for its draws.
+struct PortalWindows
+{
+    // The window of each sector found by the last traversal. Sectors that were not reached have an empty window.
+    std::vector<ScreenRect> windows;
+
+    // The indices of the sectors with a window, in the order they were first reached.
+    std::vector<int> visibleSectors;
+
+    // The number of portals tested by the last traversal.
+    int numPortalsTested;
+
+    // The number of portals the last traversal skipped because their window became empty.
+    int numPortalsEmpty;
+
+    // Creates a new empty set of windows.
+    PortalWindows();
+
+    // Finds the windows of all sectors visible from the given eye through the portals of the start sector, on a
+    // target of the given size. The start sector gets the whole target.
+    void Compute(const Map& map, int startSector, const glm::vec3& eye, const glm::mat4& viewProjection, int width, int height);
+
+    // Returns the window of the given sector, or an empty rectangle if it was not reached.
+    ScreenRect GetWindow(int sectorIndex) const;
+
+    // Returns the screen rectangle covered by the given box in the view of the last traversal. Boxes reaching
+    // behind the eye cover the whole target.
+    ScreenRect ProjectBox(const Box& box) const;
+
+private:
+    // Returns the screen rectangle covered by the given clip space polygon, after clipping it against the plane
+    // just in front of the eye.
+    ScreenRect ProjectPolygon(const glm::vec4* vertices, int numVertices) const;
+
+    glm::mat4 viewProjection;
+    int width;
+    int height;
+
+    std::vector<int> stack;
+};
@@ -0,0 +1,212 @@
+#include "SectorLocator.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    // Converts a world space point to the map plane the walls are defined in.
+    glm::vec2 ToMapSpace(const glm::vec3& point)
+    {
+        return glm::vec2(point.x, -point.z);
+    }
+}
+
+SectorLocator::SectorLocator()
+    : gridMin(0.0f)
+    , cellSize(1.0f)
+    , gridWidth(0)
+    , gridHeight(0)
+{
+}
+
+void SectorLocator::Build(const Map& map)
+{
+    sectors.clear();
+    vertices.clear();
+    neighbours.clear();
+    cellStart.clear();
+    cellSectors.clear();
+    gridWidth = 0;
+    gridHeight = 0;
+
+    if (map.sectors.empty())
+    {
+        return;
+    }
+
+    glm::vec2 mapMin = glm::vec2(std::numeric_limits<float>::max());
+    glm::vec2 mapMax = glm::vec2(std::numeric_limits<float>::lowest());
+
+    sectors.reserve(map.sectors.size());
+    vertices.reserve(map.walls.size());
+
+    // Bounds stored with the map are used as they are instead of being gathered from the walls again.
+    bool hasBounds = map.sectorBounds.size() == map.sectors.size();
+
+    for (size_t sectorIndex = 0; sectorIndex < map.sectors.size(); ++sectorIndex)
+    {
+        const Sector& sector = map.sectors[sectorIndex];
+
+        SectorInfo info;
+        info.firstVertex = (int)vertices.size();
+        info.numVertices = sector.numWalls;
+        info.firstNeighbour = (int)neighbours.size();
+        info.min = glm::vec2(std::numeric_limits<float>::max());
+        info.max = glm::vec2(std::numeric_limits<float>::lowest());
+
+        for (int i = 0; i < sector.numWalls; ++i)
+        {
+            const Wall& wall = map.walls[sector.firstWall + i];
+            const glm::vec2& v = map.wallVertices[wall.v[0]];
+
+            vertices.push_back(v);
+            if (!hasBounds)
+            {
+                info.min = glm::min(info.min, v);
+                info.max = glm::max(info.max, v);
+            }
+
+            if (wall.sector != -1 && std::find(neighbours.begin() + info.firstNeighbour, neighbours.end(), wall.sector) == neighbours.end())
+            {
+                neighbours.push_back(wall.sector);
+            }
+        }
+
+        if (hasBounds)
+        {
+            info.min = map.sectorBounds[sectorIndex].min;
+            info.max = map.sectorBounds[sectorIndex].max;
+        }
+
+        info.numNeighbours = (int)neighbours.size() - info.firstNeighbour;
+        mapMin = glm::min(mapMin, info.min);
+        mapMax = glm::max(mapMax, info.max);
+        sectors.push_back(info);
+    }
+
+    // Aim for roughly one sector per cell.
+    glm::vec2 size = glm::max(mapMax - mapMin, glm::vec2(1e-3f));
+    cellSize = glm::max(std::sqrt(size.x * size.y / (float)sectors.size()), 1e-3f);
+    gridMin = mapMin;
+    gridWidth = std::max(1, (int)std::ceil(size.x / cellSize));
+    gridHeight = std::max(1, (int)std::ceil(size.y / cellSize));
+
+    auto GetCellRange = [&](const SectorInfo& info, glm::ivec2& first, glm::ivec2& last) {
+        first = glm::clamp(glm::ivec2(glm::floor((info.min - gridMin) / cellSize)), glm::ivec2(0), glm::ivec2(gridWidth - 1, gridHeight - 1));
+        last = glm::clamp(glm::ivec2(glm::floor((info.max - gridMin) / cellSize)), glm::ivec2(0), glm::ivec2(gridWidth - 1, gridHeight - 1));
+    };
+
+    // Count the sectors per cell first, so the cell lists can be stored contiguously.
+    cellStart.assign(gridWidth * gridHeight + 1, 0);
+
+    for (const SectorInfo& info : sectors)
+    {
+        glm::ivec2 first, last;
+        GetCellRange(info, first, last);
+
+        for (int y = first.y; y <= last.y; ++y)
+        {
+            for (int x = first.x; x <= last.x; ++x)
+            {
+                cellStart[y * gridWidth + x + 1]++;
+            }
+        }
+    }
+
+    for (size_t i = 1; i < cellStart.size(); ++i)
+    {
+        cellStart[i] += cellStart[i - 1];
+    }
+
+    std::vector<int> cellFill(cellStart.begin(), cellStart.end() - 1);
+    cellSectors.resize(cellStart.back());
+
+    for (int sectorIndex = 0; sectorIndex < (int)sectors.size(); ++sectorIndex)
+    {
+        glm::ivec2 first, last;
+        GetCellRange(sectors[sectorIndex], first, last);
+
+        for (int y = first.y; y <= last.y; ++y)
+        {
+            for (int x = first.x; x <= last.x; ++x)
+            {
+                cellSectors[cellFill[y * gridWidth + x]++] = sectorIndex;
+            }
+        }
+    }
+}
+
+int SectorLocator::Locate(const glm::vec3& point, int hintSector) const
+{
+    glm::vec2 p = ToMapSpace(point);
+
+    if (hintSector >= 0 && hintSector < (int)sectors.size())
+    {
+        if (ContainsPoint(hintSector, p))
+        {
+            return hintSector;
+        }
+
+        const SectorInfo& hint = sectors[hintSector];
+        for (int i = 0; i < hint.numNeighbours; ++i)
+        {
+            int neighbour = neighbours[hint.firstNeighbour + i];
+            if (ContainsPoint(neighbour, p))
+            {
+                return neighbour;
+            }
+        }
+    }
+
+    if (gridWidth == 0)
+    {
+        return -1;
+    }
+
+    glm::ivec2 cell = glm::ivec2(glm::floor((p - gridMin) / cellSize));
+    if (cell.x < 0 || cell.y < 0 || cell.x >= gridWidth || cell.y >= gridHeight)
+    {
+        return -1;
+    }
+
+    int cellIndex = cell.y * gridWidth + cell.x;
+    for (int i = cellStart[cellIndex]; i < cellStart[cellIndex + 1]; ++i)
+    {
+        if (ContainsPoint(cellSectors[i], p))
+        {
+            return cellSectors[i];
+        }
+    }
+
+    return -1;
+}
+
+bool SectorLocator::ContainsPoint(int sectorIndex, const glm::vec3& point) const
+{
+    return ContainsPoint(sectorIndex, ToMapSpace(point));
+}
+
+bool SectorLocator::ContainsPoint(int sectorIndex, const glm::vec2& point) const
+{
+    const SectorInfo& info = sectors[sectorIndex];
+
+    if (point.x < info.min.x || point.y < info.min.y || point.x > info.max.x || point.y > info.max.y)
+    {
+        return false;
+    }
+
+    const glm::vec2* v = &vertices[info.firstVertex];
+    bool inside = false;
+
+    for (int i = 0, j = info.numVertices - 1; i < info.numVertices; j = i++)
+    {
+        if (((v[i].y > point.y) != (v[j].y > point.y)) &&
+            (point.x < (v[j].x - v[i].x) * (point.y - v[i].y) / (v[j].y - v[i].y) + v[i].x))
+        {
+            inside = !inside;
+        }
+    }
+
+    return inside;
+}
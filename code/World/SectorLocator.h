@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Map.h"
+
+struct SectorLocator
+{
+    // Creates an empty locator that finds no sectors.
+    SectorLocator();
+
+    // Builds the sector polygons and the lookup grid for the given map.
+    void Build(const Map& map);
+
+    // Returns the index of the sector containing the given point or -1 if there is none.
+    // The hint sector and its portal neighbours are tested before the grid is queried.
+    int Locate(const glm::vec3& point, int hintSector = -1) const;
+
+    // Returns true if the given point lies inside the given sector.
+    bool ContainsPoint(int sectorIndex, const glm::vec3& point) const;
+
+private:
+    struct SectorInfo
+    {
+        int firstVertex;
+        int numVertices;
+        int firstNeighbour;
+        int numNeighbours;
+        glm::vec2 min;
+        glm::vec2 max;
+    };
+
+    // Returns true if the given map space point lies inside the given sector.
+    bool ContainsPoint(int sectorIndex, const glm::vec2& point) const;
+
+    std::vector<SectorInfo> sectors;
+    std::vector<glm::vec2> vertices;
+    std::vector<int> neighbours;
+
+    glm::vec2 gridMin;
+    float cellSize;
+    int gridWidth;
+    int gridHeight;
+
+    // The sectors overlapping each cell, stored contiguously from cellStart[cell] to cellStart[cell + 1].
+    std::vector<int> cellStart;
+    std::vector<int> cellSectors;
+};
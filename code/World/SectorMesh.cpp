@@ -0,0 +1,311 @@
+#include "SectorMesh.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    // The number of sectors built by each job.
+    constexpr int kSectorsPerChunk = 256;
+
+    // The tint that faces are shaded with by the absolute value of their normal.
+    constexpr glm::vec3 kShade = glm::vec3(0.8f, 0.65f, 0.9f);
+
+    struct VertexHash
+    {
+        size_t operator()(const Vertex& vertex) const
+        {
+            // FNV-1a over the raw bytes, matching the bitwise comparison in VertexEqual.
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertex);
+            size_t hash = 14695981039346656037ull;
+            for (size_t i = 0; i < sizeof(Vertex); ++i)
+            {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+            return hash;
+        }
+    };
+
+    struct VertexEqual
+    {
+        bool operator()(const Vertex& a, const Vertex& b) const
+        {
+            return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+        }
+    };
+
+    using VertexMap = std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual>;
+
+    // Returns the index of an identical vertex of the current sector or appends the vertex.
+    uint32_t AddVertex(SectorMesh& mesh, VertexMap& weldedVertices, const Vertex& vertex)
+    {
+        auto [it, inserted] = weldedVertices.try_emplace(vertex, (uint32_t)mesh.vertices.size());
+        if (inserted)
+        {
+            mesh.vertices.push_back(vertex);
+        }
+        return it->second;
+    }
+
+    void AddWallQuad(SectorMesh& mesh, VertexMap& weldedVertices, const glm::vec3 v[2], float floorHeight, float ceilingHeight, const glm::vec3& color)
+    {
+        glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+        float length = glm::distance(v[0], v[1]);
+
+        Vertex quad[4] = {
+            { v[0] + up * ceilingHeight, glm::vec2(0.0f, ceilingHeight), color },
+            { v[1] + up * ceilingHeight, glm::vec2(length, ceilingHeight), color },
+            { v[1] + up * floorHeight, glm::vec2(length, floorHeight), color },
+            { v[0] + up * floorHeight, glm::vec2(0.0f, floorHeight), color }
+        };
+
+        uint32_t index[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            index[i] = AddVertex(mesh, weldedVertices, quad[i]);
+        }
+
+        mesh.indices.insert(mesh.indices.end(), { index[0], index[1], index[2], index[0], index[2], index[3] });
+    }
+
+    float Cross(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c)
+    {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    }
+}
+
+void SectorMesh::Build(const Map& map, JobSystem* jobs)
+{
+    int numSectors = (int)map.sectors.size();
+    int numChunks = (numSectors + kSectorsPerChunk - 1) / kSectorsPerChunk;
+
+    if (!jobs || jobs->GetNumThreads() == 1 || numChunks <= 1)
+    {
+        vertices.clear();
+        indices.clear();
+        ranges.clear();
+        ranges.reserve(numSectors);
+        AddSectors(map, 0, numSectors);
+        return;
+    }
+
+    // Every chunk of sectors is built into a mesh of its own, which are then concatenated in order, so the result
+    // is the same as building all sectors in one go.
+    std::vector<SectorMesh> chunks(numChunks);
+    jobs->ParallelFor(numChunks, 1, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+        {
+            int firstSector = i * kSectorsPerChunk;
+            chunks[i].ranges.reserve(kSectorsPerChunk);
+            chunks[i].AddSectors(map, firstSector, std::min(firstSector + kSectorsPerChunk, numSectors));
+        }
+    });
+
+    std::vector<int> firstVertices(numChunks + 1, 0);
+    std::vector<int> firstIndices(numChunks + 1, 0);
+    for (int i = 0; i < numChunks; ++i)
+    {
+        firstVertices[i + 1] = firstVertices[i] + (int)chunks[i].vertices.size();
+        firstIndices[i + 1] = firstIndices[i] + (int)chunks[i].indices.size();
+    }
+
+    vertices.resize(firstVertices[numChunks]);
+    indices.resize(firstIndices[numChunks]);
+    ranges.resize(numSectors);
+
+    jobs->ParallelFor(numChunks, 1, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+        {
+            const SectorMesh& chunk = chunks[i];
+            std::copy(chunk.vertices.begin(), chunk.vertices.end(), vertices.begin() + firstVertices[i]);
+
+            for (size_t j = 0; j < chunk.indices.size(); ++j)
+            {
+                indices[firstIndices[i] + j] = chunk.indices[j] + (uint32_t)firstVertices[i];
+            }
+
+            for (size_t j = 0; j < chunk.ranges.size(); ++j)
+            {
+                SectorMeshRange range = chunk.ranges[j];
+                range.firstVertex += firstVertices[i];
+                range.firstIndex += firstIndices[i];
+                ranges[i * kSectorsPerChunk + j] = range;
+            }
+        }
+    });
+}
+
+void SectorMesh::AddSectors(const Map& map, int firstSector, int endSector)
+{
+    VertexMap weldedVertices;
+    std::vector<glm::vec2> polygon;
+    std::vector<int> triangles;
+
+    for (int sectorIndex = firstSector; sectorIndex < endSector; ++sectorIndex)
+    {
+        const Sector& sector = map.sectors[sectorIndex];
+
+        SectorMeshRange range;
+        range.firstVertex = (int)vertices.size();
+        range.firstIndex = (int)indices.size();
+
+        weldedVertices.clear();
+
+        for (int i = 0; i < sector.numWalls; ++i)
+        {
+            const Wall& wall = map.walls[sector.firstWall + i];
+
+            glm::vec3 v[2];
+            map.GetWallPositions(wall, 0.0f, v);
+
+            glm::vec3 color = glm::vec3(glm::dot(kShade, glm::abs(map.GetWallNormal(wall))));
+
+            if (wall.sector == -1)
+            {
+                AddWallQuad(*this, weldedVertices, v, sector.floorHeight, sector.ceilingHeight, color);
+                continue;
+            }
+
+            // Portals only have walls where the neighbour's opening is smaller than this sector.
+            const Sector& otherSector = map.sectors[wall.sector];
+            if (otherSector.floorHeight > sector.floorHeight)
+            {
+                AddWallQuad(*this, weldedVertices, v, sector.floorHeight, otherSector.floorHeight, color);
+            }
+            if (otherSector.ceilingHeight < sector.ceilingHeight)
+            {
+                AddWallQuad(*this, weldedVertices, v, otherSector.ceilingHeight, sector.ceilingHeight, color);
+            }
+        }
+
+        polygon.clear();
+        for (int i = 0; i < sector.numWalls; ++i)
+        {
+            polygon.push_back(map.wallVertices[map.walls[sector.firstWall + i].v[0]]);
+        }
+
+        triangles.clear();
+        TriangulatePolygon(polygon.data(), (int)polygon.size(), triangles);
+
+        glm::vec3 color = glm::vec3(glm::dot(kShade, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+        for (size_t i = 0; i < triangles.size(); i += 3)
+        {
+            uint32_t floor[3];
+            uint32_t ceiling[3];
+
+            for (int j = 0; j < 3; ++j)
+            {
+                const glm::vec2& p = polygon[triangles[i + j]];
+                floor[j] = AddVertex(*this, weldedVertices, { glm::vec3(p.x, sector.floorHeight, -p.y), p, color });
+                ceiling[j] = AddVertex(*this, weldedVertices, { glm::vec3(p.x, sector.ceilingHeight, -p.y), p, color });
+            }
+
+            // The ceiling faces down, so its triangles are wound the other way around.
+            indices.insert(indices.end(), { floor[0], floor[1], floor[2], ceiling[0], ceiling[2], ceiling[1] });
+        }
+
+        range.numVertices = (int)vertices.size() - range.firstVertex;
+        range.numIndices = (int)indices.size() - range.firstIndex;
+        for (int i = range.firstVertex; i < range.firstVertex + range.numVertices; ++i)
+        {
+            range.bounds += vertices[i].position;
+        }
+
+        ranges.push_back(range);
+    }
+}
+
+bool TriangulatePolygon(const glm::vec2* vertices, int numVertices, std::vector<int>& triangles)
+{
+    if (numVertices < 3)
+    {
+        return false;
+    }
+
+    float area = 0.0f;
+    for (int i = 0, j = numVertices - 1; i < numVertices; j = i++)
+    {
+        area += vertices[j].x * vertices[i].y - vertices[i].x * vertices[j].y;
+    }
+    float orientation = area >= 0.0f ? 1.0f : -1.0f;
+
+    std::vector<int> remaining(numVertices);
+    for (int i = 0; i < numVertices; ++i)
+    {
+        remaining[i] = i;
+    }
+
+    while (remaining.size() > 3)
+    {
+        size_t count = remaining.size();
+        size_t ear = count;
+        size_t collinear = count;
+
+        for (size_t k = 0; k < count && ear == count; ++k)
+        {
+            const glm::vec2& a = vertices[remaining[(k + count - 1) % count]];
+            const glm::vec2& b = vertices[remaining[k]];
+            const glm::vec2& c = vertices[remaining[(k + 1) % count]];
+
+            float turn = Cross(a, b, c) * orientation;
+            if (turn <= 0.0f)
+            {
+                if (turn == 0.0f)
+                {
+                    collinear = k;
+                }
+                continue;
+            }
+
+            // An ear must not contain any of the other remaining vertices.
+            bool isEar = true;
+            for (size_t m = 0; m < count && isEar; ++m)
+            {
+                const glm::vec2& p = vertices[remaining[m]];
+                if (p == a || p == b || p == c)
+                {
+                    continue;
+                }
+
+                isEar = !(Cross(a, b, p) * orientation >= 0.0f &&
+                          Cross(b, c, p) * orientation >= 0.0f &&
+                          Cross(c, a, p) * orientation >= 0.0f);
+            }
+
+            if (isEar)
+            {
+                ear = k;
+            }
+        }
+
+        if (ear != count)
+        {
+            triangles.push_back(remaining[(ear + count - 1) % count]);
+            triangles.push_back(remaining[ear]);
+            triangles.push_back(remaining[(ear + 1) % count]);
+            remaining.erase(remaining.begin() + ear);
+        }
+        else if (collinear != count)
+        {
+            // A vertex in the middle of a straight edge adds no area.
+            remaining.erase(remaining.begin() + collinear);
+        }
+        else
+        {
+            // Self-intersecting polygons have no ears left, fan what remains.
+            for (size_t k = 1; k + 1 < count; ++k)
+            {
+                triangles.push_back(remaining[0]);
+                triangles.push_back(remaining[k]);
+                triangles.push_back(remaining[k + 1]);
+            }
+            return false;
+        }
+    }
+
+    triangles.push_back(remaining[0]);
+    triangles.push_back(remaining[1]);
+    triangles.push_back(remaining[2]);
+    return true;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Map.h"
+#include "Jobs/JobSystem.h"
+#include "Math/Box.h"
+#include "Render/Vertex.h"
+
+struct SectorMeshRange
+{
+    // The index of the first vertex of the sector.
+    int firstVertex;
+
+    // The number of vertices of the sector.
+    int numVertices;
+
+    // The index of the first index of the sector.
+    int firstIndex;
+
+    // The number of indices of the sector, three per triangle.
+    int numIndices;
+
+    // The bounds of the sector geometry.
+    Box bounds;
+};
+
+struct SectorMesh
+{
+    // The welded vertices of all sectors, stored contiguously per sector.
+    std::vector<Vertex> vertices;
+
+    // The triangle indices of all sectors into the vertices, stored contiguously per sector.
+    std::vector<uint32_t> indices;
+
+    // The vertex and index range of each sector.
+    std::vector<SectorMeshRange> ranges;
+
+    // Builds the walls, steps, floors and ceilings of all sectors of the given map, spreading chunks of sectors
+    // over the given jobs if there are any.
+    void Build(const Map& map, JobSystem* jobs = nullptr);
+
+private:
+    // Appends the geometry of the given range of sectors.
+    void AddSectors(const Map& map, int firstSector, int endSector);
+};
+
+// Triangulates the given simple polygon by ear clipping and appends the indices of the
+// triangles to the given list. The triangles keep the winding of the polygon.
+// Returns false if the polygon is degenerate and had to be fanned.
+bool TriangulatePolygon(const glm::vec2* vertices, int numVertices, std::vector<int>& triangles);
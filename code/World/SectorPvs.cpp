@@ -0,0 +1,426 @@
+#include "SectorPvs.h"
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <bit>
+#include <glm/glm.hpp>
+
+namespace
+{
+    // Points closer than this are treated as the same when building separating lines, in map units.
+    constexpr float kStabEpsilon = 1e-4f;
+
+    // Windows narrower than this fraction of their portal are treated as closed.
+    constexpr float kMinWindowLength = 1e-4f;
+
+    // Sectors are split into this many runs per thread when compiled in parallel.
+    constexpr int kRunsPerThread = 8;
+
+    // Identifies compiled PVS files.
+    constexpr uint32_t kPvsMagic = 0x32535650; // "PVS2"
+
+    struct Segment
+    {
+        glm::vec2 a;
+        glm::vec2 b;
+    };
+
+    // The part of a portal a chain can still see through, as an interval of the portal's start to end parameter.
+    struct Window
+    {
+        int portal;
+        float start;
+        float end;
+    };
+
+    float Cross(const glm::vec2& a, const glm::vec2& b)
+    {
+        return a.x * b.y - a.y * b.x;
+    }
+
+    Segment GetSegment(const Map& map, const Wall& wall)
+    {
+        return { map.wallVertices[wall.v[0]], map.wallVertices[wall.v[1]] };
+    }
+
+    Segment GetSubSegment(const Segment& segment, float start, float end)
+    {
+        glm::vec2 edge = segment.b - segment.a;
+        return { segment.a + edge * start, segment.a + edge * end };
+    }
+
+    // Clips the interval of the segment to the side of the line through origin along direction where the signed
+    // distance has the given sign. Returns false if less than a sliver is left, so lines grazing collinear walls
+    // do not leak through zero-width windows.
+    bool ClipToLine(const Segment& segment, const glm::vec2& origin, const glm::vec2& direction, float side, float& start, float& end)
+    {
+        float distanceA = side * Cross(direction, segment.a - origin);
+        float distanceB = side * Cross(direction, segment.b - origin);
+
+        if (distanceA <= 0.0f && distanceB <= 0.0f)
+        {
+            return false;
+        }
+        if (distanceA < 0.0f || distanceB < 0.0f)
+        {
+            float t = distanceA / (distanceA - distanceB);
+            if (distanceA < 0.0f)
+            {
+                start = std::max(start, t);
+            }
+            else
+            {
+                end = std::min(end, t);
+            }
+        }
+        return end - start > kMinWindowLength;
+    }
+
+    // Clips the interval of the segment to the outer side of the wall, where everything seen through it has to be.
+    bool ClipBeyond(const Segment& wall, const Segment& segment, float& start, float& end)
+    {
+        // Walls wind so their outer side is on the right, which is the negative side of Cross.
+        return ClipToLine(segment, wall.a, wall.b - wall.a, -1.0f, start, end);
+    }
+
+    // Clips the interval of the segment to the anti-penumbra of light from the source passing through the window.
+    // It is bounded by the lines through a source and a window endpoint that separate the two segments.
+    bool ClipAntiPenumbra(const Segment& source, const Segment& window, const Segment& segment, float& start, float& end)
+    {
+        const glm::vec2 sourcePoints[2] = { source.a, source.b };
+        const glm::vec2 windowPoints[2] = { window.a, window.b };
+
+        for (int i = 0; i < 2; ++i)
+        {
+            for (int j = 0; j < 2; ++j)
+            {
+                glm::vec2 direction = windowPoints[j] - sourcePoints[i];
+                if (glm::dot(direction, direction) < kStabEpsilon * kStabEpsilon)
+                {
+                    continue;
+                }
+
+                float sourceSide = Cross(direction, sourcePoints[i ^ 1] - sourcePoints[i]);
+                float windowSide = Cross(direction, windowPoints[j ^ 1] - sourcePoints[i]);
+                if (sourceSide * windowSide >= 0.0f)
+                {
+                    continue;
+                }
+
+                if (!ClipToLine(segment, sourcePoints[i], direction, windowSide > 0.0f ? 1.0f : -1.0f, start, end))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Marks every sector seen through a chain of portals starting at one of the portals of the source sector.
+    // Each portal is clipped to the part visible from the whole source portal through the window of the portal
+    // before it. A portal reached again is only expanded when its window grows, and then with the union of both,
+    // which only ever adds sectors and keeps the set conservative.
+    //
+    // The scratch buffers are as large as the map but only the entries a walk touched are reset afterwards, so a
+    // sector costs as much as the portals seen from it rather than the size of the map. The visible sectors are
+    // listed in the given order, and their bits and the explored ranges are all clear again on return.
+    void CompileSector(const Map& map, int sectorIndex, std::vector<uint8_t>& bits, std::vector<glm::vec2>& explored, std::vector<int>& exploredPortals, std::vector<Window>& stack, std::vector<int>& visible)
+    {
+        visible.clear();
+        auto Mark = [&](int sector) {
+            if (!(bits[sector >> 3] & (1 << (sector & 7))))
+            {
+                bits[sector >> 3] |= 1 << (sector & 7);
+                visible.push_back(sector);
+            }
+        };
+
+        Mark(sectorIndex);
+
+        const Sector& sector = map.sectors[sectorIndex];
+        for (int i = sector.firstWall; i < sector.firstWall + sector.numWalls; ++i)
+        {
+            const Wall& sourceWall = map.walls[i];
+            if (sourceWall.sector == -1)
+            {
+                continue;
+            }
+
+            Segment source = GetSegment(map, sourceWall);
+            for (int portalIndex : exploredPortals)
+            {
+                explored[portalIndex] = glm::vec2(1.0f, 0.0f);
+            }
+            exploredPortals.clear();
+
+            explored[i] = glm::vec2(0.0f, 1.0f);
+            exploredPortals.push_back(i);
+            stack.clear();
+            stack.push_back({ i, 0.0f, 1.0f });
+
+            while (!stack.empty())
+            {
+                Window entry = stack.back();
+                stack.pop_back();
+
+                const Wall& portal = map.walls[entry.portal];
+                Segment window = GetSubSegment(GetSegment(map, portal), entry.start, entry.end);
+                Mark(portal.sector);
+
+                const Sector& next = map.sectors[portal.sector];
+                for (int j = next.firstWall; j < next.firstWall + next.numWalls; ++j)
+                {
+                    const Wall& wall = map.walls[j];
+                    if (wall.sector == -1 || (wall.v[0] == portal.v[1] && wall.v[1] == portal.v[0]))
+                    {
+                        continue;
+                    }
+
+                    Segment segment = GetSegment(map, wall);
+                    float start = 0.0f;
+                    float end = 1.0f;
+                    if (!ClipBeyond(source, segment, start, end) || !ClipBeyond(window, segment, start, end))
+                    {
+                        continue;
+                    }
+                    if (entry.portal != i && !ClipAntiPenumbra(source, window, segment, start, end))
+                    {
+                        continue;
+                    }
+
+                    glm::vec2& range = explored[j];
+                    if (range.x <= start + kStabEpsilon && end <= range.y + kStabEpsilon)
+                    {
+                        continue;
+                    }
+                    if (range.x > range.y)
+                    {
+                        exploredPortals.push_back(j);
+                    }
+                    range = glm::vec2(std::min(range.x, start), std::max(range.y, end));
+                    stack.push_back({ j, range.x, range.y });
+                }
+            }
+        }
+
+        for (int portalIndex : exploredPortals)
+        {
+            explored[portalIndex] = glm::vec2(1.0f, 0.0f);
+        }
+        exploredPortals.clear();
+
+        for (int sector : visible)
+        {
+            bits[sector >> 3] = 0;
+        }
+        std::sort(visible.begin(), visible.end());
+    }
+
+    // Appends zero bytes from the given byte up to the end byte, as a zero followed by the run length per 255 bytes.
+    void AddZeroRuns(size_t byte, size_t endByte, std::vector<uint8_t>& data)
+    {
+        while (byte < endByte)
+        {
+            size_t run = std::min<size_t>(endByte - byte, 255);
+            data.push_back(0);
+            data.push_back((uint8_t)run);
+            byte += run;
+        }
+    }
+
+    // Compresses the bitset of numBytes bytes with the given sorted sectors set, storing runs of zero bytes as a zero
+    // followed by the run length. Works from the set sectors, without going through the bytes between them.
+    void Compress(const std::vector<int>& sectors, size_t numBytes, std::vector<uint8_t>& data)
+    {
+        size_t byte = 0;
+        for (size_t i = 0; i < sectors.size();)
+        {
+            size_t sectorByte = (size_t)(sectors[i] >> 3);
+            uint8_t value = 0;
+            for (; i < sectors.size() && (size_t)(sectors[i] >> 3) == sectorByte; ++i)
+            {
+                value |= 1 << (sectors[i] & 7);
+            }
+
+            AddZeroRuns(byte, sectorByte, data);
+            data.push_back(value);
+            byte = sectorByte + 1;
+        }
+        AddZeroRuns(byte, numBytes, data);
+    }
+
+    // Returns true if the compressed set from begin to end decompresses to exactly numBytes bytes, with every zero
+    // followed by its run length.
+    bool IsValidSet(const std::vector<uint8_t>& data, uint32_t begin, uint32_t end, size_t numBytes)
+    {
+        size_t byte = 0;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            if (data[i] != 0)
+            {
+                byte++;
+            }
+            else if (i + 1 < end && data[i + 1] != 0)
+            {
+                byte += data[++i];
+            }
+            else
+            {
+                return false;
+            }
+
+            if (byte > numBytes)
+            {
+                return false;
+            }
+        }
+        return byte == numBytes;
+    }
+}
+
+SectorPvs::SectorPvs()
+    : numSectors(0)
+    , mapChecksum(0)
+{
+}
+
+void SectorPvs::Build(const Map& map, JobSystem* jobs)
+{
+    numSectors = (int)map.sectors.size();
+    mapChecksum = 0;
+    size_t numBytes = (numSectors + 7) / 8;
+
+    // Every sector is compressed into its own buffer by whichever thread compiled it, then concatenated in order.
+    std::vector<std::vector<uint8_t>> compressed(numSectors);
+
+    auto CompileSectors = [&](int begin, int end) {
+        std::vector<uint8_t> bits(numBytes);
+        std::vector<glm::vec2> explored(map.walls.size(), glm::vec2(1.0f, 0.0f));
+        std::vector<int> exploredPortals;
+        std::vector<Window> stack;
+        std::vector<int> visible;
+
+        for (int sectorIndex = begin; sectorIndex < end; ++sectorIndex)
+        {
+            CompileSector(map, sectorIndex, bits, explored, exploredPortals, stack, visible);
+            Compress(visible, numBytes, compressed[sectorIndex]);
+        }
+    };
+
+    if (jobs)
+    {
+        // The scratch buffers are as large as the map, so each job compiles a run of sectors with them, leaving a
+        // few runs per thread to balance the uneven cost of sectors.
+        jobs->ParallelFor(numSectors, std::max(1, numSectors / (jobs->GetNumThreads() * kRunsPerThread)), CompileSectors);
+    }
+    else
+    {
+        CompileSectors(0, numSectors);
+    }
+
+    offsets.assign(numSectors + 1, 0);
+    data.clear();
+    for (int i = 0; i < numSectors; ++i)
+    {
+        offsets[i] = (uint32_t)data.size();
+        data.insert(data.end(), compressed[i].begin(), compressed[i].end());
+    }
+    offsets[numSectors] = (uint32_t)data.size();
+}
+
+void SectorPvs::Decompress(int sectorIndex, uint8_t* bits) const
+{
+    uint8_t* out = bits;
+    for (uint32_t i = offsets[sectorIndex]; i < offsets[sectorIndex + 1]; ++i)
+    {
+        if (data[i] != 0)
+        {
+            *out++ = data[i];
+        }
+        else
+        {
+            uint8_t run = data[++i];
+            memset(out, 0, run);
+            out += run;
+        }
+    }
+}
+
+int SectorPvs::GetNumVisible(int sectorIndex) const
+{
+    int count = 0;
+    for (uint32_t i = offsets[sectorIndex]; i < offsets[sectorIndex + 1]; ++i)
+    {
+        if (data[i] == 0)
+        {
+            ++i;
+        }
+        else
+        {
+            count += std::popcount(data[i]);
+        }
+    }
+    return count;
+}
+
+bool SectorPvs::Save(const char* path) const
+{
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    uint32_t header[3] = { kPvsMagic, (uint32_t)numSectors, (uint32_t)data.size() };
+    bool written = fwrite(header, sizeof(header), 1, file) == 1
+        && fwrite(&mapChecksum, sizeof(mapChecksum), 1, file) == 1
+        && fwrite(offsets.data(), sizeof(uint32_t), offsets.size(), file) == offsets.size()
+        && fwrite(data.data(), 1, data.size(), file) == data.size();
+
+    fclose(file);
+    return written;
+}
+
+bool SectorPvs::Load(const char* path, uint64_t mapChecksum)
+{
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        return false;
+    }
+
+    // Sets compiled for another version of the map would hide sectors that are visible now.
+    uint32_t header[3];
+    bool read = fread(header, sizeof(header), 1, file) == 1 && header[0] == kPvsMagic
+        && fread(&this->mapChecksum, sizeof(this->mapChecksum), 1, file) == 1 && this->mapChecksum == mapChecksum;
+    if (read)
+    {
+        numSectors = (int)header[1];
+        offsets.resize(numSectors + 1);
+        data.resize(header[2]);
+        read = fread(offsets.data(), sizeof(uint32_t), offsets.size(), file) == offsets.size()
+            && fread(data.data(), 1, data.size(), file) == data.size();
+    }
+
+    fclose(file);
+
+    // Every set has to lie within the data and decompress to exactly one bit per sector, so a damaged file cannot
+    // make decompressing read or write past either.
+    read = read && offsets[numSectors] == data.size();
+    for (int i = 0; read && i < numSectors; ++i)
+    {
+        read = offsets[i] <= offsets[i + 1] && offsets[i + 1] <= data.size() && IsValidSet(data, offsets[i], offsets[i + 1], (numSectors + 7) / 8);
+    }
+
+    if (!read)
+    {
+        *this = SectorPvs();
+    }
+    return read;
+}
+
+std::string SectorPvs::GetPath(const char* mapPath)
+{
+    return std::string(mapPath) + ".pvs";
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Map.h"
+#include "Jobs/JobSystem.h"
+
+struct SectorPvs
+{
+    // The number of sectors the sets were compiled for.
+    int numSectors;
+
+    // The checksum of the binary map file the sets were compiled for, as stored in its header, or 0 if unknown.
+    uint64_t mapChecksum;
+
+    // The run-length compressed set of each sector, stored from offsets[i] to offsets[i + 1] in data.
+    std::vector<uint32_t> offsets;
+    std::vector<uint8_t> data;
+
+    // Creates an empty set that marks nothing visible.
+    SectorPvs();
+
+    // Compiles, for every sector, the sectors potentially visible from anywhere inside it. Sectors are compiled in
+    // parallel over the given jobs if there are any. The map checksum is left 0 for the caller to fill in.
+    void Build(const Map& map, JobSystem* jobs = nullptr);
+
+    // Decompresses the set of the given sector into one bit per sector, (numSectors + 7) / 8 bytes.
+    void Decompress(int sectorIndex, uint8_t* bits) const;
+
+    // Returns the number of sectors potentially visible from the given sector.
+    int GetNumVisible(int sectorIndex) const;
+
+    // Writes the compiled sets to the given file. Returns false if the file could not be written.
+    bool Save(const char* path) const;
+
+    // Reads compiled sets from the given file. Returns false if the file could not be read, is not a PVS file, or
+    // was compiled for a map file with another checksum.
+    bool Load(const char* path, uint64_t mapChecksum);
+
+    // Returns the path the compiled sets of the map at the given path are stored at.
+    static std::string GetPath(const char* mapPath);
+};
@@ -0,0 +1,132 @@
+#include "SectorTrace.h"
+#include <algorithm>
+#include <cfloat>
+
+namespace
+{
+    // Crossings closer than this to the entry distance belong to the portal the trace just came through.
+    constexpr float kCrossingEpsilon = 1e-6f;
+
+    float Cross(const glm::vec2& a, const glm::vec2& b)
+    {
+        return a.x * b.y - a.y * b.x;
+    }
+}
+
+bool TraceRay(const Map& map, int startSector, const Ray& ray, float maxDistance, TraceResult& result)
+{
+    result.surface = TraceSurface::None;
+    result.point = ray.GetPointAtDistance(maxDistance);
+    result.distance = maxDistance;
+    result.wall = -1;
+    result.sector = startSector;
+    result.numWallsTested = 0;
+    result.numPortalsCrossed = 0;
+
+    if (startSector < 0 || startSector >= (int)map.sectors.size())
+    {
+        return false;
+    }
+
+    // Walls are crossed in map space, where world (x, y, z) is (x, -z) and heights are y.
+    glm::vec2 origin(ray.origin.x, -ray.origin.z);
+    glm::vec2 direction(ray.direction.x, -ray.direction.z);
+
+    int sectorIndex = startSector;
+    float entryDistance = 0.0f;
+
+    // Every step crosses one portal, so the walk ends after at most one step per wall.
+    for (int step = 0; step <= (int)map.walls.size(); ++step)
+    {
+        const Sector& sector = map.sectors[sectorIndex];
+
+        // The ray leaves the sector through the nearest wall it crosses from the inside after entering it, which
+        // also holds for concave sectors.
+        float exitDistance = FLT_MAX;
+        int exitWall = -1;
+        for (int i = sector.firstWall; i < sector.firstWall + sector.numWalls; ++i)
+        {
+            const Wall& wall = map.walls[i];
+            glm::vec2 a = map.wallVertices[wall.v[0]];
+            glm::vec2 edge = map.wallVertices[wall.v[1]] - a;
+            glm::vec2 normal(edge.y, -edge.x);
+            result.numWallsTested++;
+
+            float facing = glm::dot(normal, direction);
+            if (facing <= 0.0f)
+            {
+                continue;
+            }
+
+            float denominator = Cross(direction, edge);
+            glm::vec2 toWall = a - origin;
+            float distance = Cross(toWall, edge) / denominator;
+            float along = Cross(toWall, direction) / denominator;
+
+            if (distance > entryDistance - kCrossingEpsilon && distance < exitDistance && along >= 0.0f && along <= 1.0f)
+            {
+                exitDistance = distance;
+                exitWall = i;
+            }
+        }
+
+        // The floor and ceiling are hit first if the ray reaches their height before leaving the sector.
+        float endDistance = std::min(exitDistance, maxDistance);
+        if (ray.direction.y != 0.0f)
+        {
+            float height = ray.direction.y < 0.0f ? sector.floorHeight : sector.ceilingHeight;
+            float distance = (height - ray.origin.y) / ray.direction.y;
+            if (distance >= entryDistance && distance < endDistance)
+            {
+                result.surface = ray.direction.y < 0.0f ? TraceSurface::Floor : TraceSurface::Ceiling;
+                result.distance = std::max(distance, 0.0f);
+                result.point = ray.GetPointAtDistance(result.distance);
+                result.sector = sectorIndex;
+                return true;
+            }
+        }
+
+        if (exitWall == -1 || exitDistance >= maxDistance)
+        {
+            result.sector = sectorIndex;
+            return false;
+        }
+
+        const Wall& wall = map.walls[exitWall];
+        glm::vec3 point = ray.GetPointAtDistance(exitDistance);
+
+        bool blocked = wall.sector == -1;
+        if (!blocked)
+        {
+            // Portals only pass through the opening shared by both sectors; the step and lintel are solid.
+            const Sector& next = map.sectors[wall.sector];
+            float bottom = std::max(sector.floorHeight, next.floorHeight);
+            float top = std::min(sector.ceilingHeight, next.ceilingHeight);
+            blocked = point.y < bottom || point.y > top;
+        }
+
+        if (blocked)
+        {
+            result.surface = TraceSurface::Wall;
+            result.distance = exitDistance;
+            result.point = point;
+            result.wall = exitWall;
+            result.sector = sectorIndex;
+            return true;
+        }
+
+        sectorIndex = wall.sector;
+        entryDistance = exitDistance;
+        result.numPortalsCrossed++;
+    }
+
+    result.sector = sectorIndex;
+    return false;
+}
+
+bool LineOfSight(const Map& map, int startSector, const Line& line)
+{
+    // With the unnormalized direction the end of the line is at distance one.
+    TraceResult result;
+    return !TraceRay(map, startSector, Ray(line.v1, line.v2 - line.v1), 1.0f, result);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "Map.h"
+#include "Math/Line.h"
+#include "Math/Ray.h"
+
+// The kind of surface a trace stopped at.
+enum class TraceSurface : uint8_t
+{
+    None,
+    Wall,
+    Floor,
+    Ceiling
+};
+
+struct TraceResult
+{
+    // The surface that was hit, or None if the trace reached its end.
+    TraceSurface surface;
+
+    // The point where the trace stopped.
+    glm::vec3 point;
+
+    // The distance along the ray, in units of its direction, where the trace stopped.
+    float distance;
+
+    // The index of the wall that was hit, or -1 for floors, ceilings and misses.
+    int wall;
+
+    // The sector the trace stopped in.
+    int sector;
+
+    // The number of walls whose crossing was tested.
+    int numWallsTested;
+
+    // The number of portals the trace passed through.
+    int numPortalsCrossed;
+};
+
+// Traces the ray from its origin in startSector through the portals it crosses until it hits a solid wall, a floor,
+// a ceiling, or the step or lintel of a portal. Only the walls of the sectors the ray passes through are tested.
+// Returns true if something was hit before maxDistance.
+bool TraceRay(const Map& map, int startSector, const Ray& ray, float maxDistance, TraceResult& result);
+
+// Returns true if nothing blocks the line from its start in startSector to its end.
+bool LineOfSight(const Map& map, int startSector, const Line& line);
@@ -0,0 +1,384 @@
+#include "SectorVisibility.h"
+
+#include "Debug/Profiler.h"
+
+namespace
+{
+    // Edge planes of portals closer to the eye than this are made to touch a sphere of this radius around it, since
+    // the planes through the eye itself degenerate when standing inside the portal.
+    constexpr float kNearPortalDistance = 0.2f;
+
+    // A portal is passed again when another path sees through more of it. The window seen so far is snapped outwards
+    // to this many cells along each side, and the portal is only passed again when the window grows by a cell, which
+    // bounds the passes and keeps loops of portals from being followed forever.
+    constexpr int kPortalWindowCells = 32;
+
+    // A portal quad gains at most one vertex for each plane it is clipped against.
+    constexpr int kMaxPortalVertices = 4 + kMaxPortalPlanes;
+
+    bool TestBit(const std::vector<uint64_t>& bits, int index)
+    {
+        return (bits[index >> 6] >> (index & 63)) & 1;
+    }
+
+    void SetBit(std::vector<uint64_t>& bits, int index)
+    {
+        bits[index >> 6] |= uint64_t(1) << (index & 63);
+    }
+
+    void ClearBit(std::vector<uint64_t>& bits, int index)
+    {
+        bits[index >> 6] &= ~(uint64_t(1) << (index & 63));
+    }
+
+    // Clips the convex polygon against the plane, keeping the part in front of it.
+    int ClipPolygon(const glm::vec3* vertices, int numVertices, const Plane& plane, glm::vec3* result)
+    {
+        int numResult = 0;
+
+        for (int i = 0; i < numVertices; ++i)
+        {
+            const glm::vec3& a = vertices[i];
+            const glm::vec3& b = vertices[(i + 1) % numVertices];
+            float da = plane.GetClosestDistanceToPoint(a);
+            float db = plane.GetClosestDistanceToPoint(b);
+
+            if (da >= 0.0f)
+            {
+                result[numResult++] = a;
+            }
+
+            if ((da >= 0.0f) != (db >= 0.0f))
+            {
+                result[numResult++] = a + (b - a) * (da / (da - db));
+            }
+        }
+
+        return numResult;
+    }
+
+    // Finds the plane through the edge from a to b that touches the sphere around the eye and has the sphere behind
+    // it and the portal centroid in front. Everything seen through the edge from anywhere in the sphere is in front
+    // of it. Returns false if the sphere reaches the edge's line, where no such plane exists.
+    bool GetTangentPlane(const glm::vec3& a, const glm::vec3& b, const glm::vec3& eye, float eyeRadius, const glm::vec3& centroid, Plane& plane)
+    {
+        glm::vec3 edge = b - a;
+        float edgeLength = glm::length(edge);
+        if (edgeLength < 1e-5f)
+        {
+            return false;
+        }
+        edge /= edgeLength;
+
+        // Work in the plane perpendicular to the edge, where the eye is at distance lineDistance from it.
+        glm::vec3 toEye = eye - a;
+        toEye -= edge * glm::dot(toEye, edge);
+        float lineDistance = glm::length(toEye);
+        if (lineDistance <= eyeRadius)
+        {
+            return false;
+        }
+
+        glm::vec3 axis0 = toEye / lineDistance;
+        glm::vec3 axis1 = glm::cross(edge, axis0);
+        float along = -eyeRadius / lineDistance;
+        float across = glm::sqrt(1.0f - along * along);
+
+        glm::vec3 normal = axis0 * along + axis1 * across;
+        if (glm::dot(normal, centroid - a) < 0.0f)
+        {
+            normal = axis0 * along - axis1 * across;
+        }
+        if (glm::dot(normal, centroid - a) <= 0.0f)
+        {
+            return false;
+        }
+
+        plane = Plane(normal, -glm::dot(normal, a));
+        return true;
+    }
+
+    // Returns true if the two walls are the two sides of the same portal.
+    bool IsOtherSide(const Map& map, const Wall& wall, const Wall& other)
+    {
+        return map.wallVertices[wall.v[0]] == map.wallVertices[other.v[1]] && map.wallVertices[wall.v[1]] == map.wallVertices[other.v[0]];
+    }
+}
+
+PortalFrustum::PortalFrustum()
+    : numPlanes(0)
+{
+}
+
+PortalFrustum::PortalFrustum(const Frustum& frustum)
+    : numPlanes(0)
+{
+    for (int i = 0; i < 6; ++i)
+    {
+        // Skip planes that were never extracted.
+        if (frustum.planes[i].normal != glm::vec3(0.0f))
+        {
+            planes[numPlanes++] = frustum.planes[i];
+        }
+    }
+}
+
+SectorVisibility::SectorVisibility()
+    : numPortalsTested(0)
+    , numPortalsSkippedByPvs(0)
+    , pvs(nullptr)
+    , pvsSector(-1)
+{
+}
+
+void SectorVisibility::SetPvs(const SectorPvs* pvs)
+{
+    this->pvs = pvs;
+    pvsSector = -1;
+}
+
+void SectorVisibility::Compute(const Map& map, int startSector, const glm::vec3& eye, const Frustum& frustum, float eyeRadius)
+{
+    PROFILE_ZONE("Sector visibility");
+
+    Reset(map);
+
+    if (startSector < 0)
+    {
+        return;
+    }
+
+    // The set of the start sector is only decompressed again when the eye moves to another sector.
+    bool usePvs = pvs && pvs->numSectors == (int)map.sectors.size();
+    if (usePvs && pvsSector != startSector)
+    {
+        pvsBits.resize((pvs->numSectors + 7) / 8);
+        pvs->Decompress(startSector, pvsBits.data());
+        pvsSector = startSector;
+    }
+
+    PortalFrustum root(frustum);
+    stack.push_back({ startSector, -1, -1, 0, root });
+    SetBit(visibleBits, startSector);
+    visibleSectors.push_back(startSector);
+
+    glm::vec3 polygon[2][kMaxPortalVertices];
+
+    while (!stack.empty())
+    {
+        Entry entry = stack.back();
+        stack.pop_back();
+
+        // A later pass through the same portal covers a grown window, so this one has nothing left to find.
+        if (entry.portal >= 0 && portalWindows[entry.portal].passes != entry.pass)
+        {
+            continue;
+        }
+
+        const Sector& sector = map.sectors[entry.sector];
+
+        for (int i = 0; i < sector.numWalls; ++i)
+        {
+            int wallIndex = sector.firstWall + i;
+            const Wall& wall = map.walls[wallIndex];
+
+            // A line that passed the portal does not cross its plane again, so the traversal never turns back through
+            // the other side of it. Sectors need not be convex, so other portals into the sector it came from, or
+            // into the start sector, are followed like any other.
+            if (wall.sector == -1 || (wall.sector == entry.fromSector && IsOtherSide(map, wall, map.walls[entry.portal])))
+            {
+                continue;
+            }
+
+            if (usePvs && !(pvsBits[wall.sector >> 3] & (1 << (wall.sector & 7))))
+            {
+                numPortalsSkippedByPvs++;
+                continue;
+            }
+
+            numPortalsTested++;
+
+            const Sector& otherSector = map.sectors[wall.sector];
+            float floorHeight = glm::max(sector.floorHeight, otherSector.floorHeight);
+            float ceilingHeight = glm::min(sector.ceilingHeight, otherSector.ceilingHeight);
+
+            if (ceilingHeight <= floorHeight)
+            {
+                continue;
+            }
+
+            glm::vec3 bottom[2];
+            map.GetWallPositions(wall, floorHeight, bottom);
+
+            // Portals are only seen from the inside of the sector they belong to.
+            glm::vec3 normal = map.GetWallNormal(wall);
+            float eyeDistance = -glm::dot(normal, eye - bottom[0]);
+
+            if (eyeDistance <= -eyeRadius)
+            {
+                continue;
+            }
+
+            glm::vec3 along = bottom[1] - bottom[0];
+            glm::vec3 up = glm::vec3(0.0f, ceilingHeight - floorHeight, 0.0f);
+
+            polygon[0][0] = bottom[0] + up;
+            polygon[0][1] = bottom[1] + up;
+            polygon[0][2] = bottom[1];
+            polygon[0][3] = bottom[0];
+            int numVertices = 4;
+            int current = 0;
+
+            for (int j = 0; j < entry.frustum.numPlanes && numVertices >= 3; ++j)
+            {
+                numVertices = ClipPolygon(polygon[current], numVertices, entry.frustum.planes[j], polygon[current ^ 1]);
+                current ^= 1;
+            }
+
+            if (numVertices < 3)
+            {
+                continue;
+            }
+
+            // Merge the bounds of the visible part of the portal into its window.
+            const glm::vec3* clipped = polygon[current];
+            float alongScale = (float)kPortalWindowCells / glm::dot(along, along);
+            float upScale = (float)kPortalWindowCells / up.y;
+            glm::vec2 min = glm::vec2((float)kPortalWindowCells);
+            glm::vec2 max = glm::vec2(0.0f);
+
+            for (int j = 0; j < numVertices; ++j)
+            {
+                glm::vec2 cell = glm::vec2(glm::dot(clipped[j] - bottom[0], along) * alongScale, (clipped[j].y - floorHeight) * upScale);
+                min = glm::min(min, cell);
+                max = glm::max(max, cell);
+            }
+
+            int x1 = glm::clamp((int)glm::floor(min.x), 0, kPortalWindowCells - 1);
+            int y1 = glm::clamp((int)glm::floor(min.y), 0, kPortalWindowCells - 1);
+            int x2 = glm::clamp((int)glm::ceil(max.x), x1 + 1, kPortalWindowCells);
+            int y2 = glm::clamp((int)glm::ceil(max.y), y1 + 1, kPortalWindowCells);
+
+            PortalWindow& window = portalWindows[wallIndex];
+            if (window.x1 >= window.x2)
+            {
+                traversedPortals.push_back(wallIndex);
+            }
+            else if (x1 >= window.x1 && y1 >= window.y1 && x2 <= window.x2 && y2 <= window.y2)
+            {
+                continue;
+            }
+            else
+            {
+                x1 = glm::min(x1, (int)window.x1);
+                y1 = glm::min(y1, (int)window.y1);
+                x2 = glm::max(x2, (int)window.x2);
+                y2 = glm::max(y2, (int)window.y2);
+            }
+
+            window.x1 = (uint8_t)x1;
+            window.y1 = (uint8_t)y1;
+            window.x2 = (uint8_t)x2;
+            window.y2 = (uint8_t)y2;
+            window.passes++;
+
+            if (!TestBit(visibleBits, wall.sector))
+            {
+                SetBit(visibleBits, wall.sector);
+                visibleSectors.push_back(wall.sector);
+            }
+
+            // Narrow the frustum to the whole window, which covers every path through the portal found so far.
+            glm::vec3 corners[4];
+            glm::vec3 cellAlong = along / (float)kPortalWindowCells;
+            glm::vec3 cellUp = up / (float)kPortalWindowCells;
+            corners[0] = bottom[0] + cellAlong * (float)x1 + cellUp * (float)y2;
+            corners[1] = bottom[0] + cellAlong * (float)x2 + cellUp * (float)y2;
+            corners[2] = bottom[0] + cellAlong * (float)x2 + cellUp * (float)y1;
+            corners[3] = bottom[0] + cellAlong * (float)x1 + cellUp * (float)y1;
+            glm::vec3 centroid = (corners[0] + corners[2]) * 0.5f;
+
+            // Nothing between the eye and the portal belongs to the other sector.
+            PortalFrustum narrowed;
+            narrowed.planes[narrowed.numPlanes++] = Plane(normal, -glm::dot(normal, bottom[0]));
+
+            float radius = eyeDistance < kNearPortalDistance + eyeRadius ? kNearPortalDistance + eyeRadius : eyeRadius;
+
+            for (int j = 0; j < 4; ++j)
+            {
+                const glm::vec3& a = corners[j];
+                const glm::vec3& b = corners[(j + 1) % 4];
+
+                Plane plane;
+                if (radius > 0.0f)
+                {
+                    if (!GetTangentPlane(a, b, eye, radius, centroid, plane))
+                    {
+                        continue;
+                    }
+                }
+                else
+                {
+                    glm::vec3 planeNormal = glm::cross(a - eye, b - eye);
+                    if (glm::dot(planeNormal, planeNormal) < 1e-10f)
+                    {
+                        continue;
+                    }
+
+                    plane = Plane(planeNormal, -glm::dot(planeNormal, eye));
+                    if (plane.GetClosestDistanceToPoint(centroid) < 0.0f)
+                    {
+                        plane = Plane(-planeNormal, glm::dot(planeNormal, eye));
+                    }
+                }
+
+                narrowed.planes[narrowed.numPlanes++] = plane;
+            }
+
+            // Edge planes are dropped where the eye reaches the edges; the camera frustum still bounds what is seen.
+            if (narrowed.numPlanes < 5)
+            {
+                for (int j = 0; j < root.numPlanes; ++j)
+                {
+                    narrowed.planes[narrowed.numPlanes++] = root.planes[j];
+                }
+            }
+
+            stack.push_back({ wall.sector, entry.sector, wallIndex, window.passes, narrowed });
+        }
+    }
+}
+
+bool SectorVisibility::IsVisible(int sectorIndex) const
+{
+    return sectorIndex >= 0 && sectorIndex < (int)visibleBits.size() * 64 && TestBit(visibleBits, sectorIndex);
+}
+
+void SectorVisibility::Reset(const Map& map)
+{
+    size_t numSectorWords = (map.sectors.size() + 63) / 64;
+
+    if (visibleBits.size() != numSectorWords || portalWindows.size() != map.walls.size())
+    {
+        visibleBits.assign(numSectorWords, 0);
+        portalWindows.assign(map.walls.size(), PortalWindow());
+    }
+    else
+    {
+        // Only clear what the last traversal touched, so the cost does not depend on the map size.
+        for (int sectorIndex : visibleSectors)
+        {
+            ClearBit(visibleBits, sectorIndex);
+        }
+        for (int wallIndex : traversedPortals)
+        {
+            portalWindows[wallIndex] = PortalWindow();
+        }
+    }
+
+    visibleSectors.clear();
+    traversedPortals.clear();
+    stack.clear();
+    numPortalsTested = 0;
+    numPortalsSkippedByPvs = 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Map.h"
+#include "Math/Frustum.h"
+#include "Math/Plane.h"
+#include "SectorPvs.h"
+
+// The maximum number of planes that bound a frustum narrowed by a portal.
+constexpr int kMaxPortalPlanes = 12;
+
+struct PortalFrustum
+{
+    // The planes of the frustum, pointing inwards.
+    Plane planes[kMaxPortalPlanes];
+
+    // The number of used planes.
+    int numPlanes;
+
+    // Creates an empty frustum without planes.
+    PortalFrustum();
+
+    // Creates and initializes a new portal frustum from the planes of the given camera frustum.
+    PortalFrustum(const Frustum& frustum);
+};
+
+struct SectorVisibility
+{
+    // The indices of the sectors found visible by the last traversal, in the order they were reached.
+    std::vector<int> visibleSectors;
+
+    // The number of portals tested by the last traversal.
+    int numPortalsTested;
+
+    // The number of portals the last traversal skipped because the PVS ruled out the sector behind them.
+    int numPortalsSkippedByPvs;
+
+    // Creates a new empty sector visibility.
+    SectorVisibility();
+
+    // Bounds later traversals by the given potentially visible sets, or removes the bound when null.
+    void SetPvs(const SectorPvs* pvs);
+
+    // Finds all sectors visible from the given eye through the portals of the start sector. A positive eye radius
+    // finds every sector visible from any point within that distance of the eye, given a frustum that covers them.
+    void Compute(const Map& map, int startSector, const glm::vec3& eye, const Frustum& frustum, float eyeRadius = 0.0f);
+
+    // Returns true if the given sector was found visible by the last traversal.
+    bool IsVisible(int sectorIndex) const;
+
+private:
+    struct Entry
+    {
+        int sector;
+        int fromSector;
+
+        // The wall passed to reach the sector and its pass count when it was passed, or -1 for the start sector.
+        int portal;
+        int pass;
+
+        PortalFrustum frustum;
+    };
+
+    // The part of a portal seen so far, in grid cells along the wall and up from the bottom of the opening.
+    struct PortalWindow
+    {
+        // The first and one past the last cell, or an empty window when x1 >= x2.
+        uint8_t x1;
+        uint8_t y1;
+        uint8_t x2;
+        uint8_t y2;
+
+        // The number of times the window grew.
+        uint8_t passes;
+    };
+
+    // Clears the bits and windows set by the last traversal and sizes them for the given map.
+    void Reset(const Map& map);
+
+    std::vector<Entry> stack;
+    std::vector<int> traversedPortals;
+    std::vector<uint64_t> visibleBits;
+    std::vector<PortalWindow> portalWindows;
+
+    // The potentially visible sets and the decompressed set of pvsSector.
+    const SectorPvs* pvs;
+    int pvsSector;
+    std::vector<uint8_t> pvsBits;
+};
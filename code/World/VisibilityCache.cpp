@@ -0,0 +1,125 @@
+#include "VisibilityCache.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+    // The clip distances of the widened projection. Both planes are dropped, so they only have to be valid.
+    constexpr float kWidenedNear = 0.01f;
+    constexpr float kWidenedFar = 1.0f;
+
+    // Wider frustums would not have a projection, so the side planes are dropped as well and only the portals bound
+    // the traversal.
+    constexpr float kMaxHalfAngle = 1.55f;
+
+    // Returns the forward, right and up axes of a camera looking along forward, as the view matrix builds them.
+    void GetCameraBasis(const glm::vec3& forward, glm::vec3 basis[3])
+    {
+        basis[0] = glm::normalize(forward);
+        basis[1] = glm::normalize(glm::cross(basis[0], glm::vec3(0.0f, 1.0f, 0.0f)));
+        basis[2] = glm::cross(basis[1], basis[0]);
+    }
+}
+
+VisibilityCache::VisibilityCache(float angleMargin, float eyeRadius)
+    : numHits(0)
+    , numMisses(0)
+    , angleMargin(angleMargin)
+    , eyeRadius(eyeRadius)
+    , sector(-1)
+    , eye(0.0f)
+    , fovY(0.0f)
+    , aspect(0.0f)
+{
+}
+
+void VisibilityCache::SetPvs(const SectorPvs* pvs)
+{
+    visibility.SetPvs(pvs);
+    Invalidate();
+}
+
+const std::vector<int>& VisibilityCache::Update(const Map& map, int sector, const glm::vec3& eye, const glm::vec3& forward, float fovY, float aspect)
+{
+    if (IsValid(sector, eye, forward, fovY, aspect))
+    {
+        numHits++;
+        return visibility.visibleSectors;
+    }
+
+    numMisses++;
+    this->sector = sector;
+    this->eye = eye;
+    this->fovY = fovY;
+    this->aspect = aspect;
+    GetCameraBasis(forward, basis);
+
+    // Widen both half angles so that the corner rays of the frustum, and so every ray inside it, stay at least the
+    // margin away from the side planes. A camera rotated by less than the margin then looks inside the frustum.
+    // The field of view is in radians, as glm::perspective takes it, but may lie outside the range of a real half
+    // angle: the game camera's 70 has a half angle of 35 radians. The projection only sees its tangent, which
+    // repeats every pi, so the half angle is folded back into (-pi/2, pi/2) to match what is drawn (about 0.44
+    // radians for 70).
+    float halfY = glm::atan(glm::tan(fovY * 0.5f));
+    float tanY = glm::tan(halfY);
+    float tanX = aspect * tanY;
+    float halfX = glm::atan(tanX);
+    float cornerLength = glm::sqrt(1.0f + tanX * tanX + tanY * tanY);
+    float sinMargin = glm::sin(angleMargin);
+    float widenedY = halfY + glm::asin(glm::min(1.0f, sinMargin * glm::cos(halfY) * cornerLength));
+    float widenedX = halfX + glm::asin(glm::min(1.0f, sinMargin * glm::cos(halfX) * cornerLength));
+    bool unbounded = widenedY >= kMaxHalfAngle || widenedX >= kMaxHalfAngle;
+    widenedY = glm::min(widenedY, kMaxHalfAngle);
+    widenedX = glm::min(widenedX, kMaxHalfAngle);
+
+    glm::mat4 projection = glm::perspective(2.0f * widenedY, glm::tan(widenedX) / glm::tan(widenedY), kWidenedNear, kWidenedFar);
+    glm::mat4 view = glm::lookAt(eye, eye + basis[0], glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum(projection * view);
+
+    // Then push the planes out by the eye radius so moved cameras stay inside too. The near and far planes would cut
+    // off cameras that moved or turned and are dropped.
+    for (Plane& plane : frustum.planes)
+    {
+        float length = glm::length(plane.normal);
+        plane.normal /= length;
+        plane.distance = plane.distance / length + eyeRadius;
+    }
+    for (int i = unbounded ? 0 : 4; i < 6; ++i)
+    {
+        frustum.planes[i] = Plane();
+    }
+
+    visibility.Compute(map, sector, eye, frustum, eyeRadius);
+    return visibility.visibleSectors;
+}
+
+void VisibilityCache::Invalidate()
+{
+    sector = -1;
+}
+
+float VisibilityCache::GetHitRate() const
+{
+    int numUpdates = numHits + numMisses;
+    return numUpdates > 0 ? (float)numHits / numUpdates : 0.0f;
+}
+
+bool VisibilityCache::IsValid(int sector, const glm::vec3& eye, const glm::vec3& forward, float fovY, float aspect) const
+{
+    if (sector == -1 || sector != this->sector || fovY != this->fovY || aspect != this->aspect)
+    {
+        return false;
+    }
+
+    glm::vec3 delta = eye - this->eye;
+    if (glm::dot(delta, delta) > eyeRadius * eyeRadius)
+    {
+        return false;
+    }
+
+    // The angle of the rotation between the two cameras follows from the trace of the matrix mapping one basis
+    // onto the other; it bounds how far any view direction has turned.
+    glm::vec3 current[3];
+    GetCameraBasis(forward, current);
+    float trace = glm::dot(current[0], basis[0]) + glm::dot(current[1], basis[1]) + glm::dot(current[2], basis[2]);
+    return (trace - 1.0f) * 0.5f >= glm::cos(angleMargin);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Map.h"
+#include "SectorVisibility.h"
+
+struct VisibilityCache
+{
+    // The number of updates answered from the cached set.
+    int numHits;
+
+    // The number of updates that traversed the portals again.
+    int numMisses;
+
+    // Creates a new empty cache. The cached set covers cameras rotated by up to angleMargin radians and moved by up
+    // to eyeRadius from where it was computed.
+    VisibilityCache(float angleMargin = 0.1f, float eyeRadius = 0.25f);
+
+    // Bounds traversals by the given potentially visible sets, or removes the bound when null.
+    void SetPvs(const SectorPvs* pvs);
+
+    // Returns the sectors visible from a camera in the given sector, looking along forward with the given vertical
+    // field of view and aspect. The cached set is reused while the camera stays in the same sector within the
+    // validity bounds; otherwise it is recomputed for a widened frustum around the current camera.
+    const std::vector<int>& Update(const Map& map, int sector, const glm::vec3& eye, const glm::vec3& forward, float fovY, float aspect);
+
+    // Forces the next update to traverse the portals again.
+    void Invalidate();
+
+    // Returns the fraction of updates answered from the cache.
+    float GetHitRate() const;
+
+private:
+    // Returns true if the cached set covers the given camera.
+    bool IsValid(int sector, const glm::vec3& eye, const glm::vec3& forward, float fovY, float aspect) const;
+
+    float angleMargin;
+    float eyeRadius;
+
+    SectorVisibility visibility;
+
+    // The camera the cached set was computed for.
+    int sector;
+    glm::vec3 eye;
+    glm::vec3 basis[3];
+    float fovY;
+    float aspect;
+};
@@ -0,0 +1,512 @@
+#include "WorldBvh.h"
+#include <algorithm>
+
+#include "Math/Intersection.h"
+
+namespace
+{
+    // The number of centroid bins evaluated per axis when searching for a split.
+    constexpr int kNumBins = 12;
+
+    // Leaves are never split below this many triangles.
+    constexpr int kMaxLeafTriangles = 4;
+
+    // Subtrees with at least this many triangles are built as separate jobs.
+    constexpr int kParallelBuildTriangles = 4096;
+
+    // The cost of visiting a node relative to intersecting one triangle.
+    constexpr float kTraversalCost = 1.0f;
+
+    // The deepest hierarchy a traversal stack can hold.
+    constexpr int kMaxStackDepth = 64;
+
+    struct BuildContext
+    {
+        // The bounds and centroid of every input triangle.
+        std::vector<Box> bounds;
+        std::vector<glm::vec3> centroids;
+
+        // The input triangle indices, partitioned in place as the tree is built.
+        std::vector<int> order;
+
+        // The jobs subtrees are built on, or null to build on the calling thread.
+        JobSystem* jobs;
+    };
+
+    // A subtree built as a job into its own node array. The job covers the subtree's range of context.order.
+    struct SubtreeBuild
+    {
+        BuildContext* context;
+        int depth;
+        std::vector<WorldBvhNode> nodes;
+    };
+
+    struct Bin
+    {
+        Box bounds;
+        int count = 0;
+    };
+
+    // Finds the cheapest binned SAH split of the given range. Returns false if no split beats a leaf.
+    bool FindSplit(const BuildContext& context, int first, int count, const Box& bounds, int& splitAxis, float& splitPosition)
+    {
+        Box centroidBounds;
+        for (int i = first; i < first + count; ++i)
+        {
+            centroidBounds += context.centroids[context.order[i]];
+        }
+
+        float bestCost = count * bounds.GetSurfaceArea();
+        bool found = false;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float axisMin = centroidBounds.min[axis];
+            float axisMax = centroidBounds.max[axis];
+            if (axisMax <= axisMin)
+            {
+                continue;
+            }
+
+            Bin bins[kNumBins];
+            float scale = kNumBins / (axisMax - axisMin);
+            for (int i = first; i < first + count; ++i)
+            {
+                int triangle = context.order[i];
+                int bin = std::min(kNumBins - 1, (int)((context.centroids[triangle][axis] - axisMin) * scale));
+                bins[bin].bounds += context.bounds[triangle];
+                bins[bin].count++;
+            }
+
+            // Sweep from the right to get the area and count of every right side, then from the left to evaluate.
+            float rightArea[kNumBins - 1];
+            int rightCount[kNumBins - 1];
+            Box right;
+            int numRight = 0;
+            for (int i = kNumBins - 1; i > 0; --i)
+            {
+                right += bins[i].bounds;
+                numRight += bins[i].count;
+                rightArea[i - 1] = right.isValid ? right.GetSurfaceArea() : 0.0f;
+                rightCount[i - 1] = numRight;
+            }
+
+            Box left;
+            int numLeft = 0;
+            for (int i = 0; i < kNumBins - 1; ++i)
+            {
+                left += bins[i].bounds;
+                numLeft += bins[i].count;
+                if (numLeft == 0 || rightCount[i] == 0)
+                {
+                    continue;
+                }
+
+                float cost = kTraversalCost * bounds.GetSurfaceArea() + numLeft * left.GetSurfaceArea() + rightCount[i] * rightArea[i];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    splitAxis = axis;
+                    splitPosition = axisMin + (i + 1) / scale;
+                    found = true;
+                }
+            }
+        }
+
+        return found;
+    }
+
+    int BuildNode(BuildContext& context, int first, int count, int depth, std::vector<WorldBvhNode>& nodes);
+
+    void BuildSubtree(const Job& job)
+    {
+        SubtreeBuild& build = *static_cast<SubtreeBuild*>(job.data);
+        BuildNode(*build.context, job.begin, job.end - job.begin, build.depth, build.nodes);
+    }
+
+    // Appends the subtree over the given range to nodes and returns the index of its root. Leaf triangle ranges
+    // refer to positions in context.order.
+    int BuildNode(BuildContext& context, int first, int count, int depth, std::vector<WorldBvhNode>& nodes)
+    {
+        Box bounds;
+        for (int i = first; i < first + count; ++i)
+        {
+            bounds += context.bounds[context.order[i]];
+        }
+
+        int nodeIndex = (int)nodes.size();
+        nodes.push_back({ bounds.min, first, bounds.max, count });
+
+        int splitAxis = 0;
+        float splitPosition = 0.0f;
+        // Traversal stacks hold at most one pending node per level, so the depth is capped to fit them.
+        if (count <= kMaxLeafTriangles || depth >= kMaxStackDepth - 1 || !FindSplit(context, first, count, bounds, splitAxis, splitPosition))
+        {
+            return nodeIndex;
+        }
+
+        int* begin = context.order.data() + first;
+        int* middle = std::partition(begin, begin + count, [&](int triangle)
+        {
+            return context.centroids[triangle][splitAxis] < splitPosition;
+        });
+        int numLeft = (int)(middle - begin);
+        if (numLeft == 0 || numLeft == count)
+        {
+            return nodeIndex;
+        }
+
+        nodes[nodeIndex].numTriangles = 0;
+
+        int numRight = count - numLeft;
+        if (context.jobs && numRight >= kParallelBuildTriangles)
+        {
+            // The right subtree is built into its own array and appended once both halves are done. Waiting runs
+            // other jobs, so an idle worker steals the right half while this one builds the left.
+            SubtreeBuild rightBuild = { &context, depth + 1, {} };
+            JobCounter counter;
+            context.jobs->Run({ &BuildSubtree, &rightBuild, first + numLeft, first + count, &counter });
+            BuildNode(context, first, numLeft, depth + 1, nodes);
+            context.jobs->Wait(counter);
+
+            int rightBase = (int)nodes.size();
+            for (WorldBvhNode node : rightBuild.nodes)
+            {
+                if (node.numTriangles == 0)
+                {
+                    node.rightOrFirst += rightBase;
+                }
+                nodes.push_back(node);
+            }
+            nodes[nodeIndex].rightOrFirst = rightBase;
+        }
+        else
+        {
+            BuildNode(context, first, numLeft, depth + 1, nodes);
+            int rightIndex = BuildNode(context, first + numLeft, numRight, depth + 1, nodes);
+            nodes[nodeIndex].rightOrFirst = rightIndex;
+        }
+
+        return nodeIndex;
+    }
+
+    // Returns the distance at which the ray enters the node, or a negative value if it misses it before maxDistance.
+    float IntersectNode(const WorldBvhNode& node, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance)
+    {
+        glm::vec3 t0 = (node.min - origin) * inverseDirection;
+        glm::vec3 t1 = (node.max - origin) * inverseDirection;
+        glm::vec3 tmin = glm::min(t0, t1);
+        glm::vec3 tmax = glm::max(t0, t1);
+        float entry = std::max(std::max(tmin.x, tmin.y), std::max(tmin.z, 0.0f));
+        float exit = std::min(std::min(tmax.x, tmax.y), std::min(tmax.z, maxDistance));
+        return entry <= exit ? entry : -1.0f;
+    }
+
+    // Two-sided Möller–Trumbore. Returns true and the hit if the ray hits the triangle closer than maxDistance.
+    bool IntersectTriangle(const WorldBvhTriangle& triangle, const Ray& ray, float maxDistance, float& distance, float& u, float& v)
+    {
+        glm::vec3 edge1 = triangle.v[1] - triangle.v[0];
+        glm::vec3 edge2 = triangle.v[2] - triangle.v[0];
+        glm::vec3 p = glm::cross(ray.direction, edge2);
+        float determinant = glm::dot(edge1, p);
+        if (determinant > -1e-8f && determinant < 1e-8f)
+        {
+            return false;
+        }
+
+        float inverseDeterminant = 1.0f / determinant;
+        glm::vec3 s = ray.origin - triangle.v[0];
+        u = glm::dot(s, p) * inverseDeterminant;
+        if (u < 0.0f || u > 1.0f)
+        {
+            return false;
+        }
+
+        glm::vec3 q = glm::cross(s, edge1);
+        v = glm::dot(ray.direction, q) * inverseDeterminant;
+        if (v < 0.0f || u + v > 1.0f)
+        {
+            return false;
+        }
+
+        distance = glm::dot(edge2, q) * inverseDeterminant;
+        return distance > 0.0f && distance < maxDistance;
+    }
+}
+
+void WorldBvh::Build(const SectorMesh& mesh, JobSystem* jobs)
+{
+    int numInputTriangles = (int)mesh.indices.size() / 3;
+
+    BuildContext context;
+    context.bounds.resize(numInputTriangles);
+    context.centroids.resize(numInputTriangles);
+    context.order.resize(numInputTriangles);
+    context.jobs = jobs;
+
+    for (int i = 0; i < numInputTriangles; ++i)
+    {
+        glm::vec3 v[3];
+        for (int j = 0; j < 3; ++j)
+        {
+            v[j] = mesh.vertices[mesh.indices[i * 3 + j]].position;
+        }
+        context.bounds[i] = Box(v, 3);
+        context.centroids[i] = (v[0] + v[1] + v[2]) / 3.0f;
+        context.order[i] = i;
+    }
+
+    nodes.clear();
+    nodes.reserve(std::max(1, numInputTriangles * 2 / kMaxLeafTriangles));
+    if (numInputTriangles > 0)
+    {
+        BuildNode(context, 0, numInputTriangles, 1, nodes);
+    }
+
+    // Store the triangles in leaf order so a leaf reads one contiguous run.
+    triangles.resize(numInputTriangles);
+    triangleIds.resize(numInputTriangles);
+    for (int i = 0; i < numInputTriangles; ++i)
+    {
+        int triangle = context.order[i];
+        for (int j = 0; j < 3; ++j)
+        {
+            triangles[i].v[j] = mesh.vertices[mesh.indices[triangle * 3 + j]].position;
+        }
+        triangleIds[i] = triangle;
+    }
+}
+
+bool WorldBvh::Raycast(const Ray& ray, float maxDistance, WorldBvhHit& hit) const
+{
+    if (nodes.empty())
+    {
+        return false;
+    }
+
+    glm::vec3 inverseDirection = 1.0f / ray.direction;
+    hit.triangle = -1;
+    hit.distance = maxDistance;
+
+    if (IntersectNode(nodes[0], ray.origin, inverseDirection, maxDistance) < 0.0f)
+    {
+        return false;
+    }
+
+    int stack[kMaxStackDepth];
+    int stackSize = 0;
+    int nodeIndex = 0;
+
+    while (true)
+    {
+        const WorldBvhNode& node = nodes[nodeIndex];
+        if (node.numTriangles > 0)
+        {
+            for (int i = node.rightOrFirst; i < node.rightOrFirst + node.numTriangles; ++i)
+            {
+                float distance, u, v;
+                if (IntersectTriangle(triangles[i], ray, hit.distance, distance, u, v))
+                {
+                    hit = { distance, u, v, triangleIds[i] };
+                }
+            }
+        }
+        else
+        {
+            // Visit the nearer child first so the closer hit shrinks the ray before the farther child is tested.
+            int left = nodeIndex + 1;
+            int right = node.rightOrFirst;
+            float leftEntry = IntersectNode(nodes[left], ray.origin, inverseDirection, hit.distance);
+            float rightEntry = IntersectNode(nodes[right], ray.origin, inverseDirection, hit.distance);
+
+            if (leftEntry >= 0.0f && rightEntry >= 0.0f)
+            {
+                if (rightEntry < leftEntry)
+                {
+                    std::swap(left, right);
+                }
+                stack[stackSize++] = right;
+                nodeIndex = left;
+                continue;
+            }
+            else if (leftEntry >= 0.0f)
+            {
+                nodeIndex = left;
+                continue;
+            }
+            else if (rightEntry >= 0.0f)
+            {
+                nodeIndex = right;
+                continue;
+            }
+        }
+
+        if (stackSize == 0)
+        {
+            break;
+        }
+        nodeIndex = stack[--stackSize];
+    }
+
+    return hit.triangle != -1;
+}
+
+bool WorldBvh::RaycastAny(const Ray& ray, float maxDistance) const
+{
+    if (nodes.empty())
+    {
+        return false;
+    }
+
+    glm::vec3 inverseDirection = 1.0f / ray.direction;
+
+    int stack[kMaxStackDepth];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const WorldBvhNode& node = nodes[stack[--stackSize]];
+        if (IntersectNode(node, ray.origin, inverseDirection, maxDistance) < 0.0f)
+        {
+            continue;
+        }
+
+        if (node.numTriangles > 0)
+        {
+            for (int i = node.rightOrFirst; i < node.rightOrFirst + node.numTriangles; ++i)
+            {
+                float distance, u, v;
+                if (IntersectTriangle(triangles[i], ray, maxDistance, distance, u, v))
+                {
+                    return true;
+                }
+            }
+        }
+        else
+        {
+            stack[stackSize++] = node.rightOrFirst;
+            stack[stackSize++] = int(&node - nodes.data()) + 1;
+        }
+    }
+
+    return false;
+}
+
+int WorldBvh::RaycastPacket(const RayPacket& packet, RayPacketHit& hit) const
+{
+    if (nodes.empty())
+    {
+        return 0;
+    }
+
+    // The packet's maximum distances shrink to the closest hits so far, which prunes nodes behind them.
+    RayPacket active = packet;
+
+    int stack[kMaxStackDepth];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const WorldBvhNode& node = nodes[stack[--stackSize]];
+        if (Math::Intersects(active, Box(node.min, node.max)) == 0)
+        {
+            continue;
+        }
+
+        if (node.numTriangles > 0)
+        {
+            int changed = 0;
+            for (int i = node.rightOrFirst; i < node.rightOrFirst + node.numTriangles; ++i)
+            {
+                const WorldBvhTriangle& triangle = triangles[i];
+                changed |= Math::Intersects(active, triangle.v[0], triangle.v[1], triangle.v[2], triangleIds[i], hit);
+            }
+
+            for (int i = 0; i < kRayPacketSize; ++i)
+            {
+                if (changed & (1 << i))
+                {
+                    active.maxDistance[i] = hit.distance[i];
+                }
+            }
+        }
+        else
+        {
+            stack[stackSize++] = node.rightOrFirst;
+            stack[stackSize++] = int(&node - nodes.data()) + 1;
+        }
+    }
+
+    return hit.GetHitMask();
+}
+
+void WorldBvh::QueryBox(const Box& box, std::vector<int>& result) const
+{
+    if (nodes.empty() || !box.isValid)
+    {
+        return;
+    }
+
+    int stack[kMaxStackDepth];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0)
+    {
+        const WorldBvhNode& node = nodes[stack[--stackSize]];
+        if (!Math::Intersects(Box(node.min, node.max), box))
+        {
+            continue;
+        }
+
+        if (node.numTriangles > 0)
+        {
+            for (int i = node.rightOrFirst; i < node.rightOrFirst + node.numTriangles; ++i)
+            {
+                if (Math::Intersects(Box(triangles[i].v, 3), box))
+                {
+                    result.push_back(triangleIds[i]);
+                }
+            }
+        }
+        else
+        {
+            stack[stackSize++] = node.rightOrFirst;
+            stack[stackSize++] = int(&node - nodes.data()) + 1;
+        }
+    }
+}
+
+int WorldBvh::GetDepth() const
+{
+    if (nodes.empty())
+    {
+        return 0;
+    }
+
+    int depth = 0;
+    int stack[kMaxStackDepth][2];
+    int stackSize = 0;
+    stack[stackSize][0] = 0;
+    stack[stackSize++][1] = 1;
+
+    while (stackSize > 0)
+    {
+        --stackSize;
+        int nodeIndex = stack[stackSize][0];
+        int nodeDepth = stack[stackSize][1];
+        depth = std::max(depth, nodeDepth);
+
+        if (nodes[nodeIndex].numTriangles == 0)
+        {
+            stack[stackSize][0] = nodeIndex + 1;
+            stack[stackSize++][1] = nodeDepth + 1;
+            stack[stackSize][0] = nodes[nodeIndex].rightOrFirst;
+            stack[stackSize++][1] = nodeDepth + 1;
+        }
+    }
+
+    return depth;
+}
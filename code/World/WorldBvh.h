@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Jobs/JobSystem.h"
+#include "Math/Box.h"
+#include "Math/Ray.h"
+#include "Math/RayPacket.h"
+#include "SectorMesh.h"
+
+// A flattened BVH node. Two nodes share a 64-byte cache line. Inner nodes store their left child right after
+// themselves and the index of their right child; leaves store a range of triangles.
+struct WorldBvhNode
+{
+    // The minimum extents of the node bounds.
+    glm::vec3 min;
+
+    // The index of the right child for inner nodes, or the first triangle for leaves.
+    int32_t rightOrFirst;
+
+    // The maximum extents of the node bounds.
+    glm::vec3 max;
+
+    // The number of triangles in a leaf, or zero for inner nodes.
+    int32_t numTriangles;
+};
+
+struct WorldBvhTriangle
+{
+    // The positions of the triangle corners.
+    glm::vec3 v[3];
+};
+
+struct WorldBvhHit
+{
+    // The distance along the ray to the hit.
+    float distance;
+
+    // The barycentric coordinates of the hit.
+    float u;
+    float v;
+
+    // The index of the triangle hit in the sector mesh, that is its first index divided by three.
+    int triangle;
+};
+
+struct WorldBvh
+{
+    // The nodes in depth-first order, starting with the root.
+    std::vector<WorldBvhNode> nodes;
+
+    // The triangles in leaf order.
+    std::vector<WorldBvhTriangle> triangles;
+
+    // The sector mesh triangle index of each triangle in leaf order.
+    std::vector<int> triangleIds;
+
+    // Builds the hierarchy over all triangles of the given mesh using the surface area heuristic. Subtrees above
+    // a size threshold are built as separate jobs if there are any; the tree is the same either way.
+    void Build(const SectorMesh& mesh, JobSystem* jobs = nullptr);
+
+    // Finds the closest triangle hit by the ray before maxDistance. Returns false if nothing was hit.
+    bool Raycast(const Ray& ray, float maxDistance, WorldBvhHit& hit) const;
+
+    // Returns true if the ray hits any triangle before maxDistance.
+    bool RaycastAny(const Ray& ray, float maxDistance) const;
+
+    // Finds the closest hits for a packet of rays. hit must be initialized from the packet.
+    // Returns a mask with bit i set when ray i hit a triangle.
+    int RaycastPacket(const RayPacket& packet, RayPacketHit& hit) const;
+
+    // Appends the sector mesh index of every triangle whose bounds overlap the given box.
+    void QueryBox(const Box& box, std::vector<int>& triangles) const;
+
+    // Returns the depth of the deepest leaf.
+    int GetDepth() const;
+};
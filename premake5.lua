@@ -1,3 +1,13 @@
+newoption {
+    trigger = "profile",
+    description = "Build the profiler into every configuration"
+}
+
+newoption {
+    trigger = "avx",
+    description = "Compile for CPUs with AVX, which widens the batch culling kernels to 8 lanes"
+}
+
 workspace "Tremble"
     architecture "x86_64"
     flags {
@@ -11,6 +21,15 @@ workspace "Tremble"
     targetdir ("bin/%{prj.name}")
     objdir ("bin/obj/%{prj.name}")
 
+    -- Debug builds always record profiler zones; this builds them into release builds as well.
+    filter "options:profile"
+        defines { "TREMBLE_PROFILE" }
+
+    -- Without it the batch culling kernels use 4 SSE lanes, which every x86_64 CPU has.
+    filter "options:avx"
+        vectorextensions "AVX"
+    filter {}
+
 include "extern/glfw.lua"
 
 project "Tremble"
@@ -29,7 +48,8 @@ project "Tremble"
     }
     links {
         "GLFW",
-        "OpenGL32"
+        "OpenGL32",
+        "Winmm"
     }
 
     disablewarnings {
@@ -45,4 +65,205 @@ project "Tremble"
 
     filter "configurations:Release"
         defines { "NDEBUG" }
-        optimize "Full"
\ No newline at end of file
+        optimize "Full"
+
+project "MapConverter"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++20"
+    includedirs {
+        "code",
+        "extern/glm"
+    }
+    files {
+        "tools/MapConverter/**.cpp",
+        "code/Debug/**.h",
+        "code/Debug/**.cpp",
+        "code/Jobs/**.h",
+        "code/Jobs/**.cpp",
+        "code/World/Map.h",
+        "code/World/Map.cpp",
+        "code/World/MapArray.h",
+        "code/World/MapFile.h",
+        "code/World/MapFile.cpp",
+        "code/World/SectorPvs.h",
+        "code/World/SectorPvs.cpp"
+    }
+
+    filter "system:windows"
+        systemversion "latest"
+        staticruntime "On"
+
+    filter "configurations:Debug"
+        defines { "DEBUG" }
+        symbols "On"
+
+    filter "configurations:Release"
+        defines { "NDEBUG" }
+        optimize "Full"
+
+project "MapBenchmark"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++20"
+    includedirs {
+        "code",
+        "extern/glm"
+    }
+    files {
+        "tools/MapBenchmark/**.cpp",
+        "code/World/Map.h",
+        "code/World/Map.cpp",
+        "code/World/MapArray.h",
+        "code/World/MapFile.h",
+        "code/World/MapFile.cpp",
+        "code/World/MapGenerator.h",
+        "code/World/MapGenerator.cpp"
+    }
+
+    filter "system:windows"
+        systemversion "latest"
+        staticruntime "On"
+
+    filter "configurations:Debug"
+        defines { "DEBUG" }
+        symbols "On"
+
+    filter "configurations:Release"
+        defines { "NDEBUG" }
+        optimize "Full"
+
+project "MapGenerator"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++20"
+    includedirs {
+        "code",
+        "extern/glm"
+    }
+    files {
+        "tools/MapGenerator/**.cpp",
+        "code/World/Map.h",
+        "code/World/Map.cpp",
+        "code/World/MapArray.h",
+        "code/World/MapFile.h",
+        "code/World/MapFile.cpp",
+        "code/World/MapGenerator.h",
+        "code/World/MapGenerator.cpp"
+    }
+
+    filter "system:windows"
+        systemversion "latest"
+        staticruntime "On"
+
+    filter "configurations:Debug"
+        defines { "DEBUG" }
+        symbols "On"
+
+    filter "configurations:Release"
+        defines { "NDEBUG" }
+        optimize "Full"
+
+project "SectorBenchmark"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++20"
+    includedirs {
+        "code",
+        "extern/glm",
+        "extern/stb"
+    }
+    files {
+        "tools/SectorBenchmark/**.cpp",
+        "code/Debug/**.h",
+        "code/Debug/**.cpp",
+        "code/Jobs/**.h",
+        "code/Jobs/**.cpp",
+        "code/Math/**.h",
+        "code/Math/**.cpp",
+        "code/Memory/**.h",
+        "code/Memory/**.cpp",
+        "code/Render/**.h",
+        "code/Render/**.cpp",
+        "code/World/**.h",
+        "code/World/**.cpp"
+    }
+    removefiles {
+        "code/Render/GLRenderBackend.*"
+    }
+
+    filter "system:windows"
+        systemversion "latest"
+        staticruntime "On"
+
+    filter "configurations:Debug"
+        defines { "DEBUG" }
+        symbols "On"
+
+    filter "configurations:Release"
+        defines { "NDEBUG" }
+        optimize "Full"
+
+project "JobBenchmark"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++20"
+    includedirs {
+        "code",
+        "extern/glm"
+    }
+    files {
+        "tools/JobBenchmark/**.cpp",
+        "code/Debug/**.h",
+        "code/Debug/**.cpp",
+        "code/Jobs/**.h",
+        "code/Jobs/**.cpp",
+        "code/Math/**.h",
+        "code/Math/**.cpp",
+        "code/World/**.h",
+        "code/World/**.cpp"
+    }
+
+    filter "system:windows"
+        systemversion "latest"
+        staticruntime "On"
+
+    filter "configurations:Debug"
+        defines { "DEBUG" }
+        symbols "On"
+
+    filter "configurations:Release"
+        defines { "NDEBUG" }
+        optimize "Full"
+
+project "TraceBenchmark"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++20"
+    includedirs {
+        "code",
+        "extern/glm"
+    }
+    files {
+        "tools/TraceBenchmark/**.cpp",
+        "code/Debug/**.h",
+        "code/Debug/**.cpp",
+        "code/Jobs/**.h",
+        "code/Jobs/**.cpp",
+        "code/Math/**.h",
+        "code/Math/**.cpp",
+        "code/World/**.h",
+        "code/World/**.cpp"
+    }
+
+    filter "system:windows"
+        systemversion "latest"
+        staticruntime "On"
+
+    filter "configurations:Debug"
+        defines { "DEBUG" }
+        symbols "On"
+
+    filter "configurations:Release"
+        defines { "NDEBUG" }
+        optimize "Full"
@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "Jobs/JobSystem.h"
+#include "Math/Statistics.h"
+#include "World/MapGenerator.h"
+#include "World/SectorMesh.h"
+#include "World/SectorPvs.h"
+
+namespace
+{
+    // Every workload runs this many times per thread count and reports the median.
+    constexpr int kRepeats = 5;
+
+    constexpr int kUniformItems = 1 << 20;
+    constexpr int kUniformGrainSize = 4096;
+    constexpr int kUniformItemCost = 16;
+
+    // The cost of the skewed items grows towards the end of the range, so splitting it evenly up front would leave
+    // most threads idle while one finishes the last part.
+    constexpr int kSkewedItems = 1 << 16;
+    constexpr int kSkewedGrainSize = 256;
+    constexpr int kSkewedMaxItemCost = 1024;
+
+    // Fine grained items are run one per job, which measures the cost of queueing and stealing itself.
+    constexpr int kFineItems = 1 << 16;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Workload
+    {
+        const char* name;
+
+        // Runs the workload and returns a checksum of its results, which must not depend on the number of threads.
+        std::function<uint64_t(JobSystem& jobs)> run;
+    };
+
+    uint64_t Mix(uint64_t value)
+    {
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+
+    uint64_t RunItem(int item, int cost)
+    {
+        uint64_t value = (uint64_t)item;
+        for (int i = 0; i < cost; ++i)
+        {
+            value = Mix(value);
+        }
+        return value;
+    }
+
+    uint64_t Sum(const std::vector<uint64_t>& values)
+    {
+        uint64_t sum = 0;
+        for (uint64_t value : values)
+        {
+            sum += value;
+        }
+        return sum;
+    }
+
+    uint64_t Checksum(const void* data, size_t size, uint64_t checksum = 0)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            checksum = (checksum ^ bytes[i]) * 0x00000100000001B3ull;
+        }
+        return checksum;
+    }
+
+    std::vector<Workload> CreateWorkloads(const Map& map)
+    {
+        std::vector<Workload> workloads;
+
+        workloads.push_back({ "uniform items", [](JobSystem& jobs) {
+            std::vector<uint64_t> results(kUniformItems);
+            jobs.ParallelFor(kUniformItems, kUniformGrainSize, [&](int begin, int end) {
+                for (int i = begin; i < end; ++i)
+                {
+                    results[i] = RunItem(i, kUniformItemCost);
+                }
+            });
+            return Sum(results);
+        } });
+
+        workloads.push_back({ "skewed items", [](JobSystem& jobs) {
+            std::vector<uint64_t> results(kSkewedItems);
+            jobs.ParallelFor(kSkewedItems, kSkewedGrainSize, [&](int begin, int end) {
+                for (int i = begin; i < end; ++i)
+                {
+                    int ramp = (int)((int64_t)i * 64 / kSkewedItems);
+                    results[i] = RunItem(i, 1 + ramp * ramp * kSkewedMaxItemCost / (64 * 64));
+                }
+            });
+            return Sum(results);
+        } });
+
+        workloads.push_back({ "fine items", [](JobSystem& jobs) {
+            std::vector<uint64_t> results(kFineItems);
+            jobs.ParallelFor(kFineItems, 1, [&](int begin, int end) {
+                for (int i = begin; i < end; ++i)
+                {
+                    results[i] = RunItem(i, 1);
+                }
+            });
+            return Sum(results);
+        } });
+
+        workloads.push_back({ "sector mesh", [&map](JobSystem& jobs) {
+            SectorMesh mesh;
+            mesh.Build(map, &jobs);
+            uint64_t checksum = Checksum(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+            checksum = Checksum(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t), checksum);
+            return Checksum(mesh.ranges.data(), mesh.ranges.size() * sizeof(SectorMeshRange), checksum);
+        } });
+
+        workloads.push_back({ "sector pvs", [&map](JobSystem& jobs) {
+            SectorPvs pvs;
+            pvs.Build(map, &jobs);
+            return Checksum(pvs.data.data(), pvs.data.size(), Checksum(pvs.offsets.data(), pvs.offsets.size() * sizeof(uint32_t)));
+        } });
+
+        return workloads;
+    }
+}
+
+// Runs synthetic workloads and the parallel sector workloads of the engine on job systems with growing numbers of
+// threads, and reports how the time scales against a single thread.
+int main(int argc, char** argv)
+{
+    MapGenerator generator;
+    generator.numSectors = 4000;
+    int maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            maxThreads = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--sectors") == 0 && i + 1 < argc)
+        {
+            generator.numSectors = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            generator.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            printf("Usage: %s [--threads max] [--sectors n] [--seed n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<int> threadCounts;
+    for (int numThreads = 1; numThreads < maxThreads; numThreads *= 2)
+    {
+        threadCounts.push_back(numThreads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    Map map = generator.Generate();
+    std::vector<Workload> workloads = CreateWorkloads(map);
+
+    printf("%d sectors, %d hardware threads\n", (int)map.sectors.size(), (int)std::thread::hardware_concurrency());
+    printf("%-14s %7s %10s %8s %10s %8s\n", "workload", "threads", "ms", "speedup", "efficiency", "steals");
+
+    for (const Workload& workload : workloads)
+    {
+        double singleThreadTime = 0.0;
+        uint64_t singleThreadChecksum = 0;
+
+        for (int numThreads : threadCounts)
+        {
+            JobSystem jobs(numThreads);
+            std::vector<double> times;
+            uint64_t checksum = 0;
+
+            for (int repeat = 0; repeat < kRepeats; ++repeat)
+            {
+                auto start = Clock::now();
+                checksum = workload.run(jobs);
+                times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            }
+
+            std::sort(times.begin(), times.end());
+            double time = Math::GetPercentile(times, 50.0);
+
+            if (numThreads == 1)
+            {
+                singleThreadTime = time;
+                singleThreadChecksum = checksum;
+            }
+
+            double speedup = singleThreadTime / std::max(time, 1e-9);
+            printf("%-14s %7d %10.3f %7.2fx %9.0f%% %8d%s\n", workload.name, numThreads, time, speedup, 100.0 * speedup / numThreads,
+                jobs.GetNumSteals() / kRepeats, checksum == singleThreadChecksum ? "" : "  results differ from one thread");
+        }
+    }
+
+    return 0;
+}
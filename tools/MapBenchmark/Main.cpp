@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+#include "World/Map.h"
+#include "World/MapFile.h"
+#include "World/MapGenerator.h"
+
+namespace
+{
+    constexpr int kNumRuns = 5;
+
+    // Returns the median time of the given function in milliseconds.
+    double Measure(const std::function<void()>& function)
+    {
+        double times[kNumRuns];
+        for (double& time : times)
+        {
+            auto start = std::chrono::steady_clock::now();
+            function();
+            time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        std::sort(times, times + kNumRuns);
+        return times[kNumRuns / 2];
+    }
+
+    // Reads the whole file and copies each section into vectors owned by the map, the way a conventional loader would.
+    bool ReadMapFile(const char* path, Map& map)
+    {
+        FILE* file = fopen(path, "rb");
+        if (!file)
+        {
+            return false;
+        }
+
+        fseek(file, 0, SEEK_END);
+        std::vector<uint8_t> bytes((size_t)ftell(file));
+        fseek(file, 0, SEEK_SET);
+        bool read = fread(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        fclose(file);
+
+        if (!read || bytes.size() < sizeof(MapFileHeader))
+        {
+            return false;
+        }
+
+        MapFileHeader header;
+        memcpy(&header, bytes.data(), sizeof(header));
+
+        auto CopySection = [&](MapFileSection section, auto* type) {
+            using T = std::remove_pointer_t<decltype(type)>;
+            const MapFileSectionInfo& info = header.sections[(int)section];
+            const T* first = reinterpret_cast<const T*>(bytes.data() + info.offset);
+            return std::vector<T>(first, first + info.count);
+        };
+
+        map.wallVertices = CopySection(MapFileSection::WallVertices, (glm::vec2*)nullptr);
+        map.walls = CopySection(MapFileSection::Walls, (Wall*)nullptr);
+        map.sectors = CopySection(MapFileSection::Sectors, (Sector*)nullptr);
+        map.sectorBounds = CopySection(MapFileSection::SectorBounds, (SectorBounds*)nullptr);
+        return true;
+    }
+
+    // Reads every wall, so the pages of a mapped file are faulted in.
+    int TouchWalls(const Map& map)
+    {
+        int sum = 0;
+        for (const Wall& wall : map.walls)
+        {
+            sum += wall.v[0] + wall.sector;
+        }
+        return sum;
+    }
+}
+
+// Measures how long maps of growing size take to load from text, from a binary file read into memory and from a
+// mapped binary file. The files are written right before they are loaded, so they are read from the page cache.
+int main(int argc, char** argv)
+{
+    const char* directory = argc > 1 ? argv[1] : ".";
+
+    char textPath[1024];
+    char binaryPath[1024];
+    snprintf(textPath, sizeof(textPath), "%s/benchmark_map.txt", directory);
+    snprintf(binaryPath, sizeof(binaryPath), "%s/benchmark_map.bin", directory);
+
+    printf("%9s %9s %10s %10s %10s %10s %10s %10s\n", "sectors", "walls", "MB", "text ms", "read ms", "map ms", "verify ms", "touch ms");
+
+    for (int numSectors : { 1000, 10000, 100000, 1000000 })
+    {
+        MapGenerator generator;
+        generator.numSectors = numSectors;
+        Map map = generator.Generate();
+        if (!map.SaveText(textPath) || !MapFile::Save(binaryPath, map))
+        {
+            printf("Failed to write the benchmark maps to %s\n", directory);
+            return 1;
+        }
+
+        volatile int sink = 0;
+        bool loaded = true;
+
+        double textTime = Measure([&] { Map loadedMap; loaded &= loadedMap.LoadText(textPath); sink = (int)loadedMap.walls.size(); });
+        double readTime = Measure([&] { Map loadedMap; loaded &= ReadMapFile(binaryPath, loadedMap); sink = (int)loadedMap.walls.size(); });
+        double mapTime = Measure([&] { MapFile file; loaded &= file.Open(binaryPath, false); sink = (int)file.map.walls.size(); });
+        double verifyTime = Measure([&] { MapFile file; loaded &= file.Open(binaryPath, true); sink = (int)file.map.walls.size(); });
+        double touchTime = Measure([&] { MapFile file; loaded &= file.Open(binaryPath, false); sink = TouchWalls(file.map); });
+
+        if (!loaded)
+        {
+            printf("Failed to load the benchmark maps from %s\n", directory);
+            return 1;
+        }
+
+        MapFile file;
+        file.Open(binaryPath, false);
+        double megabytes = (double)file.GetHeader().fileSize / (1024.0 * 1024.0);
+
+        printf("%9d %9d %10.2f %10.3f %10.3f %10.3f %10.3f %10.3f\n", (int)map.sectors.size(), (int)map.walls.size(), megabytes, textTime, readTime, mapTime, verifyTime, touchTime);
+    }
+
+    remove(textPath);
+    remove(binaryPath);
+    return 0;
+}
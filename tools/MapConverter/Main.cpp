@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "Jobs/JobSystem.h"
+#include "World/Map.h"
+#include "World/MapFile.h"
+#include "World/SectorPvs.h"
+
+// Converts text maps to binary map files and back. The direction is picked from the input: binary map files are
+// written out as text, anything else is read as a text map and written as a binary map file. With --pvs the sets of
+// potentially visible sectors are compiled as well and written next to the output map, where the game loads them
+// instead of compiling them on every start as long as the map's checksum matches.
+int main(int argc, char** argv)
+{
+    bool compilePvs = argc == 4 && strcmp(argv[3], "--pvs") == 0;
+    if (argc != 3 && !compilePvs)
+    {
+        printf("Usage: %s <input map> <output map> [--pvs]\n", argv[0]);
+        return 1;
+    }
+
+    const char* inputPath = argv[1];
+    const char* outputPath = argv[2];
+
+    MapFile mapFile;
+    if (mapFile.Open(inputPath))
+    {
+        // The sets are matched to the checksum of a binary map file, which text maps do not have.
+        if (compilePvs)
+        {
+            printf("--pvs needs a binary output map\n");
+            return 1;
+        }
+
+        if (!mapFile.map.SaveText(outputPath))
+        {
+            printf("Failed to write %s\n", outputPath);
+            return 1;
+        }
+
+        printf("Wrote text map %s\n", outputPath);
+    }
+    else
+    {
+        Map map;
+        if (!map.LoadText(inputPath))
+        {
+            printf("Failed to read %s as a binary or text map\n", inputPath);
+            return 1;
+        }
+
+        if (!MapFile::Save(outputPath, map) || !mapFile.Open(outputPath))
+        {
+            printf("Failed to write %s\n", outputPath);
+            return 1;
+        }
+
+        printf("Wrote binary map %s (%llu bytes, checksum %016llx)\n", outputPath, (unsigned long long)mapFile.GetHeader().fileSize, (unsigned long long)mapFile.GetHeader().checksum);
+    }
+
+    printf("%d vertices, %d walls, %d sectors\n", (int)mapFile.map.wallVertices.size(), (int)mapFile.map.walls.size(), (int)mapFile.map.sectors.size());
+
+    if (compilePvs)
+    {
+        JobSystem jobs;
+        SectorPvs pvs;
+        pvs.Build(mapFile.map, &jobs);
+        pvs.mapChecksum = mapFile.GetHeader().checksum;
+
+        std::string pvsPath = SectorPvs::GetPath(outputPath);
+        if (!pvs.Save(pvsPath.c_str()))
+        {
+            printf("Failed to write %s\n", pvsPath.c_str());
+            return 1;
+        }
+
+        printf("Wrote PVS %s (%d bytes)\n", pvsPath.c_str(), (int)pvs.data.size());
+    }
+
+    return 0;
+}
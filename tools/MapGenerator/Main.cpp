@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "World/MapFile.h"
+#include "World/MapGenerator.h"
+
+// Generates a map and writes it as a binary map file.
+int main(int argc, char** argv)
+{
+    MapGenerator generator;
+    const char* outputPath = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--sectors") == 0 && i + 1 < argc)
+        {
+            generator.numSectors = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--branching") == 0 && i + 1 < argc)
+        {
+            generator.branching = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--openness") == 0 && i + 1 < argc)
+        {
+            generator.openness = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            generator.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            outputPath = argv[i];
+        }
+    }
+
+    if (!outputPath)
+    {
+        printf("Usage: %s [--sectors n] [--branching 0..1] [--openness 0..1] [--seed n] <output map>\n", argv[0]);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Map map = generator.Generate();
+    std::chrono::duration<double, std::milli> generateTime = std::chrono::steady_clock::now() - start;
+
+    if (!MapFile::Save(outputPath, map))
+    {
+        printf("Failed to write %s\n", outputPath);
+        return 1;
+    }
+
+    int numPortals = 0;
+    for (const Wall& wall : map.walls)
+    {
+        numPortals += wall.sector != -1;
+    }
+
+    printf("Wrote %s: %d sectors, %d walls, %d portals, generated in %.1f ms\n", outputPath, (int)map.sectors.size(), (int)map.walls.size(), numPortals, generateTime.count());
+    return 0;
+}
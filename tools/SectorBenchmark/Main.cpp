@@ -0,0 +1,318 @@
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "Jobs/JobSystem.h"
+#include "Math/Frustum.h"
+#include "Math/Statistics.h"
+#include "Render/RenderQueue.h"
+#include "Render/SoftwareRenderBackend.h"
+#include "World/MapGenerator.h"
+#include "World/SectorLocator.h"
+#include "World/SectorMesh.h"
+#include "World/VisibilityCache.h"
+
+namespace
+{
+    constexpr int kNumPaths = 4;
+    constexpr int kNumWaypoints = 64;
+    constexpr int kFramesPerPath = 300;
+
+    // The camera moves this far each frame, about 12 units per second at 60 frames per second.
+    constexpr float kStepDistance = 0.2f;
+
+    constexpr float kEyeHeight = 1.6f;
+    constexpr float kFieldOfView = 1.2f;
+    constexpr int kWidth = 320;
+    constexpr int kHeight = 240;
+
+    enum Stage
+    {
+        kStageLocate,
+        kStageVisibility,
+        kStageMeshEmit,
+        kStageRaster,
+
+        // Not part of a frame: the bounds of every sector classified in batches and one at a time, as the game does
+        // when the camera is outside the map.
+        kStageBatchCull,
+        kStageScalarCull,
+        kNumStages
+    };
+
+    const char* kStageNames[kNumStages] = { "locate", "visibility", "mesh emit", "raster", "batch cull", "scalar cull" };
+
+    using Clock = std::chrono::steady_clock;
+
+    double GetMilliseconds(Clock::time_point start, Clock::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    glm::vec3 GetSectorCenter(const Map& map, int sectorIndex)
+    {
+        const SectorBounds& bounds = map.sectorBounds[sectorIndex];
+        glm::vec2 center = (bounds.min + bounds.max) * 0.5f;
+        return glm::vec3(center.x, map.sectors[sectorIndex].floorHeight + kEyeHeight, -center.y);
+    }
+
+    // Walks from the given sector through random portals, preferring not to turn back, and returns the centres of
+    // the sectors passed. The generated sectors are convex and share whole walls, so the straight lines between
+    // the centres never leave the map.
+    std::vector<glm::vec3> CreatePath(const Map& map, int startSector, std::mt19937& random)
+    {
+        std::vector<glm::vec3> waypoints;
+        std::vector<int> portals;
+        int sectorIndex = startSector;
+        int previousSector = -1;
+
+        waypoints.push_back(GetSectorCenter(map, sectorIndex));
+
+        while ((int)waypoints.size() < kNumWaypoints)
+        {
+            const Sector& sector = map.sectors[sectorIndex];
+            portals.clear();
+
+            for (int i = 0; i < sector.numWalls; ++i)
+            {
+                int otherSector = map.walls[sector.firstWall + i].sector;
+                if (otherSector != -1 && otherSector != previousSector)
+                {
+                    portals.push_back(otherSector);
+                }
+            }
+
+            if (portals.empty())
+            {
+                if (previousSector == -1)
+                {
+                    break;
+                }
+                portals.push_back(previousSector);
+            }
+
+            previousSector = sectorIndex;
+            sectorIndex = portals[random() % portals.size()];
+            waypoints.push_back(GetSectorCenter(map, sectorIndex));
+        }
+
+        return waypoints;
+    }
+
+    Sphere GetBoundingSphere(const Box& box)
+    {
+        return Sphere(box.GetCenter(), glm::length(box.GetExtents()));
+    }
+
+    void RunBenchmark(MapGenerator& generator, JobSystem& jobs)
+    {
+        auto setupStart = Clock::now();
+        Map map = generator.Generate();
+        auto generated = Clock::now();
+
+        SectorLocator locator;
+        locator.Build(map);
+        auto located = Clock::now();
+
+        SectorMesh sectorMesh;
+        sectorMesh.Build(map, &jobs);
+        auto meshed = Clock::now();
+
+        int numSectors = (int)sectorMesh.ranges.size();
+        BoxArray sectorBoxes;
+        SphereArray sectorSpheres;
+        sectorBoxes.Reserve(numSectors);
+        sectorSpheres.Reserve(numSectors);
+        for (const SectorMeshRange& range : sectorMesh.ranges)
+        {
+            sectorBoxes.Add(range.bounds);
+            sectorSpheres.Add(GetBoundingSphere(range.bounds));
+        }
+
+        std::vector<CullResult> boxResults(numSectors);
+        std::vector<CullResult> sphereResults(numSectors);
+        std::vector<uint32_t> boxMask((numSectors + 31) / 32);
+        std::vector<uint32_t> sphereMask((numSectors + 31) / 32);
+        std::vector<CullResult> scalarBoxResults(numSectors);
+        std::vector<CullResult> scalarSphereResults(numSectors);
+        std::vector<uint8_t> boxRejectPlanes(numSectors, 0);
+        std::vector<uint8_t> sphereRejectPlanes(numSectors, 0);
+        long long numCullMismatches = 0;
+
+        VisibilityCache visibility;
+        RenderQueue renderQueue;
+        SoftwareRenderBackend renderBackend(kWidth, kHeight, &jobs);
+
+        std::vector<double> stageTimes[kNumStages];
+        long long numVisibleSectors = 0;
+        long long numDrawnSectors = 0;
+        int numFrames = 0;
+        int numLost = 0;
+
+        std::mt19937 random(generator.seed);
+        glm::mat4 projection = glm::perspective(kFieldOfView, (float)kWidth / (float)kHeight, 0.1f, 1000.0f);
+
+        for (int pathIndex = 0; pathIndex < kNumPaths; ++pathIndex)
+        {
+            std::vector<glm::vec3> path = CreatePath(map, (int)(random() % map.sectors.size()), random);
+            if (path.size() < 2)
+            {
+                continue;
+            }
+
+            int cameraSector = -1;
+            visibility.Invalidate();
+
+            for (int frame = 0; frame < kFramesPerPath; ++frame)
+            {
+                // Move along the path and look ahead, turning smoothly towards the next leg.
+                float distance = (float)frame * kStepDistance / glm::length(path[1] - path[0]);
+                int leg = std::min((int)distance, (int)path.size() - 2);
+                float t = std::min(distance - (float)leg, 1.0f);
+
+                glm::vec3 position = glm::mix(path[leg], path[leg + 1], t);
+                glm::vec3 direction = path[leg + 1] - path[leg];
+                glm::vec3 nextDirection = leg + 2 < (int)path.size() ? path[leg + 2] - path[leg + 1] : direction;
+                glm::vec3 forward = glm::normalize(glm::mix(direction, nextDirection, t * t) * glm::vec3(1.0f, 0.0f, 1.0f) + glm::vec3(0.0f, 1e-3f, 0.0f));
+
+                auto frameStart = Clock::now();
+                cameraSector = locator.Locate(position, cameraSector);
+                auto locateEnd = Clock::now();
+
+                const std::vector<int>& visibleSectors = visibility.Update(map, cameraSector, position, forward, kFieldOfView, (float)kWidth / (float)kHeight);
+                auto visibilityEnd = Clock::now();
+
+                glm::mat4 view = glm::lookAt(position, position + forward, glm::vec3(0.0f, 1.0f, 0.0f));
+                Frustum frustum(projection * view);
+
+                for (int sectorIndex : visibleSectors)
+                {
+                    const SectorMeshRange& range = sectorMesh.ranges[sectorIndex];
+                    if (frustum.IntersectsBox(range.bounds))
+                    {
+                        RenderState state = { PrimitiveType::Triangles, 0, 1.0f, ScreenRect() };
+                        renderQueue.Add(state, &sectorMesh.vertices[range.firstVertex], range.numVertices, &sectorMesh.indices[range.firstIndex], range.numIndices, range.firstVertex);
+                        numDrawnSectors++;
+                    }
+                }
+                auto emitEnd = Clock::now();
+
+                RenderView renderView = { projection, view, kWidth, kHeight };
+                renderQueue.Flush(renderBackend, renderView);
+                auto rasterEnd = Clock::now();
+
+                frustum.ClassifyBoxes(sectorBoxes, boxResults.data());
+                frustum.ClassifySpheres(sectorSpheres, sphereResults.data());
+                std::fill(boxMask.begin(), boxMask.end(), 0u);
+                std::fill(sphereMask.begin(), sphereMask.end(), 0u);
+                frustum.CullBoxes(sectorBoxes, boxMask.data());
+                frustum.CullSpheres(sectorSpheres, sphereMask.data());
+                auto batchCullEnd = Clock::now();
+
+                FrustumCullStats cullStats;
+                for (int i = 0; i < numSectors; ++i)
+                {
+                    uint8_t childMask;
+                    scalarBoxResults[i] = frustum.ClassifyBoxCoherent(sectorMesh.ranges[i].bounds, kAllFrustumPlanes, boxRejectPlanes[i], childMask, cullStats);
+                    scalarSphereResults[i] = frustum.ClassifySphereCoherent(GetBoundingSphere(sectorMesh.ranges[i].bounds), kAllFrustumPlanes, sphereRejectPlanes[i], childMask, cullStats);
+                }
+                auto scalarCullEnd = Clock::now();
+
+                // The batch kernels have to agree with the scalar tests on every sector.
+                for (int i = 0; i < numSectors; ++i)
+                {
+                    bool boxVisible = (boxMask[i / 32] >> (i % 32)) & 1;
+                    bool sphereVisible = (sphereMask[i / 32] >> (i % 32)) & 1;
+                    numCullMismatches += boxResults[i] != scalarBoxResults[i] || sphereResults[i] != scalarSphereResults[i] ||
+                        boxVisible != (scalarBoxResults[i] != CullResult::Outside) || sphereVisible != (scalarSphereResults[i] != CullResult::Outside);
+                }
+
+                stageTimes[kStageLocate].push_back(GetMilliseconds(frameStart, locateEnd));
+                stageTimes[kStageVisibility].push_back(GetMilliseconds(locateEnd, visibilityEnd));
+                stageTimes[kStageMeshEmit].push_back(GetMilliseconds(visibilityEnd, emitEnd));
+                stageTimes[kStageRaster].push_back(GetMilliseconds(emitEnd, rasterEnd));
+                stageTimes[kStageBatchCull].push_back(GetMilliseconds(rasterEnd, batchCullEnd));
+                stageTimes[kStageScalarCull].push_back(GetMilliseconds(batchCullEnd, scalarCullEnd));
+
+                numVisibleSectors += (long long)visibleSectors.size();
+                numLost += cameraSector == -1;
+                numFrames++;
+            }
+        }
+
+        printf("%d sectors, %d walls: generate %.1f ms, locator %.1f ms, mesh %.1f ms\n", (int)map.sectors.size(), (int)map.walls.size(),
+            GetMilliseconds(setupStart, generated), GetMilliseconds(generated, located), GetMilliseconds(located, meshed));
+        printf("    %d frames, %.1f visible and %.1f drawn sectors per frame, %d frames outside the map, visibility hits %d/%d\n",
+            numFrames, (double)numVisibleSectors / (double)std::max(numFrames, 1), (double)numDrawnSectors / (double)std::max(numFrames, 1), numLost,
+            visibility.numHits, visibility.numHits + visibility.numMisses);
+        printf("    batch culling %s the scalar tests, %lld mismatches\n", numCullMismatches == 0 ? "matches" : "differs from", numCullMismatches);
+        printf("    %-12s %9s %9s %9s %9s\n", "stage (ms)", "p50", "p95", "p99", "max");
+
+        for (int stage = 0; stage < kNumStages; ++stage)
+        {
+            std::vector<double>& times = stageTimes[stage];
+            std::sort(times.begin(), times.end());
+            printf("    %-12s %9.4f %9.4f %9.4f %9.4f\n", kStageNames[stage], Math::GetPercentile(times, 50.0), Math::GetPercentile(times, 95.0), Math::GetPercentile(times, 99.0), times.empty() ? 0.0 : times.back());
+        }
+    }
+}
+
+// Flies scripted camera paths through generated maps of growing size and reports percentiles of the time spent
+// in each stage of a frame, so scaling regressions show up as the maps grow.
+int main(int argc, char** argv)
+{
+    MapGenerator generator;
+    std::vector<int> sizes = { 1000, 10000, 100000, 1000000 };
+    int numThreads = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc)
+        {
+            sizes.clear();
+            for (char* size = strtok(argv[++i], ","); size; size = strtok(nullptr, ","))
+            {
+                sizes.push_back(atoi(size));
+            }
+        }
+        else if (strcmp(argv[i], "--branching") == 0 && i + 1 < argc)
+        {
+            generator.branching = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--openness") == 0 && i + 1 < argc)
+        {
+            generator.openness = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            generator.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            numThreads = atoi(argv[++i]);
+        }
+        else
+        {
+            printf("Usage: %s [--sizes n,n,...] [--branching 0..1] [--openness 0..1] [--seed n] [--threads n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    JobSystem jobs(numThreads);
+
+    for (int numSectors : sizes)
+    {
+        generator.numSectors = numSectors;
+        RunBenchmark(generator, jobs);
+    }
+
+    return 0;
+}
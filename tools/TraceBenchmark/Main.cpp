@@ -0,0 +1,402 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <glm/gtx/intersect.hpp>
+
+#include "Jobs/JobSystem.h"
+#include "Math/Statistics.h"
+#include "World/LineOfSightService.h"
+#include "World/MapGenerator.h"
+#include "World/SectorLocator.h"
+#include "World/SectorMesh.h"
+#include "World/SectorTrace.h"
+#include "World/WorldBvh.h"
+
+namespace
+{
+    constexpr float kEyeHeight = 1.6f;
+
+    // Every agent asks for line of sight to this many of the agents after it each tick.
+    constexpr int kQueriesPerAgent = 8;
+
+    // Agents move this far each tick, about 3 units per second at 60 ticks per second, so most of them stay in
+    // their sector from one tick to the next and their pairs are answered from the cache.
+    constexpr float kAgentStep = 0.05f;
+
+    // Rays timed against the hierarchy, and the smaller number also checked against every triangle of the mesh.
+    constexpr int kNumTimedRays = 100000;
+    constexpr int kNumCheckedRays = 256;
+
+    constexpr float kMaxRayDistance = 10000.0f;
+
+    using Clock = std::chrono::steady_clock;
+
+    double GetMilliseconds(Clock::time_point start, Clock::time_point end)
+    {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    glm::vec3 GetSectorCenter(const Map& map, int sectorIndex)
+    {
+        const SectorBounds& bounds = map.sectorBounds[sectorIndex];
+        glm::vec2 center = (bounds.min + bounds.max) * 0.5f;
+        return glm::vec3(center.x, map.sectors[sectorIndex].floorHeight + kEyeHeight, -center.y);
+    }
+
+    glm::vec3 GetRandomDirection(std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> coordinate(-1.0f, 1.0f);
+        while (true)
+        {
+            glm::vec3 direction(coordinate(random), coordinate(random), coordinate(random));
+            float length = glm::length(direction);
+            if (length > 0.01f && length <= 1.0f)
+            {
+                return direction / length;
+            }
+        }
+    }
+
+    // Walks from sector centre to sector centre through random portals. The generated sectors are convex and share
+    // whole walls, so the straight lines between neighbouring centres never leave the map.
+    struct Agent
+    {
+        glm::vec3 position;
+        int sector;
+        int targetSector;
+        int locatedSector;
+    };
+
+    int PickNeighbour(const Map& map, int sectorIndex, std::mt19937& random)
+    {
+        const Sector& sector = map.sectors[sectorIndex];
+        int numPortals = 0;
+        int picked = sectorIndex;
+
+        // Reservoir sampling picks uniformly among the portals without collecting them.
+        for (int i = 0; i < sector.numWalls; ++i)
+        {
+            int otherSector = map.walls[sector.firstWall + i].sector;
+            if (otherSector != -1 && random() % ++numPortals == 0)
+            {
+                picked = otherSector;
+            }
+        }
+        return picked;
+    }
+
+    void MoveAgent(const Map& map, Agent& agent, std::mt19937& random)
+    {
+        glm::vec3 target = GetSectorCenter(map, agent.targetSector);
+        glm::vec3 offset = target - agent.position;
+        float distance = glm::length(offset);
+
+        if (distance <= kAgentStep)
+        {
+            agent.position = target;
+            agent.sector = agent.targetSector;
+            agent.targetSector = PickNeighbour(map, agent.sector, random);
+        }
+        else
+        {
+            agent.position += offset * (kAgentStep / distance);
+        }
+    }
+
+    // Moves agents over a generated map for a number of ticks and answers the line of sight queries between them
+    // with the batched service, once on the calling thread and once on the jobs. Both see the same queries and keep
+    // the same cache, so their answers have to agree exactly.
+    void RunLineOfSight(const Map& map, JobSystem& jobs, int numAgents, int numTicks, uint32_t seed)
+    {
+        SectorLocator locator;
+        locator.Build(map);
+
+        std::mt19937 random(seed);
+        std::vector<Agent> agents(numAgents);
+        for (Agent& agent : agents)
+        {
+            agent.sector = (int)(random() % map.sectors.size());
+            agent.targetSector = PickNeighbour(map, agent.sector, random);
+            agent.position = GetSectorCenter(map, agent.sector);
+            agent.locatedSector = agent.sector;
+        }
+
+        LineOfSightService serialService;
+        LineOfSightService parallelService(&jobs);
+
+        std::vector<LineOfSightQuery> queries;
+        std::vector<uint32_t> serialBits;
+        std::vector<uint32_t> parallelBits;
+        std::vector<double> serialTimes;
+        std::vector<double> parallelTimes;
+        long long numQueries = 0;
+        long long numVisible = 0;
+        long long numCacheHits = 0;
+        int numMismatches = 0;
+
+        for (int tick = 0; tick < numTicks; ++tick)
+        {
+            for (Agent& agent : agents)
+            {
+                MoveAgent(map, agent, random);
+                agent.locatedSector = locator.Locate(agent.position, agent.locatedSector);
+            }
+
+            queries.clear();
+            for (int i = 0; i < numAgents; ++i)
+            {
+                for (int k = 1; k <= std::min(kQueriesPerAgent, numAgents - 1); ++k)
+                {
+                    int j = (i + k) % numAgents;
+                    queries.push_back({ agents[i].position, agents[j].position, agents[i].locatedSector, agents[j].locatedSector, ((uint64_t)i << 32) | (uint32_t)j });
+                }
+            }
+
+            auto serialStart = Clock::now();
+            serialService.Run(map, queries.data(), (int)queries.size(), serialBits);
+            auto parallelStart = Clock::now();
+            parallelService.Run(map, queries.data(), (int)queries.size(), parallelBits);
+            auto parallelEnd = Clock::now();
+
+            serialTimes.push_back(GetMilliseconds(serialStart, parallelStart));
+            parallelTimes.push_back(GetMilliseconds(parallelStart, parallelEnd));
+
+            for (int i = 0; i < (int)queries.size(); ++i)
+            {
+                bool visible = LineOfSightService::IsVisible(parallelBits, i);
+                numMismatches += visible != LineOfSightService::IsVisible(serialBits, i);
+                numVisible += visible;
+            }
+            numQueries += (long long)queries.size();
+            numCacheHits += parallelService.numCacheHits;
+        }
+
+        std::sort(serialTimes.begin(), serialTimes.end());
+        std::sort(parallelTimes.begin(), parallelTimes.end());
+
+        printf("Line of sight: %d agents, %d ticks, %lld queries, %.1f%% visible, %.1f%% from the cache\n", numAgents, numTicks, numQueries,
+            100.0 * (double)numVisible / (double)std::max(numQueries, 1LL), 100.0 * (double)numCacheHits / (double)std::max(numQueries, 1LL));
+        printf("    tick ms      p50 %9.4f  p95 %9.4f  on the calling thread\n", Math::GetPercentile(serialTimes, 50.0), Math::GetPercentile(serialTimes, 95.0));
+        printf("    tick ms      p50 %9.4f  p95 %9.4f  on %d job threads\n", Math::GetPercentile(parallelTimes, 50.0), Math::GetPercentile(parallelTimes, 95.0), jobs.GetNumThreads());
+        printf("    %s\n", numMismatches == 0 ? "results match" : "results differ");
+    }
+
+    // Returns the distance to the closest triangle of the mesh hit by the ray, or maxDistance if there is none.
+    float RaycastMesh(const SectorMesh& mesh, const Ray& ray, float maxDistance)
+    {
+        float closest = maxDistance;
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            glm::vec2 barycentric;
+            float distance;
+            if (glm::intersectRayTriangle(ray.origin, ray.direction, mesh.vertices[mesh.indices[i]].position, mesh.vertices[mesh.indices[i + 1]].position,
+                mesh.vertices[mesh.indices[i + 2]].position, barycentric, distance) && distance < closest)
+            {
+                closest = distance;
+            }
+        }
+        return closest;
+    }
+
+    // Casts rays from the centres of random sectors in random directions.
+    void CreateRays(const Map& map, uint32_t seed, std::vector<Ray>& rays, std::vector<int>& raySectors)
+    {
+        std::mt19937 random(seed);
+        rays.resize(kNumTimedRays);
+        raySectors.resize(kNumTimedRays);
+        for (int i = 0; i < kNumTimedRays; ++i)
+        {
+            raySectors[i] = (int)(random() % map.sectors.size());
+            rays[i] = Ray(GetSectorCenter(map, raySectors[i]), GetRandomDirection(random));
+        }
+    }
+
+    // Returns true if both distances are the same up to the rounding of the different intersection routines.
+    bool IsSameDistance(float a, float b)
+    {
+        return glm::abs(a - b) <= 1e-3f * glm::max(1.0f, glm::max(a, b));
+    }
+
+    // Builds the world hierarchy over the sector mesh on the calling thread and on the jobs, checks that both give
+    // the same tree, then casts the rays and checks a few of them against every triangle of the mesh.
+    void RunWorldBvh(const SectorMesh& mesh, JobSystem& jobs, const std::vector<Ray>& rays, WorldBvh& bvh)
+    {
+        WorldBvh serialBvh;
+        auto serialStart = Clock::now();
+        serialBvh.Build(mesh);
+        auto parallelStart = Clock::now();
+        bvh.Build(mesh, &jobs);
+        auto parallelEnd = Clock::now();
+
+        bool sameTree = serialBvh.nodes.size() == bvh.nodes.size() && serialBvh.triangleIds == bvh.triangleIds &&
+            memcmp(serialBvh.nodes.data(), bvh.nodes.data(), serialBvh.nodes.size() * sizeof(WorldBvhNode)) == 0;
+
+        printf("World BVH: %d triangles, %d nodes, depth %d\n", (int)bvh.triangles.size(), (int)bvh.nodes.size(), bvh.GetDepth());
+        printf("    build ms     %9.2f on the calling thread, %9.2f on %d job threads, %s\n", GetMilliseconds(serialStart, parallelStart),
+            GetMilliseconds(parallelStart, parallelEnd), jobs.GetNumThreads(), sameTree ? "same tree" : "trees differ");
+
+        int numHits = 0;
+        auto closestStart = Clock::now();
+        for (const Ray& ray : rays)
+        {
+            WorldBvhHit hit;
+            numHits += bvh.Raycast(ray, kMaxRayDistance, hit);
+        }
+        auto anyStart = Clock::now();
+        int numAnyHits = 0;
+        for (const Ray& ray : rays)
+        {
+            numAnyHits += bvh.RaycastAny(ray, kMaxRayDistance);
+        }
+        auto anyEnd = Clock::now();
+
+        printf("    closest hit  %9.3f Mrays/s, %.1f%% hit\n", rays.size() / GetMilliseconds(closestStart, anyStart) / 1000.0, 100.0 * numHits / rays.size());
+        printf("    any hit      %9.3f Mrays/s, %s\n", rays.size() / GetMilliseconds(anyStart, anyEnd) / 1000.0, numAnyHits == numHits ? "same rays hit" : "different rays hit");
+
+        // Neighbouring triangles share edges, so only the distances are compared.
+        int numMismatches = 0;
+        for (int i = 0; i < kNumCheckedRays; ++i)
+        {
+            WorldBvhHit hit;
+            float distance = bvh.Raycast(rays[i], kMaxRayDistance, hit) ? hit.distance : kMaxRayDistance;
+            numMismatches += !IsSameDistance(distance, RaycastMesh(mesh, rays[i], kMaxRayDistance));
+        }
+        printf("    %d of %d rays match every triangle of the mesh\n", kNumCheckedRays - numMismatches, kNumCheckedRays);
+    }
+
+    // Traces the rays through the sectors they start in and checks the hits against every triangle of the mesh for
+    // a few rays and against the world hierarchy for all of them. Line of sight is checked the same way on segments
+    // of the rays, whose ends fall inside and outside the map.
+    void RunTraceRay(const Map& map, const SectorMesh& mesh, const WorldBvh& bvh, const std::vector<Ray>& rays, const std::vector<int>& raySectors, uint32_t seed)
+    {
+        std::vector<TraceResult> results(rays.size());
+        long long numWallsTested = 0;
+        long long numPortalsCrossed = 0;
+        int numHits = 0;
+
+        auto traceStart = Clock::now();
+        for (size_t i = 0; i < rays.size(); ++i)
+        {
+            numHits += TraceRay(map, raySectors[i], rays[i], kMaxRayDistance, results[i]);
+        }
+        auto traceEnd = Clock::now();
+
+        int numMeshMismatches = 0;
+        for (int i = 0; i < kNumCheckedRays; ++i)
+        {
+            float distance = results[i].surface != TraceSurface::None ? results[i].distance : kMaxRayDistance;
+            numMeshMismatches += !IsSameDistance(distance, RaycastMesh(mesh, rays[i], kMaxRayDistance));
+        }
+
+        int numBvhMismatches = 0;
+        for (size_t i = 0; i < rays.size(); ++i)
+        {
+            WorldBvhHit hit;
+            float expected = bvh.Raycast(rays[i], kMaxRayDistance, hit) ? hit.distance : kMaxRayDistance;
+            float distance = results[i].surface != TraceSurface::None ? results[i].distance : kMaxRayDistance;
+            numBvhMismatches += !IsSameDistance(distance, expected);
+            numWallsTested += results[i].numWallsTested;
+            numPortalsCrossed += results[i].numPortalsCrossed;
+        }
+
+        // Segments that end close to what the ray hits are left out, where the two tests may round either way.
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> length(0.5f, 20.0f);
+        int numSegments = 0;
+        int numVisible = 0;
+        int numLineMismatches = 0;
+        for (size_t i = 0; i < rays.size(); ++i)
+        {
+            float segmentLength = length(random);
+            if (results[i].surface != TraceSurface::None && IsSameDistance(segmentLength, results[i].distance))
+            {
+                continue;
+            }
+
+            bool visible = LineOfSight(map, raySectors[i], Line(rays[i].origin, rays[i].GetPointAtDistance(segmentLength)));
+            numLineMismatches += visible == bvh.RaycastAny(rays[i], segmentLength);
+            numVisible += visible;
+            numSegments++;
+        }
+
+        printf("Sector trace: %.1f%% hit, %.1f walls tested and %.1f portals crossed per ray\n", 100.0 * numHits / rays.size(),
+            (double)numWallsTested / rays.size(), (double)numPortalsCrossed / rays.size());
+        printf("    closest hit  %9.3f Mrays/s\n", rays.size() / GetMilliseconds(traceStart, traceEnd) / 1000.0);
+        printf("    %d of %d rays match every triangle of the mesh, %d of %d match the world BVH\n", kNumCheckedRays - numMeshMismatches, kNumCheckedRays,
+            (int)rays.size() - numBvhMismatches, (int)rays.size());
+        printf("    %d of %d line of sight segments match the world BVH, %.1f%% visible\n", numSegments - numLineMismatches, numSegments, 100.0 * numVisible / std::max(numSegments, 1));
+    }
+}
+
+// Exercises the world queries on a generated map: the batched line of sight service that answers the visibility
+// queries between agents, the world hierarchy that answers raycasts against the sector geometry, and the traces
+// through the sectors that both are checked against.
+int main(int argc, char** argv)
+{
+    MapGenerator generator;
+    generator.numSectors = 10000;
+    int numThreads = 0;
+    int numAgents = 512;
+    int numTicks = 120;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--sectors") == 0 && i + 1 < argc)
+        {
+            generator.numSectors = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--openness") == 0 && i + 1 < argc)
+        {
+            generator.openness = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            generator.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            numThreads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--agents") == 0 && i + 1 < argc)
+        {
+            numAgents = std::max(2, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc)
+        {
+            numTicks = atoi(argv[++i]);
+        }
+        else
+        {
+            printf("Usage: %s [--sectors n] [--openness 0..1] [--seed n] [--threads n] [--agents n] [--ticks n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    JobSystem jobs(numThreads);
+    Map map = generator.Generate();
+    if (map.sectors.empty())
+    {
+        printf("The map has no sectors\n");
+        return 1;
+    }
+
+    printf("%d sectors, %d walls\n", (int)map.sectors.size(), (int)map.walls.size());
+    RunLineOfSight(map, jobs, numAgents, numTicks, generator.seed);
+
+    SectorMesh mesh;
+    mesh.Build(map, &jobs);
+
+    std::vector<Ray> rays;
+    std::vector<int> raySectors;
+    CreateRays(map, generator.seed, rays, raySectors);
+
+    WorldBvh bvh;
+    RunWorldBvh(mesh, jobs, rays, bvh);
+    RunTraceRay(map, mesh, bvh, rays, raySectors, generator.seed);
+    return 0;
+}